@@ -0,0 +1,99 @@
+/**
+ * @file channel_bench.cc
+ * @brief Measures the throughput of channels, on their own and between Lox workers.
+ *
+ * A producer thread sends numbers through a Channel to a consumer thread, first one
+ * value at a time through a tiny channel, then through a larger one. A Lox pipeline
+ * of two workers, one producing numbers and one squaring them, then sends the same
+ * numbers through channels of the same sizes to the script that sums them.
+ * Usage: channel_bench [number of values]
+ */
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "Channel.h"
+#include "Program.h"
+
+/**
+ * @brief Times a producer and a consumer thread passing numbers through a channel.
+ * @param values The number of values to pass.
+ * @param capacity The capacity of the channel.
+ * @return The time taken in milliseconds.
+ */
+double measureChannel(const size_t& values, const size_t& capacity)
+{
+  Channel<double> channel(capacity);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  std::thread producer([&] {
+    for (size_t i = 0; i < values; ++i)
+      channel.send(static_cast<double>(i));
+    channel.close();
+  });
+  double total = 0;
+  while (std::optional<double> value = channel.receive())
+    total += *value;
+  producer.join();
+
+  double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  if (total < 0) std::cout << total;
+  return elapsed;
+}
+
+/**
+ * @brief Times the Lox pipeline over channels of the given capacity.
+ * @param context The context the benchmark script has run in.
+ * @param values The number of values to pass.
+ * @param capacity The capacity of the channels.
+ * @return The time taken in milliseconds.
+ */
+double measurePipeline(Context& context, const size_t& values, const size_t& capacity)
+{
+  Context::Function function = context.function("pipeline");
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  context.call(function, { static_cast<double>(values), static_cast<double>(capacity) });
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Main function.
+ * @param argc Number of command line arguments.
+ * @param argv Array of command line argument strings.
+ * @return Returns EXIT_SUCCESS.
+ */
+int main(int argc, char* argv[])
+{
+  const size_t values = argc > 1 ? std::stoul(argv[1]) : 100000;
+
+  for (size_t capacity : { 2, 1024 })
+  {
+    double elapsed = measureChannel(values, capacity);
+    std::cout << "Channel<double>, capacity " << capacity << ": " << elapsed << " ms ("
+              << values / elapsed / 1000 << " M values/s)" << std::endl;
+  }
+
+  // Locals are parameters only: `var` inside a function declares in the top-level
+  // scope, so it would be shared by every call.
+  std::shared_ptr<const Program> program = Program::compile(
+    "fun produce(out, n) { for (var i in 0..n) send(out, i); close(out); }\n"
+    "fun square(source, out) { drain(source, out, recv(source)); close(out); }\n"
+    "fun drain(source, out, v) { while (v != nil) { send(out, v * v); v = recv(source); } }\n"
+    "fun sum(source, total, v) { while (v != nil) { total = total + v; v = recv(source); } return total; }\n"
+    "fun pipeline(n, capacity) { start(n, channel(capacity), channel(capacity)); }\n"
+    "fun start(n, numbers, squares) {\n"
+    "  worker(produce, numbers, n); worker(square, numbers, squares);\n"
+    "  return sum(squares, 0, recv(squares));\n"
+    "}\n");
+
+  Context context(program);
+  for (size_t capacity : { 2, 1024 })
+  {
+    double elapsed = measurePipeline(context, values / 10, capacity);
+    std::cout << "Lox pipeline, capacity " << capacity << ": " << elapsed << " ms ("
+              << values / 10 / elapsed << " k values/s)" << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file embed_bench.cc
+ * @brief Measures the overhead of calling into Lox from C++ through the embedding API.
+ *
+ * A small Lox function is called many times from the host through a resolved
+ * `Context::Function`, with numbers and with short and long strings, the latter
+ * both copied into the parameter and moved into it, and compared with compiling
+ * and running a script that makes the same call. Creating a Context from an
+ * already compiled Program is timed as well.
+ * Usage: embed_bench [number of calls]
+ */
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Program.h"
+
+/**
+ * @brief Main function.
+ * @param argc Number of command line arguments.
+ * @param argv Array of command line argument strings.
+ * @return Returns EXIT_SUCCESS, or EXIT_FAILURE if a call returns the wrong value.
+ */
+int main(int argc, char* argv[])
+{
+  const size_t calls = argc > 1 ? std::stoul(argv[1]) : 1000000;
+  using Clock = std::chrono::steady_clock;
+  auto nanoseconds = [](const Clock::time_point& start, const size_t& count) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / count;
+  };
+
+  const std::string script =
+    "fun add(a, b) { return a + b; }\n"
+    "fun greet(name) { return \"hello, \" + name; }\n";
+
+  std::shared_ptr<const Program> program = Program::compile(script);
+  Context context(program);
+
+  // Numbers, with the function resolved once.
+  Context::Function add = context.function("add");
+  std::vector<LiteralValue> arguments = { 0.0, 1.0 };
+  Clock::time_point start = Clock::now();
+  for (size_t i = 0; i < calls; ++i)
+  {
+    arguments[0] = static_cast<double>(i);
+    if (std::get<double>(context.call(add, arguments)) != i + 1.0) return EXIT_FAILURE;
+  }
+  std::cout << "call add(number, number): " << nanoseconds(start, calls) << " ns per call" << std::endl;
+
+  // Strings, each copied into the parameter: within the short-string buffer, then past it.
+  Context::Function greet = context.function("greet");
+  for (const std::string& text : { std::string("world"), std::string(100, 'w') })
+  {
+    const std::vector<LiteralValue> name = { text };
+    start = Clock::now();
+    for (size_t i = 0; i < calls; ++i)
+      if (std::get<std::string>(context.call(greet, name)).size() != text.size() + 7) return EXIT_FAILURE;
+    std::cout << "call greet(string of " << text.size() << "): " << nanoseconds(start, calls) << " ns per call" << std::endl;
+  }
+
+  // A long string the host makes for each call, passed by reference and copied into the
+  // parameter, then handed over and moved into it, which removes that copy.
+  const std::string long_text(100, 'w');
+  for (const bool& moved : { false, true })
+  {
+    start = Clock::now();
+    for (size_t i = 0; i < calls; ++i)
+    {
+      std::vector<LiteralValue> name = { long_text };
+      const LiteralValue greeting = moved ? context.call(greet, std::move(name)) : context.call(greet, name);
+      if (std::get<std::string>(greeting).size() != long_text.size() + 7) return EXIT_FAILURE;
+    }
+    std::cout << "call greet(fresh string of " << long_text.size() << "), " << (moved ? "moved" : "copied")
+              << ": " << nanoseconds(start, calls) << " ns per call" << std::endl;
+  }
+
+  // Looking the function up again on every call.
+  start = Clock::now();
+  for (size_t i = 0; i < calls; ++i)
+    context.call(context.function("add"), arguments);
+  std::cout << "look up and call add: " << nanoseconds(start, calls) << " ns per call" << std::endl;
+
+  // A fresh context per call, sharing the compiled program.
+  const size_t contexts = calls / 100 + 1;
+  start = Clock::now();
+  for (size_t i = 0; i < contexts; ++i)
+  {
+    Context fresh(program);
+    fresh.call(fresh.function("add"), arguments);
+  }
+  std::cout << "new context and call add: " << nanoseconds(start, contexts) << " ns per call" << std::endl;
+
+  // Compiling and running a script that makes the call, as without the embedding API.
+  std::ostringstream out;
+  start = Clock::now();
+  for (size_t i = 0; i < contexts; ++i)
+    Context(Program::compile(script + "print add(" + std::to_string(i) + ", 1);\n"), out);
+  std::cout << "compile and run a script calling add: " << nanoseconds(start, contexts) << " ns per call" << std::endl;
+
+  return EXIT_SUCCESS;
+}
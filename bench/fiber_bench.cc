@@ -0,0 +1,127 @@
+/**
+ * @file fiber_bench.cc
+ * @brief Measures the cost of switching between Lox fibers, and of running many of them.
+ *
+ * Two fibers hand over to each other with `yield_now()` in a loop, then two native
+ * fibers do the same, to time the switch on its own, and fibers are started that
+ * finish at once. Then two fibers count without giving way, switched out by their
+ * quantum only, and thousands of fibers sleep in a loop like timers.
+ * Usage: fiber_bench [number of switches]
+ */
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "Program.h"
+#include "Scheduler.h"
+
+/**
+ * @brief A native function that gives way to the other fibers a number of times.
+ */
+class Yielder : public LoxCallable
+{
+public:
+  /**
+   * @brief Constructs the function.
+   * @param times How many times to give way per call.
+   */
+  Yielder(const size_t& times)
+    : _times(times) {}
+
+  /**
+   * @brief Gives way to the other fibers, then returns nil.
+   */
+  LiteralValue call(Interpreter& interpreter, const std::vector<LiteralValue>&) override
+  {
+    for (size_t i = 0; i < _times; ++i)
+      interpreter.scheduler().yield();
+    return std::monostate();
+  }
+
+  /**
+   * @brief Returns a string representation of the function.
+   */
+  std::string toString() override { return "<native fn>"; }
+
+private:
+  size_t _times; ///< How many times to give way.
+};
+
+/**
+ * @brief Times one call of a Lox function.
+ * @param context The context the benchmark script has run in.
+ * @param name The name of the function.
+ * @param arguments The arguments to pass.
+ * @return The time taken in nanoseconds.
+ */
+double measure(Context& context, const std::string& name, const std::vector<LiteralValue>& arguments)
+{
+  Context::Function function = context.function(name);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  context.call(function, arguments);
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Main function.
+ * @param argc Number of command line arguments.
+ * @param argv Array of command line argument strings.
+ * @return Returns EXIT_SUCCESS.
+ */
+int main(int argc, char* argv[])
+{
+  const size_t switches = argc > 1 ? std::stoul(argv[1]) : 1000000;
+
+  // Locals are parameters and loop variables only: `var` inside a function declares
+  // in the top-level scope, so it would be shared by every call.
+  std::shared_ptr<const Program> program = Program::compile(
+    "fun bounce(n) { for (var i in 0..n) yield_now(); }\n"
+    "fun pingpong(n) { join(fiber(bounce, n / 2), fiber(bounce, n / 2)); }\n"
+    "fun join(a, b) { a(); b(); }\n"
+    "fun count(n, sum) { for (var i in 0..n) sum = sum + i; return sum; }\n"
+    "fun alone(n) { count(n, 0); }\n"
+    "fun interleaved(n) { join(fiber(count, n / 2, 0), fiber(count, n / 2, 0)); }\n"
+    "fun timer(ticks) { for (var i in 0..ticks) sleep(1); }\n"
+    "fun timers(n) { for (var i in 0..n) fiber(timer, 10); }\n");
+
+  Context context(program);
+  Interpreter& interpreter = context.interpreter();
+
+  double elapsed = measure(context, "pingpong", { static_cast<double>(switches) });
+  std::cout << "yield_now() between two fibers: " << elapsed / switches << " ns per switch" << std::endl;
+
+  // Switching between fibers that run no Lox code at all.
+  Scheduler& scheduler = interpreter.scheduler();
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  scheduler.start(std::make_shared<Yielder>(switches / 2), {});
+  scheduler.start(std::make_shared<Yielder>(switches / 2), {});
+  interpreter.joinFibers();
+  elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "Scheduler::yield() between two fibers: " << elapsed / switches << " ns per switch" << std::endl;
+
+  // Each yield of the main fiber switches to a new fiber with nothing to do, and back.
+  start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < switches / 2; ++i)
+  {
+    scheduler.start(std::make_shared<Yielder>(0), {});
+    scheduler.yield();
+  }
+  elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "Fiber started, run and finished: " << elapsed / (switches / 2) << " ns" << std::endl;
+
+  const double alone = measure(context, "alone", { static_cast<double>(switches) });
+  const double interleaved = measure(context, "interleaved", { static_cast<double>(switches) });
+  std::cout << "Counting to " << switches << ": " << alone / switches << " ns per iteration alone, "
+            << interleaved / switches << " ns split between two fibers" << std::endl;
+
+  for (size_t count : { 1000, 10000 })
+  {
+    start = std::chrono::steady_clock::now();
+    context.call(context.function("timers"), { static_cast<double>(count) });
+    interpreter.joinFibers();
+    elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << count << " fibers sleeping 1 ms 10 times: " << elapsed << " ms" << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,85 @@
+/**
+ * @file generator_bench.cc
+ * @brief Measures the cost of taking values from a Lox generator, in time and in heap
+ *        allocations.
+ *
+ * The same numbers are summed by a range loop, by a `for` loop over a generator, by
+ * calling the generator in a `while` loop, and over a generator yielding from a
+ * nested loop. Every allocation is counted by replacing the global `operator new`.
+ * Usage: generator_bench [number of values]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+#include "Program.h"
+
+namespace
+{
+  std::atomic<size_t> allocations = 0; ///< The number of calls to `operator new` so far.
+}
+
+void* operator new(size_t size)
+{
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* memory = std::malloc(size == 0 ? 1 : size)) return memory;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+
+/**
+ * @brief Times one call of a Lox function taking the number of values, and counts
+ *        the allocations it makes.
+ * @param context The context the benchmark script has run in.
+ * @param name The name of the function.
+ * @param values The number of values to take.
+ */
+void measure(Context& context, const std::string& name, const size_t& values)
+{
+  Context::Function function = context.function(name);
+  std::vector<LiteralValue> arguments = { static_cast<double>(values) };
+
+  const size_t before = allocations.load(std::memory_order_relaxed);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  context.call(function, arguments);
+  double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  const size_t allocated = allocations.load(std::memory_order_relaxed) - before;
+
+  std::cout << name << ": " << elapsed / values << " ns, "
+            << static_cast<double>(allocated) / values << " allocations per value" << std::endl;
+}
+
+/**
+ * @brief Main function.
+ * @param argc Number of command line arguments.
+ * @param argv Array of command line argument strings.
+ * @return Returns EXIT_SUCCESS.
+ */
+int main(int argc, char* argv[])
+{
+  const size_t values = argc > 1 ? std::stoul(argv[1]) : 1000000;
+
+  // Locals are parameters and loop variables only: `var` inside a function declares
+  // in the top-level scope, so it would be shared by every call.
+  std::shared_ptr<const Program> program = Program::compile(
+    "fun numbers(n) { for (var i in 0..n) yield i; }\n"
+    "fun rows(n) { for (var i in 0..n / 100) for (var j in 0..100) yield i * 100 + j; }\n"
+    "fun range(n) { total(0, n); }\n"
+    "fun total(sum, n) { for (var i in 0..n) sum = sum + i; return sum; }\n"
+    "fun iterated(n) { iterate(0, numbers(n)); }\n"
+    "fun iterate(sum, values) { for (var v in values) sum = sum + v; return sum; }\n"
+    "fun called(n) { call(0, numbers(n), nil); }\n"
+    "fun call(sum, values, v) { v = values(); while (v != nil) { sum = sum + v; v = values(); } return sum; }\n"
+    "fun nested(n) { iterate(0, rows(n)); }\n");
+
+  Context context(program);
+  for (const char* name : { "range", "iterated", "called", "nested" })
+    measure(context, name, values);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,110 @@
+/**
+ * @file incremental_bench.cc
+ * @brief Measures the latency of reparsing a large generated Lox script after each
+ *        keystroke, incrementally and from scratch.
+ *
+ * A string literal in the middle of the script is typed into one character at a
+ * time, then a line is added and removed above it, as an editor would send them.
+ * Usage: incremental_bench [number of generated functions]
+ */
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "IncrementalParser.h"
+#include "Parser.h"
+#include "Scanner.h"
+#include "Source.h"
+
+/**
+ * @brief Generates a script of small functions, seven lines each.
+ * @param functions The number of function declarations to generate.
+ * @return The generated Lox source code.
+ */
+std::string generateScript(const size_t& functions)
+{
+  std::string source;
+  for (size_t i = 0; i < functions; ++i)
+  {
+    std::string n = std::to_string(i);
+    source += "fun f" + n + "(a, b) {\n"
+              "  var x = a * (b + " + n + ") - a / 2;\n"
+              "  if (x >= 10 and b != nil or !a) x = x < 3 ? -a : b;\n"
+              "  while (x <= " + n + ") x += 1;\n"
+              "  return f" + n + "(x, a + b, \"s\") == true;\n"
+              "}\n"
+              "print f" + n + "(1, 2), 3;\n";
+  }
+  return source;
+}
+
+/**
+ * @brief An edit as sent by an editor.
+ */
+struct Edit
+{
+  size_t offset; /**< Offset of the replaced text */
+  size_t removed; /**< Length of the replaced text */
+  std::string inserted; /**< Text inserted in its place */
+};
+
+/**
+ * @brief Main function.
+ * @param argc Number of command line arguments.
+ * @param argv Array of command line argument strings.
+ * @return Returns EXIT_SUCCESS, or EXIT_FAILURE if the two parsers disagree.
+ */
+int main(int argc, char* argv[])
+{
+  const size_t functions = argc > 1 ? std::stoul(argv[1]) : 3000;
+
+  std::string text = generateScript(functions);
+  size_t target = text.find("\"s\"", text.size() / 2) + 2;
+  size_t line = text.rfind("fun ", target);
+
+  std::vector<Edit> edits;
+  for (char c : std::string("hello, world"))
+    edits.push_back({ target++, 0, std::string(1, c) });
+  edits.push_back({ line, 0, "var y = 1;\n" });
+  edits.push_back({ line, 11, "" });
+
+  auto start = std::chrono::steady_clock::now();
+  Lox::Reporter reporter;
+  IncrementalParser incremental(text, reporter);
+  double opened = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  double incremental_total = 0;
+  double full_total = 0;
+  size_t reparsed = 0;
+  size_t statements = 0;
+  for (const Edit& edit : edits)
+  {
+    start = std::chrono::steady_clock::now();
+    incremental.edit(edit.offset, edit.removed, edit.inserted);
+    incremental_total += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    reparsed += incremental.reparsed();
+
+    text.replace(edit.offset, edit.removed, edit.inserted);
+    start = std::chrono::steady_clock::now();
+    Source source(text);
+    Scanner scanner(source, reporter);
+    statements = Parser<LiteralValue>(scanner, reporter).parse().size();
+    full_total += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  if (incremental.text() != text || incremental.statements().size() != statements)
+  {
+    std::cout << "incremental parse differs from full parse" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "opened " << text.size() / 1e6 << " MB (" << incremental.segments().size()
+            << " segments) in " << opened * 1e3 << " ms" << std::endl;
+  std::cout << "full reparse: " << full_total / edits.size() * 1e3 << " ms per edit" << std::endl;
+  std::cout << "incremental reparse: " << incremental_total / edits.size() * 1e3 << " ms per edit, "
+            << reparsed / edits.size() << " bytes rebuilt per edit" << std::endl;
+
+  return EXIT_SUCCESS;
+}
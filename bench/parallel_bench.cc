@@ -0,0 +1,93 @@
+/**
+ * @file parallel_bench.cc
+ * @brief Measures how CPU-bound Lox callbacks scale with `parallel_for` and `spawn`,
+ *        and recursive calls with automatic fork-join.
+ *
+ * The same callbacks are run in a plain loop, then with `parallel_for` and with one
+ * spawned task per item on task runtimes of 1 to 16 workers. A recursive Fibonacci
+ * function is likewise run in order, then with its pure calls forked. The runtime's size is
+ * fixed once it starts, so each size is measured in a child process of its own.
+ * Usage: parallel_bench [number of items] [loop iterations per item]
+ */
+
+#include <bit>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Program.h"
+#include "TaskRuntime.h"
+
+/**
+ * @brief Times one call of a Lox function taking the number of items.
+ * @param context The context the benchmark script has run in.
+ * @param name The name of the function.
+ * @param items The number of items to process.
+ * @return The time taken in milliseconds.
+ */
+double measure(Context& context, const std::string& name, const size_t& items)
+{
+  Context::Function function = context.function(name);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  context.call(function, { static_cast<double>(items) });
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Main function.
+ * @param argc Number of command line arguments.
+ * @param argv Array of command line argument strings.
+ * @return Returns EXIT_SUCCESS.
+ */
+int main(int argc, char* argv[])
+{
+  const size_t items = argc > 1 ? std::stoul(argv[1]) : 64;
+  const std::string iterations = argc > 2 ? argv[2] : "20000";
+
+  // Locals are parameters and loop variables only: `var` inside a function declares
+  // in the top-level scope, so it would be shared by every call.
+  std::shared_ptr<const Program> program = Program::compile(
+    "fun spin(i, j, total) {\n"
+    "  while (j < " + iterations + ") { total = total + j * i; j = j + 1; }\n"
+    "  return total;\n"
+    "}\n"
+    "fun work(i) { return spin(i, 0, 0); }\n"
+    "fun sequential(n) { for (var i in 0..n) work(i); }\n"
+    "fun parallel(n) { parallel_for(0, n, work); }\n"
+    "fun spawned(n) { if (n > 0) finish(spawn(work, n - 1), n - 1); }\n"
+    "fun finish(task, n) { spawned(n); await(task); }\n"
+    "fun fib(n) { if (n <= 1) return n; return fib(n - 2) + fib(n - 1); }\n");
+  const size_t fib = 22;
+
+  double baseline, fib_baseline;
+  {
+    Context context(program);
+    baseline = measure(context, "sequential", items);
+    std::cout << "sequential loop: " << baseline << " ms" << std::endl;
+    fib_baseline = measure(context, "fib", fib);
+    std::cout << "sequential fib(" << fib << "): " << fib_baseline << " ms" << std::endl;
+  }
+
+  for (unsigned threads = 1; threads <= 16; threads *= 2)
+  {
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+      TaskRuntime::setThreads(threads);
+      Context context(program);
+      double parallel = measure(context, "parallel", items);
+      double spawned = measure(context, "spawned", items);
+      context.interpreter().setParallelDepth(std::bit_width(4 * threads - 1));
+      double forked = measure(context, "fib", fib);
+      std::cout << threads << " workers: parallel_for " << parallel << " ms (" << baseline / parallel << "x), "
+                << "spawn " << spawned << " ms (" << baseline / spawned << "x), "
+                << "forked fib " << forked << " ms (" << fib_baseline / forked << "x)" << std::endl;
+      _exit(EXIT_SUCCESS);
+    }
+    waitpid(pid, nullptr, 0);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,113 @@
+/**
+ * @file parser_bench.cc
+ * @brief Measures parser throughput on a large generated Lox script.
+ *
+ * The script is first scanned once up front so that only `Parser<R>::parse` is timed,
+ * then scanned and parsed together with the parser pulling tokens on demand, and
+ * finally with function bodies only brace-matched, as none of them are called.
+ * Usage: parser_bench [number of generated functions]
+ */
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Parser.h"
+#include "Scanner.h"
+#include "Source.h"
+#include "Token.h"
+
+/**
+ * @brief Generates a script exercising every expression precedence level.
+ * @param functions The number of function declarations to generate.
+ * @return The generated Lox source code.
+ */
+std::string generateScript(const size_t& functions)
+{
+  std::string source;
+  for (size_t i = 0; i < functions; ++i)
+  {
+    std::string n = std::to_string(i);
+    source += "fun f" + n + "(a, b) {\n"
+              "  var x = a * (b + " + n + ") - a / 2;\n"
+              "  if (x >= 10 and b != nil or !a) x = x < 3 ? -a : b;\n"
+              "  while (x <= " + n + ") x += 1;\n"
+              "  return f" + n + "(x, a + b, \"s\") == true;\n"
+              "}\n"
+              "print f" + n + "(1, 2), 3;\n";
+  }
+  return source;
+}
+
+/**
+ * @brief Main function.
+ * @param argc Number of command line arguments.
+ * @param argv Array of command line argument strings.
+ * @return Returns EXIT_SUCCESS.
+ */
+int main(int argc, char* argv[])
+{
+  const size_t functions = argc > 1 ? std::stoul(argv[1]) : 20000;
+  const int rounds = 5;
+
+  Lox::Reporter reporter;
+  Source source(generateScript(functions));
+  std::vector<Token> tokens = Scanner(source, reporter).scanTokens();
+
+  double best = 0;
+  for (int round = 0; round < rounds; ++round)
+  {
+    Parser<LiteralValue> parser(tokens, reporter);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::shared_ptr<Stmt<LiteralValue>>> statements = parser.parse();
+    auto stop = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(stop - start).count();
+    if (round == 0 || seconds < best)
+      best = seconds;
+  }
+
+  std::cout << "parsed " << tokens.size() << " tokens ("
+            << source.text().size() / 1e6 << " MB) in " << best * 1e3 << " ms: "
+            << tokens.size() / best / 1e6 << " Mtokens/s, "
+            << source.text().size() / best / 1e6 << " MB/s" << std::endl;
+
+  // Scan and parse together, with the parser pulling tokens from the scanner on demand.
+  for (int round = 0; round < rounds; ++round)
+  {
+    auto start = std::chrono::steady_clock::now();
+    Scanner scanner(source, reporter);
+    Parser<LiteralValue> parser(scanner, reporter);
+    std::vector<std::shared_ptr<Stmt<LiteralValue>>> statements = parser.parse();
+    auto stop = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(stop - start).count();
+    if (round == 0 || seconds < best)
+      best = seconds;
+  }
+
+  std::cout << "scanned and parsed on demand in " << best * 1e3 << " ms: "
+            << source.text().size() / best / 1e6 << " MB/s" << std::endl;
+
+  // Parse function bodies lazily, i.e. not at all since nothing is called.
+  for (int round = 0; round < rounds; ++round)
+  {
+    auto start = std::chrono::steady_clock::now();
+    Scanner scanner(source, reporter);
+    Parser<LiteralValue> parser(scanner, reporter);
+    parser.setLazyFunctions(true);
+    std::vector<std::shared_ptr<Stmt<LiteralValue>>> statements = parser.parse();
+    auto stop = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(stop - start).count();
+    if (round == 0 || seconds < best)
+      best = seconds;
+  }
+
+  std::cout << "scanned and parsed with lazy function bodies in " << best * 1e3 << " ms: "
+            << source.text().size() / best / 1e6 << " MB/s" << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,152 @@
+/**
+ * @file record_bench.cc
+ * @brief Measures streaming the records of a large CSV file with `eachLine` and
+ *        `eachCsv`, against counting its lines in C++ and against `readLines`.
+ *
+ * Counting the line breaks of the mapped file with `memchr` is the bound set by
+ * memory bandwidth. The natives are timed with a native callback, which measures the
+ * scan on its own, then with a Lox callback, where the call of the function dominates.
+ * `readLines` copies every line into a string of its own, for comparison.
+ * Usage: record_bench [megabytes]
+ */
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Program.h"
+#include "RecordCallables.h"
+
+/**
+ * @brief A native callback that counts records and sums a field of each.
+ */
+class Summer : public LoxCallable
+{
+public:
+  /**
+   * @brief Constructs the callback.
+   * @param field The index of the field to sum, or -1 to only count records.
+   */
+  Summer(const double& field)
+    : _field(field), _arguments{ std::monostate(), field } {}
+
+  size_t arity() override { return 1; }
+
+  /**
+   * @brief Adds the field of a record to the sum, and returns nil.
+   */
+  LiteralValue call(Interpreter& interpreter, const std::vector<LiteralValue>& arguments) override
+  {
+    ++records;
+    if (_field >= 0)
+    {
+      _arguments[0] = arguments[0];
+      const LiteralValue value = _number->call(interpreter, _arguments);
+      // Holding on to the record would make `eachCsv` start a new one for the next record.
+      _arguments[0] = std::monostate();
+      if (std::holds_alternative<double>(value))
+        sum += std::get<double>(value);
+    }
+    return std::monostate();
+  }
+
+  /**
+   * @brief Returns a string representation of the callback.
+   */
+  std::string toString() override { return "<native fn>"; }
+
+  size_t records = 0; ///< The records seen.
+  double sum = 0; ///< The sum of the field.
+
+private:
+  double _field; ///< The index of the field to sum.
+  std::shared_ptr<LoxCallable> _number = std::make_shared<FieldNumberCallable>(); ///< Parses the field.
+  std::vector<LiteralValue> _arguments; ///< The record and the index, passed to `_number`.
+};
+
+/**
+ * @brief Main function.
+ * @param argc Number of command line arguments.
+ * @param argv Array of command line argument strings.
+ * @return Returns EXIT_SUCCESS.
+ */
+int main(int argc, char* argv[])
+{
+  const size_t megabytes = argc > 1 ? std::stoul(argv[1]) : 32;
+
+  const std::filesystem::path path = std::filesystem::temp_directory_path() / "cpplox_record_bench.csv";
+  {
+    std::ofstream out(path);
+    std::string row;
+    for (size_t i = 0, written = 0; written < megabytes << 20; ++i)
+    {
+      row = std::to_string(i) + ",item " + std::to_string(i % 1000) + "," + std::to_string(i % 97) + ".25,\"note, " +
+        std::to_string(i % 7) + "\"\n";
+      out << row;
+      written += row.size();
+    }
+  }
+  const double bytes = static_cast<double>(std::filesystem::file_size(path));
+
+  auto report = [&](const std::string& what, const std::chrono::steady_clock::time_point& start, const size_t& records) {
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << what << ": " << records << " records, " << bytes / seconds / (1 << 20) << " MiB/s, "
+              << seconds * 1e9 / records << " ns per record" << std::endl;
+  };
+
+  // Reads the whole file once, so every measurement finds it in the page cache.
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  {
+    const int fd = open(path.c_str(), O_RDONLY);
+    void* data = mmap(nullptr, static_cast<size_t>(bytes), PROT_READ, MAP_PRIVATE, fd, 0);
+    for (int pass = 0; pass < 2; ++pass)
+    {
+      start = std::chrono::steady_clock::now();
+      const char* text = static_cast<const char*>(data);
+      const char* end = text + static_cast<size_t>(bytes);
+      size_t lines = 0;
+      for (const char* p = text; (p = static_cast<const char*>(std::memchr(p, '\n', end - p))) != nullptr; ++p)
+        ++lines;
+      if (pass == 1) report("memchr of line breaks", start, lines);
+    }
+    munmap(data, static_cast<size_t>(bytes));
+    close(fd);
+  }
+
+  std::shared_ptr<const Program> program = Program::compile(
+    "fun count(path, native) { return eachLine(path, native); }\n"
+    "fun csv(path, native) { return eachCsv(path, native); }\n"
+    "var sum = 0;\n"
+    "fun add(n) { if (n != nil) sum = sum + n; }\n"
+    "fun row(r) { add(fieldNumber(r, 2)); }\n"
+    "fun nothing(r) {}\n"
+    "fun lox(path) { return eachCsv(path, row); }\n"
+    "fun loxLines(path) { return eachLine(path, nothing); }\n"
+    "fun copied(path, n) { for (var line in readLines(path)) n = n + 1; return n; }\n");
+  Context context(program);
+
+  auto run = [&](const std::string& what, const std::string& function, const std::vector<LiteralValue>& arguments) {
+    start = std::chrono::steady_clock::now();
+    const LiteralValue records = context.call(context.function(function), arguments);
+    report(what, start, static_cast<size_t>(std::get<double>(records)));
+  };
+
+  const std::shared_ptr<Summer> counter = std::make_shared<Summer>(-1);
+  const std::shared_ptr<Summer> summer = std::make_shared<Summer>(2);
+  run("eachLine, native callback", "count", { path.string(), std::shared_ptr<LoxCallable>(counter) });
+  run("eachCsv, native callback", "csv", { path.string(), std::shared_ptr<LoxCallable>(counter) });
+  run("eachCsv, native callback summing a field", "csv", { path.string(), std::shared_ptr<LoxCallable>(summer) });
+  run("eachLine, empty Lox callback", "loxLines", { path.string() });
+  run("eachCsv, Lox callback summing a field", "lox", { path.string() });
+  run("readLines, a string per line", "copied", { path.string(), 0.0 });
+
+  std::filesystem::remove(path);
+  return EXIT_SUCCESS;
+}
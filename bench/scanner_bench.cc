@@ -0,0 +1,107 @@
+/**
+ * @file scanner_bench.cc
+ * @brief Measures scanner throughput on a large generated Lox corpus.
+ *
+ * Every scanning kernel level supported by the CPU is measured in turn, then the
+ * best level is measured scanning on 1 to 16 threads.
+ * Usage: scanner_bench [number of generated functions]
+ */
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "ScanKernels.h"
+#include "Scanner.h"
+#include "Source.h"
+#include "Token.h"
+
+/**
+ * @brief Generates a corpus heavy in the lexemes real scripts spend their bytes on:
+ *        indentation, comments, strings and long identifiers.
+ * @param functions The number of function declarations to generate.
+ * @return The generated Lox source code.
+ */
+std::string generateCorpus(const size_t& functions)
+{
+  std::string source;
+  for (size_t i = 0; i < functions; ++i)
+  {
+    std::string n = std::to_string(i);
+    source += "// Helper number " + n + ", generated for the scanner benchmark.\n"
+              "/* It accumulates a running total over its arguments and\n"
+              "   returns a descriptive message along with the total. */\n"
+              "fun accumulate_running_total_" + n + "(first_argument, second_argument) {\n"
+              "        var running_total_value = first_argument * 2 + second_argument;\n"
+              "        if (running_total_value >= " + n + ") {\n"
+              "                print \"the running total exceeded the configured limit\";\n"
+              "        }\n"
+              "        return running_total_value;\n"
+              "}\n\n";
+  }
+  return source;
+}
+
+/**
+ * @brief Main function.
+ * @param argc Number of command line arguments.
+ * @param argv Array of command line argument strings.
+ * @return Returns EXIT_SUCCESS.
+ */
+int main(int argc, char* argv[])
+{
+  const size_t functions = argc > 1 ? std::stoul(argv[1]) : 50000;
+  const int rounds = 5;
+
+  Lox::Reporter reporter;
+  Source source(generateCorpus(functions));
+
+  const char* names[] = { "scalar", "sse2", "avx2" };
+  for (int level = ScanKernels::SCALAR; level <= ScanKernels::supported(); ++level)
+  {
+    ScanKernels::select(static_cast<ScanKernels::Level>(level));
+
+    double best = 0;
+    size_t tokens = 0;
+    for (int round = 0; round < rounds; ++round)
+    {
+      auto start = std::chrono::steady_clock::now();
+      Scanner scanner(source, reporter);
+      tokens = 0;
+      while (scanner.nextToken().type != END)
+        ++tokens;
+      auto stop = std::chrono::steady_clock::now();
+
+      double seconds = std::chrono::duration<double>(stop - start).count();
+      if (round == 0 || seconds < best)
+        best = seconds;
+    }
+
+    std::cout << names[level] << ": scanned " << tokens << " tokens (" << source.text().size() / 1e6
+              << " MB) in " << best * 1e3 << " ms: "
+              << source.text().size() / best / 1e6 << " MB/s" << std::endl;
+  }
+
+  // Scan the whole source on a growing number of threads.
+  ScanKernels::select(ScanKernels::supported());
+  for (unsigned jobs = 1; jobs <= 16; jobs *= 2)
+  {
+    double best = 0;
+    size_t tokens = 0;
+    for (int round = 0; round < rounds; ++round)
+    {
+      auto start = std::chrono::steady_clock::now();
+      tokens = Scanner(source, reporter).scanTokens(jobs).size() - 1;
+      auto stop = std::chrono::steady_clock::now();
+
+      double seconds = std::chrono::duration<double>(stop - start).count();
+      if (round == 0 || seconds < best)
+        best = seconds;
+    }
+
+    std::cout << jobs << " jobs: scanned " << tokens << " tokens in " << best * 1e3 << " ms: "
+              << source.text().size() / best / 1e6 << " MB/s" << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
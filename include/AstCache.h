@@ -0,0 +1,94 @@
+/**
+ * @file AstCache.h
+ * @brief On-disk cache of parsed programs, so that scripts that have not changed
+ *        skip scanning and parsing on later runs.
+ *
+ * A cache entry is a binary serialization of the syntax tree of a script, named
+ * after a hash of the script's text, of the interpreter build that wrote it and of
+ * whether function bodies were parsed lazily.
+ * Tokens are stored as offsets into the script, so the script itself is still
+ * loaded and every token refers to it as usual.
+ */
+
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Expr.h"
+#include "Source.h"
+#include "Stmt.h"
+#include "Token.h"
+
+namespace AstCache
+{
+  /**
+   * @brief Identifies the interpreter build, since the format follows the syntax tree classes.
+   * @return The version string.
+   */
+  std::string_view version();
+
+  /**
+   * @brief Serializes statements into the binary format of cache entries.
+   * @param statements The statements to serialize.
+   * @param functions If given, receives every function declaration written, in order.
+   * @return The serialized bytes.
+   */
+  std::string serialize(const std::vector<std::shared_ptr<Stmt<LiteralValue>>>& statements,
+                        std::vector<const Stmt<LiteralValue>::Function*>* functions = nullptr);
+
+  /**
+   * @brief Rebuilds statements from their serialization.
+   * @param data The serialized bytes.
+   * @param source The script the tokens refer to, which must be the one serialized.
+   * @param functions If given, receives every function declaration read, in the order written.
+   * @return The statements.
+   * @throws std::runtime_error if the data is malformed.
+   */
+  std::vector<std::shared_ptr<Stmt<LiteralValue>>> deserialize(std::string_view data, const Source& source,
+                                                               std::vector<const Stmt<LiteralValue>::Function*>* functions = nullptr);
+
+  /**
+   * @brief Returns the directory entries are kept in when none is given.
+   * @return `$XDG_CACHE_HOME/cpplox` or `$HOME/.cache/cpplox`, or an empty string
+   *         if neither variable is set.
+   */
+  std::string defaultDirectory();
+
+  /**
+   * @brief Returns the path of the entry for a script.
+   * @param directory The cache directory.
+   * @param source The script.
+   * @param lazy Whether function bodies are parsed on their first call.
+   * @return The path the script's entry is stored at.
+   */
+  std::string entryPath(const std::string& directory, const Source& source, const bool& lazy);
+
+  /**
+   * @brief Loads the cached syntax tree of a script.
+   * @param directory The cache directory.
+   * @param source The script, which the loaded tokens will refer to.
+   * @param lazy Whether function bodies are parsed on their first call.
+   * @return The top-level statements, or nothing if there is no valid entry.
+   */
+  std::optional<std::vector<std::shared_ptr<Stmt<LiteralValue>>>> load(const std::string& directory, const Source& source,
+                                                                       const bool& lazy);
+
+  /**
+   * @brief Stores the syntax tree of a script, which must have parsed without errors.
+   *
+   * Function bodies that have not been parsed yet are stored as such, and are
+   * parsed on first call after being loaded too.
+   *
+   * @param directory The cache directory, created if needed.
+   * @param source The script.
+   * @param lazy Whether function bodies were left to be parsed on their first call.
+   * @param statements The top-level statements of the script.
+   * @return False if the entry could not be written.
+   */
+  bool store(const std::string& directory, const Source& source, const bool& lazy,
+             const std::vector<std::shared_ptr<Stmt<LiteralValue>>>& statements);
+}
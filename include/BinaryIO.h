@@ -0,0 +1,117 @@
+/**
+ * @file BinaryIO.h
+ * @brief Helpers to write and read the compact binary formats of the on-disk caches.
+ *
+ * Values are stored in the native byte order and layout, so the files are only
+ * meant to be read back by the same build of the interpreter.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+/**
+ * @class BinaryWriter
+ * @brief Appends values to a byte buffer.
+ */
+class BinaryWriter
+{
+public:
+  std::string buffer; ///< The bytes written so far.
+
+  /**
+   * @brief Appends the bytes of a trivially copyable value.
+   * @param value The value to append.
+   */
+  template <class T>
+  void raw(const T& value)
+  {
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  /**
+   * @brief Appends a size or count.
+   * @param value The size to append.
+   */
+  void size(const size_t& value) { raw(static_cast<uint64_t>(value)); }
+
+  /**
+   * @brief Appends a length-prefixed string.
+   * @param value The string to append.
+   */
+  void string(std::string_view value)
+  {
+    size(value.size());
+    buffer.append(value);
+  }
+};
+
+/**
+ * @class BinaryReader
+ * @brief Reads values back from a byte buffer, throwing `std::runtime_error` when
+ *        the buffer is truncated or malformed.
+ */
+class BinaryReader
+{
+public:
+  /**
+   * @brief Constructs a reader at the start of the given buffer.
+   * @param buffer The bytes to read, which must outlive the reader.
+   */
+  BinaryReader(std::string_view buffer)
+    : _buffer(buffer) {}
+
+  /**
+   * @brief Checks whether every byte has been read.
+   * @return True if the reader is at the end of the buffer.
+   */
+  bool atEnd() const { return _position == _buffer.size(); }
+
+  /**
+   * @brief Reads the bytes of a trivially copyable value.
+   * @return The value read.
+   */
+  template <class T>
+  T raw()
+  {
+    if (_buffer.size() - _position < sizeof(T)) throw std::runtime_error("Truncated binary data.");
+
+    T value;
+    std::memcpy(&value, _buffer.data() + _position, sizeof(T));
+    _position += sizeof(T);
+    return value;
+  }
+
+  /**
+   * @brief Reads a size or count, which can be no larger than the buffer.
+   * @return The size read.
+   */
+  size_t size()
+  {
+    uint64_t value = raw<uint64_t>();
+    if (value > _buffer.size()) throw std::runtime_error("Malformed binary data.");
+    return value;
+  }
+
+  /**
+   * @brief Reads a length-prefixed string.
+   * @return A view of the string in the buffer.
+   */
+  std::string_view string()
+  {
+    size_t length = size();
+    if (_buffer.size() - _position < length) throw std::runtime_error("Truncated binary data.");
+
+    std::string_view value = _buffer.substr(_position, length);
+    _position += length;
+    return value;
+  }
+
+private:
+  std::string_view _buffer; ///< The bytes being read.
+  size_t _position = 0; ///< The position of the next byte to read.
+};
@@ -0,0 +1,86 @@
+/**
+ * @file BoundedQueue.h
+ * @brief Header file for the BoundedQueue class, a blocking queue of limited capacity
+ *        used to hand work from one thread to another.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+/**
+ * @class BoundedQueue
+ * @brief A first-in first-out queue that blocks producers while it is full and
+ *        consumers while it is empty.
+ *
+ * Either side may close the queue: pending items can still be popped, but nothing
+ * more can be pushed, and blocked threads are woken up.
+ *
+ * @tparam T The type of the queued items.
+ */
+template <class T>
+class BoundedQueue
+{
+public:
+  /**
+   * @brief Constructs an empty queue.
+   * @param capacity The maximum number of items held at once.
+   */
+  BoundedQueue(const size_t& capacity)
+    : _capacity(capacity) {}
+
+  /**
+   * @brief Appends an item, waiting for room if the queue is full.
+   * @param item The item to append.
+   * @return False if the queue was closed, in which case the item is dropped.
+   */
+  bool push(T item)
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _not_full.wait(lock, [this] { return _closed || _items.size() < _capacity; });
+    if (_closed) return false;
+
+    _items.push_back(std::move(item));
+    _not_empty.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief Removes the oldest item, waiting for one if the queue is empty.
+   * @return The item, or nothing once the queue is closed and drained.
+   */
+  std::optional<T> pop()
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _not_empty.wait(lock, [this] { return _closed || !_items.empty(); });
+    if (_items.empty()) return std::nullopt;
+
+    T item = std::move(_items.front());
+    _items.pop_front();
+    _not_full.notify_one();
+    return item;
+  }
+
+  /**
+   * @brief Closes the queue, waking up every waiting thread.
+   */
+  void close()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _closed = true;
+    _not_full.notify_all();
+    _not_empty.notify_all();
+  }
+
+private:
+  const size_t _capacity; ///< The maximum number of items held at once.
+  std::deque<T> _items; ///< The queued items, oldest first.
+  bool _closed = false; ///< Whether the queue has been closed.
+  std::mutex _mutex; ///< Guards every member above.
+  std::condition_variable _not_full; ///< Signalled when an item is popped or the queue closes.
+  std::condition_variable _not_empty; ///< Signalled when an item is pushed or the queue closes.
+};
@@ -0,0 +1,181 @@
+/**
+ * @file Channel.h
+ * @brief Header file for the Channel class, a lock-free bounded queue that threads
+ *        send values through.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+/**
+ * @class Channel
+ * @brief A first-in first-out queue of fixed capacity that any number of threads
+ *        send to and receive from without taking a lock.
+ *
+ * Every slot carries a sequence number telling whether it is ready to be written or
+ * read in the current lap around the ring, so senders and receivers only contend on
+ * the position they claim with a compare-and-swap. Blocking sends and receives sleep
+ * on an atomic counter that the other side bumps, and never spin for long.
+ *
+ * Once closed, sends fail, and receives drain what is left before failing as well.
+ *
+ * @tparam T The type of the values sent.
+ */
+template <class T>
+class Channel
+{
+public:
+  /**
+   * @brief Constructs an empty channel.
+   * @param capacity The number of values held at once, rounded up to a power of two.
+   */
+  Channel(const size_t& capacity)
+    : _cells(new Cell[std::bit_ceil(std::max<size_t>(capacity, 2))]),
+      _mask(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1)
+  {
+    for (size_t i = 0; i <= _mask; ++i)
+      _cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Appends a value if there is room, without waiting.
+   * @param value The value, moved from only if it is appended.
+   * @return False if the channel is full.
+   */
+  bool trySend(T& value)
+  {
+    size_t position = _tail.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      Cell& cell = _cells[position & _mask];
+      const std::intptr_t lap = static_cast<std::intptr_t>(cell.sequence.load(std::memory_order_acquire) - position);
+      if (lap == 0)
+      {
+        if (_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+        {
+          cell.value = std::move(value);
+          cell.sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (lap < 0)
+        return false;
+      else
+        position = _tail.load(std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief Removes the oldest value if there is one, without waiting.
+   * @return The value, or nothing if the channel is empty.
+   */
+  std::optional<T> tryReceive()
+  {
+    size_t position = _head.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      Cell& cell = _cells[position & _mask];
+      const std::intptr_t lap = static_cast<std::intptr_t>(cell.sequence.load(std::memory_order_acquire) - (position + 1));
+      if (lap == 0)
+      {
+        if (_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+        {
+          T value = std::move(cell.value);
+          cell.sequence.store(position + _mask + 1, std::memory_order_release);
+          return value;
+        }
+      }
+      else if (lap < 0)
+        return std::nullopt;
+      else
+        position = _head.load(std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief Appends a value, waiting for room if the channel is full.
+   * @param value The value to append.
+   * @return False if the channel was closed, in which case the value is dropped.
+   */
+  bool send(T value)
+  {
+    for (;;)
+    {
+      if (_closed.load(std::memory_order_acquire)) return false;
+
+      // Read before trying, so that a receive in between wakes the wait up at once.
+      const uint32_t received = _received.load(std::memory_order_acquire);
+      if (trySend(value))
+      {
+        _sent.fetch_add(1, std::memory_order_release);
+        _sent.notify_all();
+        return true;
+      }
+      _received.wait(received, std::memory_order_acquire);
+    }
+  }
+
+  /**
+   * @brief Removes the oldest value, waiting for one if the channel is empty.
+   * @return The value, or nothing once the channel is closed and drained.
+   */
+  std::optional<T> receive()
+  {
+    for (;;)
+    {
+      const uint32_t sent = _sent.load(std::memory_order_acquire);
+      const bool closed = _closed.load(std::memory_order_acquire);
+      if (std::optional<T> value = tryReceive())
+      {
+        _received.fetch_add(1, std::memory_order_release);
+        _received.notify_all();
+        return value;
+      }
+      if (closed) return std::nullopt;
+      _sent.wait(sent, std::memory_order_acquire);
+    }
+  }
+
+  /**
+   * @brief Closes the channel, waking up every waiting thread.
+   */
+  void close()
+  {
+    _closed.store(true, std::memory_order_release);
+    _sent.fetch_add(1, std::memory_order_release);
+    _sent.notify_all();
+    _received.fetch_add(1, std::memory_order_release);
+    _received.notify_all();
+  }
+
+  /**
+   * @brief Returns the number of values held at once.
+   * @return The capacity, a power of two.
+   */
+  size_t capacity() const { return _mask + 1; }
+
+private:
+  /**
+   * @brief A slot of the ring.
+   */
+  struct Cell
+  {
+    std::atomic<size_t> sequence; /**< The position it is next written at, or that plus one once written */
+    T value; /**< The value, valid between a send and the matching receive */
+  };
+
+  std::unique_ptr<Cell[]> _cells; ///< The ring of slots.
+  const size_t _mask; ///< The capacity minus one, to wrap positions around the ring.
+  alignas(64) std::atomic<size_t> _tail = 0; ///< The position of the next send.
+  alignas(64) std::atomic<size_t> _head = 0; ///< The position of the next receive.
+  alignas(64) std::atomic<uint32_t> _sent = 0; ///< Bumped after every send, for receivers to wait on.
+  alignas(64) std::atomic<uint32_t> _received = 0; ///< Bumped after every receive, for senders to wait on.
+  std::atomic<bool> _closed = false; ///< Whether the channel has been closed.
+};
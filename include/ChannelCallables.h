@@ -0,0 +1,194 @@
+/**
+ * @file ChannelCallables.h
+ * @brief The native functions that pass messages between workers: `channel`, `send`,
+ *        `recv` and `close`, and the channels they work on.
+ *
+ * Workers, started with `worker` (see TaskCallables.h), share nothing but the channels
+ * passed to them, so pipelines of them need no locks on interpreter state.
+ *
+ * Channels only carry values that cannot be changed once sent: numbers, strings,
+ * booleans and nil. A string is copied once into the channel and moved out of it by
+ * the receiver. An interpreter waits for its workers before it is destroyed, so a
+ * worker receiving from a channel must be sent a value or see the channel closed.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Channel.h"
+#include "Interpreter.h"
+#include "LoxCallable.h"
+
+/**
+ * @brief A channel as a Lox value, which receives the next value when called.
+ */
+class LoxChannel : public LoxCallable
+{
+public:
+  /**
+   * @brief Constructs an empty channel.
+   * @param capacity The number of values held at once, rounded up to a power of two.
+   */
+  LoxChannel(const size_t& capacity)
+    : _channel(capacity) {}
+
+  /**
+   * @brief Sends a value, waiting for room if the channel is full.
+   * @param value A number, string, boolean or nil.
+   * @return False if the channel was closed.
+   */
+  bool send(const LiteralValue& value) { return _channel.send(value); }
+
+  /**
+   * @brief Receives the oldest value, waiting for one if the channel is empty.
+   * @return The value, or nil once the channel is closed and drained.
+   */
+  LiteralValue receive() { return _channel.receive().value_or(std::monostate()); }
+
+  /**
+   * @brief Closes the channel, waking up every sender and receiver waiting on it.
+   */
+  void close() { _channel.close(); }
+
+  /**
+   * @brief Receives the oldest value.
+   *
+   * @param interpreter The interpreter receiving (unused).
+   * @param arguments No arguments.
+   * @return The value, or nil once the channel is closed and drained.
+   */
+  LiteralValue call(Interpreter&, const std::vector<LiteralValue>&) override { return receive(); }
+
+  /**
+   * @brief Returns a string representation of the channel.
+   *
+   * @return A string indicating that this is a channel.
+   */
+  std::string toString() override { return "<channel>"; }
+
+private:
+  Channel<LiteralValue> _channel; ///< The values in flight.
+};
+
+/**
+ * @brief The `channel(capacity)` native, which creates an empty channel.
+ */
+class ChannelCallable : public LoxCallable
+{
+  /**
+   * @brief Returns the number of arguments required by `channel`.
+   *
+   * @return 1.
+   */
+  size_t arity() override { return 1; }
+
+  /**
+   * @brief Creates a channel holding at least the given number of values at once.
+   *
+   * @param interpreter The interpreter creating the channel (unused).
+   * @param arguments The capacity.
+   * @return The channel.
+   * @throws NativeError if the capacity is not a number from 1 to 2^20.
+   */
+  LiteralValue call(Interpreter&, const std::vector<LiteralValue>& arguments) override;
+
+  /**
+   * @brief Returns a string representation of the `channel` function.
+   *
+   * @return A string indicating that this is a native function.
+   */
+  std::string toString() override { return "<native fn>"; }
+};
+
+/**
+ * @brief The `send(ch, value)` native, which sends a value, waiting for room.
+ */
+class SendCallable : public LoxCallable
+{
+  /**
+   * @brief Returns the number of arguments required by `send`.
+   *
+   * @return 2.
+   */
+  size_t arity() override { return 2; }
+
+  /**
+   * @brief Sends the value to the channel.
+   *
+   * @param interpreter The interpreter sending (unused).
+   * @param arguments The channel and the value.
+   * @return True, or false if the channel was closed.
+   * @throws NativeError if the first argument is not a channel or the value cannot be sent.
+   */
+  LiteralValue call(Interpreter&, const std::vector<LiteralValue>& arguments) override;
+
+  /**
+   * @brief Returns a string representation of the `send` function.
+   *
+   * @return A string indicating that this is a native function.
+   */
+  std::string toString() override { return "<native fn>"; }
+};
+
+/**
+ * @brief The `recv(ch)` native, which receives a value, waiting for one.
+ */
+class RecvCallable : public LoxCallable
+{
+  /**
+   * @brief Returns the number of arguments required by `recv`.
+   *
+   * @return 1.
+   */
+  size_t arity() override { return 1; }
+
+  /**
+   * @brief Receives the oldest value of the channel.
+   *
+   * @param interpreter The interpreter receiving (unused).
+   * @param arguments The channel.
+   * @return The value, or nil once the channel is closed and drained.
+   * @throws NativeError if the argument is not a channel.
+   */
+  LiteralValue call(Interpreter&, const std::vector<LiteralValue>& arguments) override;
+
+  /**
+   * @brief Returns a string representation of the `recv` function.
+   *
+   * @return A string indicating that this is a native function.
+   */
+  std::string toString() override { return "<native fn>"; }
+};
+
+/**
+ * @brief The `close(ch)` native, which closes a channel.
+ */
+class CloseCallable : public LoxCallable
+{
+  /**
+   * @brief Returns the number of arguments required by `close`.
+   *
+   * @return 1.
+   */
+  size_t arity() override { return 1; }
+
+  /**
+   * @brief Closes the channel.
+   *
+   * @param interpreter The interpreter closing it (unused).
+   * @param arguments The channel.
+   * @return nil.
+   * @throws NativeError if the argument is not a channel.
+   */
+  LiteralValue call(Interpreter&, const std::vector<LiteralValue>& arguments) override;
+
+  /**
+   * @brief Returns a string representation of the `close` function.
+   *
+   * @return A string indicating that this is a native function.
+   */
+  std::string toString() override { return "<native fn>"; }
+};
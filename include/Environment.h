@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 
 #include "Token.h"
@@ -38,7 +39,15 @@ public:
    * @param name The name of the variable.
    * @param value The value to assign to the variable.
    */
-  void define(const std::string& name, const LiteralValue& value);
+  void define(std::string_view name, const LiteralValue& value);
+
+  /**
+   * @brief Defines a new variable, taking over its value rather than copying it.
+   * 
+   * @param name The name of the variable.
+   * @param value The value to move into the variable.
+   */
+  void define(std::string_view name, LiteralValue&& value);
   
   /**
    * @brief Retrieves the value of a variable from the environment.
@@ -64,11 +73,59 @@ public:
    */
   void assign(const Token& name, const LiteralValue& value);
 
+  /**
+   * @brief Locates an existing variable and returns a reference to its stored value.
+   * 
+   * Lets read-modify-write operations update a variable in place with a single lookup
+   * instead of a `get` followed by an `assign`.
+   * 
+   * @param name The token representing the variable name.
+   * @return A reference to the value of the variable.
+   * @throws RuntimeError if the variable is not found in the current or enclosing environments.
+   */
+  LiteralValue& lookup(const Token& name);
+
+  /**
+   * @brief Locates a variable without throwing if it is undefined.
+   * 
+   * Searches the current environment, then the enclosing environments.
+   * 
+   * @param name The name of the variable.
+   * @return A pointer to the value of the variable, or nullptr if it is not found.
+   */
+  LiteralValue* find(std::string_view name);
+
+  /**
+   * @brief Copies the environment together with every environment enclosing it.
+   * 
+   * Unlike a plain copy, which shares its enclosing environments with the original,
+   * assignments to the snapshot never reach the original and the other way around.
+   * 
+   * @return The copy.
+   */
+  Environment snapshot() const;
+
+  /**
+   * @brief Returns the enclosing environment.
+   * 
+   * @return A shared pointer to the enclosing environment, or nullptr if there is none.
+   */
+  const std::shared_ptr<Environment>& enclosing() const { return _enclosing; }
+
+  /**
+   * @brief Returns the variables defined directly in this environment.
+   * 
+   * @return The map of variable names to their values.
+   */
+  const std::unordered_map<std::string, LiteralValue, StringHash, std::equal_to<>>& values() const { return _values; }
+
 private:
   friend class EnvironmentGuard;
+  friend class Generator;
+  friend class Scheduler;
   
   std::shared_ptr<Environment> _enclosing; ///< A shared pointer to the enclosing environment.
-  std::unordered_map<std::string, LiteralValue> _values; ///< Map of variable names to their values.
+  std::unordered_map<std::string, LiteralValue, StringHash, std::equal_to<>> _values; ///< Map of variable names to their values.
 };
 
 /**
@@ -84,12 +141,12 @@ public:
    * @brief Constructs an environment guard that changes the current environment.
    * 
    * @param current_env The current environment to be changed.
-   * @param new_env The new environment to use temporarily.
+   * @param new_env The new environment to use temporarily, moved in rather than copied.
    */
-  EnvironmentGuard(Environment& current_env, const Environment& new_env)
+  EnvironmentGuard(Environment& current_env, Environment new_env)
     : _previous_env(std::move(current_env._enclosing)), _current_env(current_env)
   {
-    _current_env._enclosing = std::move(std::make_shared<Environment>(new_env));
+    _current_env._enclosing = std::make_shared<Environment>(std::move(new_env));
   }
 
   /**
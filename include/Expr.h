@@ -17,6 +17,7 @@ public:
   class Unary;
   class Ternary;
   class Variable;
+  class Update;
 
   struct Visitor
   {
@@ -29,6 +30,7 @@ public:
     virtual R visitUnaryExpr(const Expr<R>::Unary& expr) = 0;
     virtual R visitTernaryExpr(const Expr<R>::Ternary& expr) = 0;
     virtual R visitVariableExpr(const Expr<R>::Variable& expr) = 0;
+    virtual R visitUpdateExpr(const Expr<R>::Update& expr) = 0;
   };
 
   virtual R accept(Visitor& visitor) const = 0;
@@ -178,3 +180,21 @@ public:
 
   const Token name;
 };
+
+template <class R>
+class Expr<R>::Update : public Expr<R>
+{
+public:
+  Update(const Token& name, const Token& oper, const std::shared_ptr<const Expr<R>>& value, const bool& postfix):
+    name(name), oper(oper), value(value), postfix(postfix) {}
+
+  R accept(Expr<R>::Visitor& visitor) const override
+  {
+    return visitor.visitUpdateExpr(*this);
+  }
+
+  const Token name;
+  const Token oper;
+  const std::shared_ptr<const Expr<R>> value;
+  const bool postfix;
+};
@@ -0,0 +1,121 @@
+/**
+ * @file FiberCallables.h
+ * @brief The native functions that run Lox code concurrently on one thread: `fiber`,
+ *        `sleep` and `yield_now`.
+ *
+ * Fibers (see Scheduler.h) are cheap enough to start by the thousand, e.g. one per
+ * timer or polling loop. Unlike tasks they run in the interpreter that started them,
+ * one at a time, and share its variables; the running fiber is switched out after a
+ * quantum of loop iterations and calls, or when it sleeps, yields or joins a fiber.
+ *
+ * A fiber that stops with a runtime error reports it as the script would, and joining
+ * it returns nil. Fibers run until they finish; a script waits for the fibers it started
+ * once it has returned.
+ *
+ * `yield` is a keyword of generators, so the native that gives way to the other fibers
+ * is called `yield_now`.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Interpreter.h"
+#include "LoxCallable.h"
+
+/**
+ * @brief The `fiber(fn, args...)` native, which starts calling a function as a fiber.
+ */
+class FiberCallable : public LoxCallable
+{
+  /**
+   * @brief Returns the number of arguments required by `fiber`, at least the function.
+   *
+   * @return 1.
+   */
+  size_t arity() override { return 1; }
+
+  /**
+   * @brief Accepts the arguments for the function after it.
+   *
+   * @return True.
+   */
+  bool variadic() override { return true; }
+
+  /**
+   * @brief Starts a fiber calling the function with the remaining arguments.
+   *
+   * @param interpreter The interpreter starting the fiber.
+   * @param arguments The function, followed by its arguments.
+   * @return The fiber, which first runs once the caller gives way.
+   * @throws NativeError if the first argument is not callable or the rest do not match its arity.
+   */
+  LiteralValue call(Interpreter& interpreter, const std::vector<LiteralValue>& arguments) override;
+
+  /**
+   * @brief Returns a string representation of the `fiber` function.
+   *
+   * @return A string indicating that this is a native function.
+   */
+  std::string toString() override { return "<native fn>"; }
+};
+
+/**
+ * @brief The `sleep(ms)` native, which suspends the running fiber for a while.
+ */
+class SleepCallable : public LoxCallable
+{
+  /**
+   * @brief Returns the number of arguments required by `sleep`.
+   *
+   * @return 1.
+   */
+  size_t arity() override { return 1; }
+
+  /**
+   * @brief Suspends the running fiber, running the others meanwhile.
+   *
+   * @param interpreter The interpreter sleeping.
+   * @param arguments The number of milliseconds to sleep.
+   * @return nil.
+   * @throws NativeError if the time is not a non-negative number.
+   */
+  LiteralValue call(Interpreter& interpreter, const std::vector<LiteralValue>& arguments) override;
+
+  /**
+   * @brief Returns a string representation of the `sleep` function.
+   *
+   * @return A string indicating that this is a native function.
+   */
+  std::string toString() override { return "<native fn>"; }
+};
+
+/**
+ * @brief The `yield_now()` native, which lets the other fibers ready to run go first.
+ */
+class YieldNowCallable : public LoxCallable
+{
+  /**
+   * @brief Returns the number of arguments required by `yield_now`.
+   *
+   * @return 0.
+   */
+  size_t arity() override { return 0; }
+
+  /**
+   * @brief Switches to the next fiber ready to run, if any.
+   *
+   * @param interpreter The interpreter yielding.
+   * @param arguments No arguments.
+   * @return nil.
+   */
+  LiteralValue call(Interpreter& interpreter, const std::vector<LiteralValue>&) override;
+
+  /**
+   * @brief Returns a string representation of the `yield_now` function.
+   *
+   * @return A string indicating that this is a native function.
+   */
+  std::string toString() override { return "<native fn>"; }
+};
@@ -0,0 +1,147 @@
+/**
+ * @file FileCallables.h
+ * @brief The native functions that read and write files: `readFile`, `writeFile` and
+ *        `readLines`, and the line iterator `readLines` returns.
+ *
+ * Each call suspends the running fiber until the operation completes, and runs the
+ * other fibers meanwhile (see Scheduler.h), so a script overlaps many reads with
+ * computation by reading from many fibers. Operations run on io_uring where the kernel
+ * allows it, and on a few background threads otherwise (see IoLoop.h). Called outside
+ * of any fiber, they simply wait.
+ *
+ * A failed operation is a runtime error naming the file and the reason.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Interpreter.h"
+#include "LoxCallable.h"
+
+/**
+ * @brief The `readFile(path)` native, which returns the contents of a file as a string.
+ */
+class ReadFileCallable : public LoxCallable
+{
+  /**
+   * @brief Returns the number of arguments required by `readFile`.
+   *
+   * @return 1.
+   */
+  size_t arity() override { return 1; }
+
+  /**
+   * @brief Reads a whole file, running the other fibers meanwhile.
+   *
+   * @param interpreter The interpreter reading.
+   * @param arguments The path of the file.
+   * @return The contents of the file.
+   * @throws NativeError if the path is not a string or the file cannot be read.
+   */
+  LiteralValue call(Interpreter& interpreter, const std::vector<LiteralValue>& arguments) override;
+
+  /**
+   * @brief Returns a string representation of the `readFile` function.
+   *
+   * @return A string indicating that this is a native function.
+   */
+  std::string toString() override { return "<native fn>"; }
+};
+
+/**
+ * @brief The `writeFile(path, data)` native, which replaces a file with a string.
+ */
+class WriteFileCallable : public LoxCallable
+{
+  /**
+   * @brief Returns the number of arguments required by `writeFile`.
+   *
+   * @return 2.
+   */
+  size_t arity() override { return 2; }
+
+  /**
+   * @brief Writes a whole file, creating it if need be, running the other fibers meanwhile.
+   *
+   * @param interpreter The interpreter writing.
+   * @param arguments The path of the file and the string to write.
+   * @return nil.
+   * @throws NativeError if the arguments are not strings or the file cannot be written.
+   */
+  LiteralValue call(Interpreter& interpreter, const std::vector<LiteralValue>& arguments) override;
+
+  /**
+   * @brief Returns a string representation of the `writeFile` function.
+   *
+   * @return A string indicating that this is a native function.
+   */
+  std::string toString() override { return "<native fn>"; }
+};
+
+/**
+ * @brief The lines of a file as a Lox value, which returns the next line when called,
+ *        so that `for (var line in readLines(path))` iterates over them.
+ */
+class LoxLines : public LoxCallable
+{
+public:
+  /**
+   * @brief Constructs an iterator over the lines of a text.
+   * @param text The text, whose lines end with '\n' or "\r\n", the last one optionally.
+   */
+  LoxLines(std::string text)
+    : _text(std::move(text)) {}
+
+  /**
+   * @brief Returns the next line, without its line ending.
+   *
+   * @param interpreter The interpreter iterating (unused).
+   * @param arguments No arguments.
+   * @return The line, or nil after the last one.
+   */
+  LiteralValue call(Interpreter&, const std::vector<LiteralValue>&) override;
+
+  /**
+   * @brief Returns a string representation of the lines.
+   *
+   * @return A string indicating that these are lines.
+   */
+  std::string toString() override { return "<lines>"; }
+
+private:
+  std::string _text; ///< The text.
+  size_t _position = 0; ///< Where the next line starts.
+};
+
+/**
+ * @brief The `readLines(path)` native, which reads a file and returns its lines.
+ */
+class ReadLinesCallable : public LoxCallable
+{
+  /**
+   * @brief Returns the number of arguments required by `readLines`.
+   *
+   * @return 1.
+   */
+  size_t arity() override { return 1; }
+
+  /**
+   * @brief Reads a whole file, running the other fibers meanwhile.
+   *
+   * @param interpreter The interpreter reading.
+   * @param arguments The path of the file.
+   * @return The lines of the file, which return the next one when called.
+   * @throws NativeError if the path is not a string or the file cannot be read.
+   */
+  LiteralValue call(Interpreter& interpreter, const std::vector<LiteralValue>& arguments) override;
+
+  /**
+   * @brief Returns a string representation of the `readLines` function.
+   *
+   * @return A string indicating that this is a native function.
+   */
+  std::string toString() override { return "<native fn>"; }
+};
@@ -0,0 +1,104 @@
+/**
+ * @file FunctionBody.h
+ * @brief Header file for the FunctionBody class, the statements of a function
+ *        declaration, which may be parsed only when they are first needed.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "utils.h"
+
+template <class R>
+class Stmt;
+
+/**
+ * @class FunctionBody
+ * @brief Holds the statements of a function body, either parsed up front or
+ *        parsed by a deferred parse the first time they are requested.
+ *
+ * Deferring the parse lets scripts that declare many functions but call few of
+ * them only pay for parsing the code they actually execute.
+ *
+ * @tparam R The type of the expressions in the body.
+ */
+template <class R>
+class FunctionBody
+{
+public:
+  /// Signature of a deferred parse, which reports syntax errors to the given reporter
+  /// and throws if the body cannot be parsed.
+  using Parse = std::function<std::vector<std::shared_ptr<const Stmt<R>>>(Lox::Reporter&)>;
+
+  /**
+   * @brief Constructs a body that has already been parsed.
+   * @param statements The statements of the body.
+   */
+  FunctionBody(std::vector<std::shared_ptr<const Stmt<R>>> statements)
+    : _statements(std::move(statements)), _parsed(true) {}
+
+  /**
+   * @brief Constructs a body that is parsed on first use.
+   * @param parse The deferred parse of the body.
+   * @param offset The offset in the source just after the body's opening brace.
+   */
+  FunctionBody(Parse parse, const size_t& offset)
+    : _parse(std::move(parse)), _offset(offset) {}
+
+  /**
+   * @brief Returns the statements of the body, parsing them first if needed.
+   *
+   * Safe to call from several threads: the deferred parse runs once, and is retried
+   * by the next call only if it throws.
+   *
+   * @param reporter Where to report syntax errors of a deferred parse.
+   * @return The statements of the body.
+   */
+  const std::vector<std::shared_ptr<const Stmt<R>>>& statements(Lox::Reporter& reporter) const
+  {
+    if (!_parsed.load(std::memory_order_acquire))
+    {
+      std::lock_guard<std::mutex> lock(_parsing);
+      if (!_parsed.load(std::memory_order_relaxed))
+      {
+        _statements = _parse(reporter);
+        _parsed.store(true, std::memory_order_release);
+      }
+    }
+    return _statements;
+  }
+
+  /**
+   * @brief Returns the statements of a body that has already been parsed.
+   * @return The statements of the body, or none if `parsed()` is false.
+   */
+  const std::vector<std::shared_ptr<const Stmt<R>>>& statements() const
+  {
+    static const std::vector<std::shared_ptr<const Stmt<R>>> pending;
+    return parsed() ? _statements : pending;
+  }
+
+  /**
+   * @brief Checks whether the statements are available without parsing.
+   * @return False if the body is still waiting for its deferred parse.
+   */
+  bool parsed() const { return _parsed.load(std::memory_order_acquire); }
+
+  /**
+   * @brief Returns where a deferred body starts.
+   * @return The offset in the source just after the body's opening brace.
+   */
+  size_t offset() const { return _offset; }
+
+private:
+  mutable std::vector<std::shared_ptr<const Stmt<R>>> _statements; ///< The parsed statements.
+  Parse _parse; ///< The deferred parse, if any.
+  mutable std::atomic<bool> _parsed = false; ///< Whether the statements are available.
+  mutable std::mutex _parsing; ///< Serializes the deferred parse.
+  size_t _offset = 0; ///< The offset in the source a deferred body starts at.
+};
@@ -0,0 +1,171 @@
+/**
+ * @file Generator.h
+ * @brief Header file for the Generator class, the value a Lox function containing
+ *        `yield` returns, which runs the function's body lazily.
+ */
+
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "Environment.h"
+#include "Interpreter.h"
+#include "LoxCallable.h"
+#include "Stmt.h"
+
+/**
+ * @class Generator
+ * @brief A suspended call of a generator function, which runs up to its next `yield`
+ *        each time it is called or iterated with `for (var x in generator)`.
+ *
+ * The body runs as a chain of C++20 coroutines on the thread of the caller: every
+ * statement that contains a `yield` (a block, loop or branch) runs as a coroutine
+ * awaiting the one for its inner statement, and every other statement is executed by
+ * the interpreter as usual. A `yield` suspends the innermost coroutine only, and the
+ * next call resumes it directly, so a step costs the same however deep it is nested.
+ * While it is suspended, the scopes the body was running in are kept by the generator
+ * and swapped back into the interpreter when it resumes.
+ *
+ * Coroutine frames are recycled per thread, so loops over generators do not allocate
+ * for each value. A generator can only be resumed by the interpreter that created it.
+ */
+class Generator : public LoxCallable
+{
+public:
+  /// The statements of a function body that contain a `yield`, outside nested functions.
+  using Yielding = std::unordered_set<const Stmt<LiteralValue>*>;
+
+  /**
+   * @brief Finds the statements of a function body that contain a `yield`.
+   * @param statements The body.
+   * @return The statements, none if the function is not a generator.
+   */
+  static Yielding analyze(const std::vector<std::shared_ptr<const Stmt<LiteralValue>>>& statements);
+
+  /**
+   * @brief Takes the next value of a loop over a generator, or over any other callable,
+   *        which is called until it returns nil.
+   * @param interpreter The interpreter running the loop.
+   * @param iterable The generator or callable.
+   * @param name The loop variable, to report errors at.
+   * @param value Receives the next value.
+   * @return False once there are no values left.
+   * @throws RuntimeError if the iterable cannot be iterated over.
+   */
+  static bool next(Interpreter& interpreter, const LiteralValue& iterable, const Token& name, LiteralValue& value);
+
+  /**
+   * @brief Creates a generator that has not started running its body yet.
+   * @param interpreter The interpreter calling the generator function.
+   * @param statements The body of the function.
+   * @param yielding The statements of the body that contain a `yield`.
+   * @param scope The scope of the call, holding the arguments.
+   */
+  Generator(Interpreter& interpreter, const std::vector<std::shared_ptr<const Stmt<LiteralValue>>>& statements,
+            const Yielding& yielding, Environment scope);
+
+  /**
+   * @brief Destroys the generator, abandoning its body where it was suspended.
+   */
+  ~Generator();
+
+  /**
+   * @brief Runs the body up to its next `yield`.
+   * @param interpreter The interpreter resuming the generator.
+   * @return False once the body has returned, in which case no value was yielded.
+   * @throws NativeError if the generator belongs to another interpreter or is already running.
+   * @throws RuntimeError, or any other error, the body stopped with.
+   */
+  bool resume(Interpreter& interpreter);
+
+  /**
+   * @brief Returns the value last yielded, which may be moved from.
+   * @return The value.
+   */
+  LiteralValue& value() { return _value; }
+
+  /**
+   * @brief Runs the body up to its next `yield`.
+   *
+   * @param interpreter The interpreter resuming the generator.
+   * @param arguments No arguments.
+   * @return The value yielded, or nil once the body has returned.
+   */
+  LiteralValue call(Interpreter& interpreter, const std::vector<LiteralValue>&) override;
+
+  /**
+   * @brief Returns a string representation of the generator.
+   *
+   * @return A string indicating that this is a generator.
+   */
+  std::string toString() override { return "<generator>"; }
+
+private:
+  class Steps;
+  struct Suspend;
+
+  Interpreter* _interpreter; ///< The interpreter the body runs in.
+  const Yielding& _yielding; ///< The statements to run as coroutines.
+  std::shared_ptr<Environment> _scope; ///< The scopes of the body while it is suspended, or of the caller while it runs.
+  std::coroutine_handle<> _root; ///< The coroutine running the body, null once it has returned.
+  std::coroutine_handle<> _leaf; ///< The innermost coroutine, where the body was suspended.
+  LiteralValue _value; ///< The value last yielded.
+  std::exception_ptr _error; ///< The error the body stopped with, if any.
+  bool _running = false; ///< Whether the body is running, to refuse resuming it from inside.
+
+  /**
+   * @brief Installs a new innermost scope in the interpreter.
+   * @return The scopes it replaced, for `leave`.
+   */
+  std::shared_ptr<Environment> enter(Environment scope);
+
+  /**
+   * @brief Restores the scopes `enter` replaced.
+   */
+  void leave(std::shared_ptr<Environment> previous);
+
+  /**
+   * @brief Evaluates the value of a `yield`, and suspends the body.
+   */
+  Suspend yield(const Stmt<LiteralValue>::Yield& stmt);
+
+  /**
+   * @brief Returns the coroutine running a statement that contains a `yield`.
+   */
+  Steps step(const Stmt<LiteralValue>& stmt);
+
+  /**
+   * @brief Runs the body of the function, and records how it stopped.
+   */
+  Steps body(const std::vector<std::shared_ptr<const Stmt<LiteralValue>>>& statements);
+
+  /**
+   * @brief Runs statements in order.
+   */
+  Steps block(const std::vector<std::shared_ptr<const Stmt<LiteralValue>>>& statements);
+
+  /**
+   * @brief Runs the taken branch of an if statement.
+   */
+  Steps branch(const Stmt<LiteralValue>::If& stmt);
+
+  /**
+   * @brief Runs a while loop.
+   */
+  Steps loop(const Stmt<LiteralValue>::While& stmt);
+
+  /**
+   * @brief Runs a range loop, or a loop over a generator.
+   */
+  Steps range(const Stmt<LiteralValue>::For& stmt);
+
+  /**
+   * @brief Runs a `yield` on its own, as the body of a loop or branch.
+   */
+  Steps single(const Stmt<LiteralValue>::Yield& stmt);
+};
@@ -0,0 +1,151 @@
+/**
+ * @file IncrementalParser.h
+ * @brief Header file for the IncrementalParser class, which keeps the syntax tree of
+ *        a document up to date as it is edited, e.g. from an editor.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Expr.h"
+#include "Scanner.h"
+#include "Source.h"
+#include "Stmt.h"
+#include "Token.h"
+#include "utils.h"
+
+/**
+ * @class IncrementalParser
+ * @brief Parses a document once, then reparses only the declarations an edit touches.
+ *
+ * The document is split into segments, one per top-level declaration, each holding
+ * its text (with the comments and whitespace before it) in a Source of its own and
+ * the statements parsed from it. An edit rescans the segments around it, splits them
+ * again at the tokens that end top-level declarations, and reparses the new segments;
+ * every other segment keeps its statements. Only when the edit leaves a declaration,
+ * string or comment open is the range extended over the following segments until it
+ * closes again.
+ *
+ * Line numbers of the segments after an edit are updated without rescanning them.
+ * Syntax errors are reported as usual, but only for the segments that are reparsed.
+ */
+class IncrementalParser
+{
+public:
+  /**
+   * @brief A top-level declaration and the text it was parsed from.
+   */
+  struct Segment
+  {
+    std::shared_ptr<Source> source; /**< The text of the declaration, which its tokens refer to */
+    std::vector<std::shared_ptr<Stmt<LiteralValue>>> statements; /**< The statements parsed from it */
+  };
+
+  /**
+   * @brief Constructs an IncrementalParser by parsing the whole document.
+   * @param text The text of the document.
+   * @param reporter Where to report syntax errors, which must outlive the parser.
+   */
+  IncrementalParser(std::string_view text, Lox::Reporter& reporter);
+
+  /**
+   * @brief Replaces part of the document and reparses the declarations it affects.
+   * @param offset The offset of the text to replace.
+   * @param removed The length of the text to replace.
+   * @param inserted The text to insert in its place.
+   * @throws std::out_of_range if the replaced text runs past the end of the document.
+   */
+  void edit(const size_t& offset, const size_t& removed, std::string_view inserted);
+
+  /**
+   * @brief Returns the segments of the document, in order.
+   *
+   * A segment's statements stay valid for as long as its Source is retained, even
+   * after an edit replaces the segment.
+   *
+   * @return The segments.
+   */
+  const std::vector<Segment>& segments() const { return _segments; }
+
+  /**
+   * @brief Returns the top-level statements of the whole document.
+   * @return The statements of every segment, in order.
+   */
+  std::vector<std::shared_ptr<Stmt<LiteralValue>>> statements() const;
+
+  /**
+   * @brief Returns the current text of the document.
+   * @return The text of every segment, in order.
+   */
+  std::string text() const;
+
+  /**
+   * @brief Returns the length of the document.
+   * @return The length of the current text.
+   */
+  size_t size() const { return _size; }
+
+  /**
+   * @brief Returns how much text the last edit rescanned and reparsed.
+   * @return The length of the text the affected segments were rebuilt from.
+   */
+  size_t reparsed() const { return _reparsed; }
+
+private:
+  Lox::Reporter* _reporter; ///< Where syntax errors are reported.
+  std::vector<Segment> _segments; ///< The segments of the document.
+  std::vector<size_t> _starts; ///< The offset in the document of each segment.
+  size_t _size = 0; ///< The length of the document.
+  size_t _reparsed = 0; ///< The length of the text last rebuilt.
+
+  /**
+   * @brief The segments a range of text splits into, and whether the range ends
+   *        with a complete declaration.
+   */
+  struct Split
+  {
+    std::shared_ptr<const Source> source; /**< The range of text, as scanned */
+    std::vector<Token> tokens; /**< Its tokens, without the END token */
+    std::vector<Scanner::ScanError> errors; /**< The errors found while scanning it */
+    std::vector<size_t> ends; /**< Offset just after each top-level declaration */
+    bool complete = false; /**< Whether the last declaration ends at the end of the range */
+  };
+
+  /**
+   * @brief Scans a range of text and splits it at the ends of top-level declarations.
+   *
+   * A declaration ends with a ';' or '}' outside of any brackets, unless it is
+   * followed by an 'else'.
+   *
+   * @param text The range of text.
+   * @param first_line The line the range starts on.
+   * @return The split range.
+   */
+  static Split split(std::string text, const int& first_line);
+
+  /**
+   * @brief Replaces a run of segments with the segments of a split range of text.
+   * @param first The index of the first segment replaced.
+   * @param last The index just after the last segment replaced.
+   * @param split The range of text the new segments are parsed from.
+   */
+  void replace(const size_t& first, const size_t& last, const Split& split);
+
+  /**
+   * @brief Finds the segment containing an offset into the document.
+   * @param offset The offset, which must be within the document.
+   * @return The index of the segment.
+   */
+  size_t segmentAt(const size_t& offset) const;
+
+  /**
+   * @brief Returns the line a segment starts on, or the line after the last segment.
+   * @param index The index of the segment.
+   * @return The line number.
+   */
+  int lineAt(const size_t& index) const;
+};
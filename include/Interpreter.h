@@ -2,6 +2,8 @@
 
 #include <iostream>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <variant>
 #include <vector>
 #include <memory>
@@ -9,11 +11,14 @@
 #include "Environment.h"
 #include "Expr.h"
 #include "JumpExceptions.h"
+#include "Purity.h"
 #include "RuntimeError.h"
 #include "Stmt.h"
 #include "Token.h"
 #include "utils.h"
 
+class Scheduler;
+
 /**
  * @class Interpreter
  * @brief The Interpreter class is responsible for evaluating expressions and executing statements.
@@ -27,10 +32,78 @@ public:
   Environment globals; ///< The global environment that stores global variables and their values.
   Environment environment;  ///< The environment that stores variables and their values.
 
-/**
- * @brief Initializes the interpreter's global environment and sets up built-in functions.
- */
-  Interpreter();
+  /**
+   * @brief Initializes the interpreter's global environment and sets up built-in functions.
+   * 
+   * Interpreters share no state, so several can run on different threads at once.
+   * 
+   * @param reporter Where to report runtime errors, which must outlive the interpreter.
+   * @param out The stream `print` writes to.
+   */
+  Interpreter(Lox::Reporter& reporter, std::ostream& out = std::cout);
+
+  /**
+   * @brief Runs the fibers the interpreter started and waits for the tasks it spawned,
+   *        which run code it owns.
+   */
+  ~Interpreter();
+
+  /**
+   * @brief Returns where the interpreter reports errors.
+   * 
+   * @return The reporter given on construction.
+   */
+  Lox::Reporter& reporter() const { return _reporter; }
+
+  /**
+   * @brief Returns the stream `print` writes to.
+   * 
+   * @return The stream given on construction.
+   */
+  std::ostream& out() const { return _out; }
+
+  /**
+   * @brief Enables or disables evaluating independent pure calls in parallel.
+   * 
+   * When both operands of a binary expression are calls that are proven pure, the right
+   * one is forked onto the task runtime while the left one is evaluated, as long as fewer
+   * than `depth` such forks enclose the expression. Below that the operands are evaluated
+   * one after the other, so that forks stay coarse enough to pay for themselves.
+   * 
+   * @param depth How many forks may be nested, or 0 to evaluate every operand in order.
+   */
+  void setParallelDepth(const unsigned& depth) { _parallel_depth = depth; }
+
+  /**
+   * @brief Returns how many more forks may be nested.
+   * 
+   * @return The remaining depth, 0 if calls are evaluated in order.
+   */
+  unsigned parallelDepth() const { return _parallel_depth; }
+
+  /**
+   * @brief Returns the statements of a function's body that contain a `yield`, which
+   *        make the function a generator, finding them on the first call.
+   * 
+   * @param declaration The function declaration.
+   * @return The statements, none if the function is not a generator.
+   */
+  const std::unordered_set<const Stmt<LiteralValue>*>& yielding(const Stmt<LiteralValue>::Function& declaration);
+
+  /**
+   * @brief Returns the scheduler that runs the interpreter's fibers, creating it on first use.
+   * 
+   * @return The scheduler.
+   */
+  Scheduler& scheduler();
+
+  /**
+   * @brief Runs the fibers the interpreter started until all of them have finished.
+   * 
+   * Fibers only run while the code that started them gives way, so whoever runs a script
+   * calls this once the script has returned, while its syntax tree is still alive.
+   */
+  void joinFibers();
 
   /**
    * @brief Interprets a series of statements.
@@ -113,6 +186,17 @@ public:
    */
   LiteralValue visitAssignExpr(const Expr<LiteralValue>::Assign& expr) override;
 
+  /**
+   * @brief Visits a compound assignment, increment or decrement and updates the variable in place.
+   * 
+   * The variable is located once and modified through the returned reference rather than
+   * being read with `get` and written back with `assign`.
+   * 
+   * @param expr The update expression to evaluate.
+   * @return The value of the variable before the update for postfix forms, otherwise after it.
+   */
+  LiteralValue visitUpdateExpr(const Expr<LiteralValue>::Update& expr) override;
+
 
   /**
    * @brief Visits a block statement and executes all statements in the block.
@@ -179,6 +263,31 @@ public:
    */
   LiteralValue visitWhileStmt(const Stmt<LiteralValue>::While& stmt) override;
 
+  /**
+   * @brief Evaluates a range-based counted for loop, or a loop over a generator.
+   * 
+   * The counter is kept as a native `double` and written into the loop variable's slot at
+   * the start of each iteration, so the loop needs no condition or increment expressions
+   * and creates its scope only once. Values of a generator are moved into the same slot.
+   * 
+   * @param stmt The for statement to be evaluated.
+   * @return A `std::monostate` indicating that the for statement does not return a value.
+   * @throws RuntimeError If the bounds or step are not numbers, or the step is zero, or
+   *         the loop is over something that cannot be iterated.
+   */
+  LiteralValue visitForStmt(const Stmt<LiteralValue>::For& stmt) override;
+
+  /**
+   * @brief Rejects a `yield` outside of a function.
+   * 
+   * Yields in functions are run by the generator the call returns, never by this visitor.
+   * 
+   * @param stmt The yield statement.
+   * @return Never returns.
+   * @throws RuntimeError Always.
+   */
+  LiteralValue visitYieldStmt(const Stmt<LiteralValue>::Yield& stmt) override;
+
   /**
    * @brief Executes a jump statement, such as `break` or `continue`.
    *
@@ -197,11 +306,90 @@ public:
    * Executes a sequence of statements within a new environment, which is a child of the current environment.
    * 
    * @param statements The statements to execute.
-   * @param environment The environment to use for executing the block.
+   * @param environment The environment to use for executing the block, moved in rather than copied.
    */
-  void executeBlock(const std::vector<std::shared_ptr<const Stmt<LiteralValue>>>& statements, const Environment& environment);
+  void executeBlock(const std::vector<std::shared_ptr<const Stmt<LiteralValue>>>& statements, Environment environment);
   
 private:
+  friend class Generator;
+
+  /// The loop iterations and calls a fiber runs before offering to switch to another.
+  static constexpr unsigned quantum = 1024;
+
+  /**
+   * @brief The values a range loop takes.
+   */
+  struct Range
+  {
+    double first; /**< The first value */
+    double last; /**< The bound, which is not taken */
+    double step; /**< The difference between values, never zero */
+
+    /**
+     * @brief Checks whether a value comes before the bound.
+     */
+    bool contains(const double& counter) const { return step > 0 ? counter < last : counter > last; }
+  };
+
+  Lox::Reporter& _reporter; ///< Where runtime errors are reported.
+  std::ostream& _out; ///< The stream `print` writes to.
+  unsigned _parallel_depth = 0; ///< How many more forks of pure calls may be nested.
+  std::unordered_map<const Expr<LiteralValue>::Binary*, Purity::Proof> _forkable; ///< Whether the operands of a binary expression are pure calls.
+  std::unordered_map<const Stmt<LiteralValue>::Function*, std::unordered_set<const Stmt<LiteralValue>*>> _yielding; ///< The statements of each function that contain a `yield`.
+  std::unique_ptr<Scheduler> _scheduler; ///< Runs the fibers, null until the first is started.
+  unsigned _ticks = quantum; ///< The loop iterations and calls left before offering to switch fibers.
+
+  /**
+   * @brief Counts a loop iteration or call against the running fiber's quantum, and
+   *        offers to switch to another fiber once it is used up.
+   */
+  void tick() { if (--_ticks == 0) preempt(); }
+
+  /**
+   * @brief Starts a new quantum, switching to another fiber first if one is ready to run.
+   */
+  void preempt();
+
+  /**
+   * @brief Locates a variable, in the environment first and then among the natives in
+   *        the globals, so that a script's own declarations shadow the natives.
+   * 
+   * @param name The token representing the variable name.
+   * @return A reference to the value of the variable.
+   * @throws RuntimeError if the variable is defined in neither.
+   */
+  LiteralValue& variable(const Token& name);
+
+  /**
+   * @brief Evaluates the bounds and step of a range loop.
+   * 
+   * @param stmt The range loop.
+   * @return The values the loop takes.
+   * @throws RuntimeError If the bounds or step are not numbers, or the step is zero.
+   */
+  Range range(const Stmt<LiteralValue>::For& stmt);
+
+  /**
+   * @brief Evaluates the callee and arguments of a call, and checks that they match.
+   * 
+   * @param expr The call expression.
+   * @param arguments Receives the evaluated arguments.
+   * @return The function to call.
+   * @throws RuntimeError If the callee is not a function or class, or if the argument count is incorrect.
+   */
+  std::shared_ptr<LoxCallable> resolveCall(const Expr<LiteralValue>::Call& expr, std::vector<LiteralValue>& arguments);
+
+  /**
+   * @brief Evaluates the operands of a binary expression in parallel, if they are pure calls
+   *        and the fork depth allows it.
+   * 
+   * @param expr The binary expression.
+   * @param left Receives the value of the left operand.
+   * @param right Receives the value of the right operand.
+   * @return False if the operands are left to be evaluated in order.
+   */
+  bool forkOperands(const Expr<LiteralValue>::Binary& expr, LiteralValue& left, LiteralValue& right);
+
   /**
    * @brief Evaluates an expression.
    * 
@@ -0,0 +1,104 @@
+/**
+ * @file IoLoop.h
+ * @brief Header file for the IoLoop class, which reads and writes whole files in the
+ *        background for the fibers of an interpreter.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+class Fiber;
+
+/**
+ * @class IoLoop
+ * @brief Runs file operations without blocking the thread that starts them, and hands
+ *        back those that have completed when it is polled.
+ *
+ * Operations are run by io_uring where the kernel allows it, and otherwise by a few
+ * threads of the loop's own making that run them with blocking system calls. With
+ * io_uring, each step of an operation (opening, reading or writing, closing) is queued
+ * on the submission ring and only passed to the kernel when the loop is polled or
+ * waited on, so that the steps of many operations started in a row take one system call.
+ *
+ * A loop is used by one thread, the one running the interpreter's fibers. Requests must
+ * stay where they are until they have completed.
+ */
+class IoLoop
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @brief A file operation, and its outcome.
+   */
+  struct Request
+  {
+    enum class Kind
+    {
+      READ, /**< Reads the whole file into `data` */
+      WRITE, /**< Replaces the file with `data`, creating it if need be */
+    };
+
+    Kind kind; /**< What to do */
+    std::string path; /**< The file */
+    std::string data; /**< What was read, or what to write */
+    int error = 0; /**< The errno the operation failed with, 0 if it succeeded */
+    Fiber* fiber = nullptr; /**< The fiber waiting for the operation */
+
+    // The progress of the operation, kept by the loop.
+    int fd = -1; /**< The open file */
+    size_t done = 0; /**< The bytes read or written so far */
+  };
+
+  /**
+   * @brief Creates a loop backed by io_uring if possible, and by threads otherwise.
+   * @param uring Whether to try io_uring at all.
+   * @return The loop.
+   */
+  static std::unique_ptr<IoLoop> create(const bool& uring = true);
+
+  /**
+   * @brief Waits for the operations in flight, which refer to their requests, to complete.
+   */
+  virtual ~IoLoop() = default;
+
+  /**
+   * @brief Returns the name of the backend, for benchmarks and diagnostics.
+   * @return "io_uring" or "threads".
+   */
+  virtual const char* backend() const = 0;
+
+  /**
+   * @brief Starts an operation.
+   * @param request The operation, which must not move until it has completed.
+   */
+  virtual void submit(Request& request) = 0;
+
+  /**
+   * @brief Returns whether any operation has been started and not handed back yet.
+   * @return True while operations are in flight.
+   */
+  bool busy() const { return _in_flight != 0; }
+
+  /**
+   * @brief Passes queued steps on and collects the operations that have completed,
+   *        without waiting.
+   * @param completed Receives the completed operations.
+   */
+  virtual void poll(std::vector<Request*>& completed) = 0;
+
+  /**
+   * @brief Waits until an operation may have completed, or until a deadline.
+   * @param deadline When to give up waiting, if ever.
+   */
+  virtual void wait(const std::optional<Clock::time_point>& deadline) = 0;
+
+protected:
+  size_t _in_flight = 0; ///< The operations started and not handed back yet.
+};
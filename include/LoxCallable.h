@@ -1,12 +1,26 @@
 #pragma once
 
 #include <chrono>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
 #include "Interpreter.h"
 #include "Token.h"
 
+/**
+ * @brief Thrown by native functions when they are called with unsuitable arguments.
+ *
+ * Natives do not know where they were called from, so the interpreter reports the
+ * error as a RuntimeError at the call.
+ */
+class NativeError : public std::runtime_error
+{
+public:
+  NativeError(const std::string& message)
+    : std::runtime_error(message) {}
+};
+
 /**
  * @brief Abstract base class for callable entities in Lox.
  *
@@ -26,6 +40,26 @@ public:
    */
   virtual size_t arity() { return 0; }
 
+  /**
+   * @brief Checks whether the callable accepts more arguments than its arity.
+   * 
+   * @return True if the arity is only the minimum number of arguments.
+   */
+  virtual bool variadic() { return false; }
+
+  /**
+   * @brief Checks whether the callable takes the given number of arguments.
+   * 
+   * @param count The number of arguments.
+   * @throws NativeError if it does not.
+   */
+  void checkArity(const size_t& count)
+  {
+    if (variadic() ? count < arity() : count != arity())
+      throw NativeError("Expected " + std::string(variadic() ? "at least " : "") +
+        std::to_string(arity()) + " arguments, but got " + std::to_string(count) + ".");
+  }
+
   /**
    * @brief Calls the callable entity with the provided arguments.
    * 
@@ -33,7 +67,22 @@ public:
    * @param arguments The arguments to pass to the callable.
    * @return The result of the callable's execution.
    */
-  virtual LiteralValue call(Interpreter&, const std::vector<LiteralValue>) = 0;
+  virtual LiteralValue call(Interpreter&, const std::vector<LiteralValue>&) = 0;
+
+  /**
+   * @brief Calls the callable entity, taking over the arguments rather than copying them.
+   * 
+   * Callables that keep their arguments, such as user functions in their parameters,
+   * move them there. The others are called as usual.
+   * 
+   * @param interpreter The interpreter instance to use for executing the call.
+   * @param arguments The arguments to pass to the callable, left unspecified afterwards.
+   * @return The result of the callable's execution.
+   */
+  virtual LiteralValue callOwned(Interpreter& interpreter, std::vector<LiteralValue>&& arguments)
+  {
+    return call(interpreter, arguments);
+  }
 
   /**
    * @brief Returns a string representation of the callable.
@@ -66,7 +115,7 @@ class ClockCallable : public LoxCallable
    * @param arguments The arguments passed to the function (unused).
    * @return The current system time in seconds as a `LiteralValue`.
    */
-  LiteralValue call(Interpreter&, const std::vector<LiteralValue>) override
+  LiteralValue call(Interpreter&, const std::vector<LiteralValue>&) override
   {
     using namespace std::chrono;
     return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count() / 1000.0;
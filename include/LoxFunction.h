@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Environment.h"
+#include "Generator.h"
 #include "LoxCallable.h"
 
 /**
@@ -32,26 +33,38 @@ public:
   /**
    * @brief Executes the function by calling it with the provided arguments.
    * 
+   * A lazily parsed body is parsed on the first call. The body of a generator function,
+   * one that contains a `yield`, is not run yet: the generator returned runs it.
+   * 
    * @param interpreter The interpreter instance to execute the function.
    * @param arguments The list of arguments passed to the function.
-   * @return The return value of the function or `std::monostate` if none.
+   * @return The return value of the function or `std::monostate` if none, or the generator.
    */
-  LiteralValue call(Interpreter& interpreter, const std::vector<LiteralValue> arguments) override
+  LiteralValue call(Interpreter& interpreter, const std::vector<LiteralValue>& arguments) override
   {
     Environment environment = _closure;
     
     for (size_t i = 0; i < _declaration.params.size(); ++i)
-      environment.define(_declaration.params[i].lexeme, arguments[i]);
-    try
-    {
-      interpreter.executeBlock(_declaration.body, environment);
-    }
-    catch(const Return& return_value)
-    {
-      return return_value.value;
-    }
-  
-    return std::monostate();
+      environment.define(_declaration.params[i].lexeme(), arguments[i]);
+
+    return run(interpreter, std::move(environment));
+  }
+
+  /**
+   * @brief Executes the function, moving the arguments into its parameters.
+   * 
+   * @param interpreter The interpreter instance to execute the function.
+   * @param arguments The list of arguments passed to the function, moved from.
+   * @return The return value of the function or `std::monostate` if none, or the generator.
+   */
+  LiteralValue callOwned(Interpreter& interpreter, std::vector<LiteralValue>&& arguments) override
+  {
+    Environment environment = _closure;
+    
+    for (size_t i = 0; i < _declaration.params.size(); ++i)
+      environment.define(_declaration.params[i].lexeme(), std::move(arguments[i]));
+
+    return run(interpreter, std::move(environment));
   }
 
   /**
@@ -59,9 +72,49 @@ public:
    * 
    * @return A string indicating that this is a function and showing its name.
    */
-  std::string toString() override { return "<fn " + _declaration.name.lexeme + ">"; }
+  std::string toString() override { return "<fn " + std::string(_declaration.name.lexeme()) + ">"; }
+
+  /**
+   * @brief Returns the declaration of the function.
+   * 
+   * @return The function's declaration (parameters and body).
+   */
+  const Stmt<LiteralValue>::Function& declaration() const { return _declaration; }
+
+  /**
+   * @brief Returns the environment the function was created in.
+   * 
+   * @return The function's closure.
+   */
+  const Environment& closure() const { return _closure; }
   
 private:
   const Stmt<LiteralValue>::Function& _declaration; ///< The function's declaration (parameters and body).
   const Environment _closure; ///< The environment in which the function was created (its closure).
+
+  /**
+   * @brief Runs the body in an environment holding the parameters.
+   * 
+   * @param interpreter The interpreter instance to execute the function.
+   * @param environment The closure with the parameters defined.
+   * @return The return value of the function or `std::monostate` if none, or the generator.
+   */
+  LiteralValue run(Interpreter& interpreter, Environment environment)
+  {
+    const auto& statements = _declaration.body->statements(interpreter.reporter());
+    const Generator::Yielding& yielding = interpreter.yielding(_declaration);
+    if (!yielding.empty())
+      return std::shared_ptr<LoxCallable>(std::make_shared<Generator>(interpreter, statements, yielding, std::move(environment)));
+
+    try
+    {
+      interpreter.executeBlock(statements, std::move(environment));
+    }
+    catch(const Return& return_value)
+    {
+      return return_value.value;
+    }
+  
+    return std::monostate();
+  }
 };
@@ -1,11 +1,17 @@
 #pragma once
 
+#include <array>
+#include <initializer_list>
 #include <stdexcept>
 #include <vector>
 #include <memory>
 #include "Expr.h"
+#include "FunctionBody.h"
+#include "RuntimeError.h"
+#include "Scanner.h"
 #include "Stmt.h"
 #include "Token.h"
+#include "utils.h"
 
 /**
  * @class ParseError
@@ -22,6 +28,28 @@ public:
     : std::runtime_error(msg) {}
 };
 
+/**
+ * @enum Precedence
+ * @brief Binding power of infix operators, from loosest to tightest.
+ */
+enum Precedence
+{
+  PREC_NONE, /**< Tokens that are not infix operators */
+  PREC_COMMA, /**< ',' */
+  PREC_ASSIGNMENT, /**< '=', '+=', '-=', '*=', '/=' */
+  PREC_TERNARY, /**< '?:' */
+  PREC_OR, /**< 'or' */
+  PREC_AND, /**< 'and' */
+  PREC_EQUALITY, /**< '==', '!=' */
+  PREC_COMPARISON, /**< '<', '>', '<=', '>=' */
+  PREC_TERM, /**< '+', '-' */
+  PREC_FACTOR, /**< '*', '/' */
+  PREC_UNARY, /**< '!', '-', prefix '++' and '--' */
+  PREC_POSTFIX, /**< Postfix '++' and '--' */
+  PREC_CALL, /**< '()' */
+  PREC_PRIMARY /**< Literals, variables and groupings */
+};
+
 /**
  * @class Parser
  * @brief Parses tokens into an abstract syntax tree (AST) of expressions.
@@ -34,9 +62,22 @@ public:
   /**
    * @brief Constructs a new Parser with the given tokens.
    * @param tokens The list of tokens to parse.
+   * @param reporter Where to report syntax errors, which must outlive the parser.
    */
-  Parser(std::vector<Token> tokens)
-    : _tokens(std::move(tokens)) {}
+  Parser(std::vector<Token> tokens, Lox::Reporter& reporter)
+    : _tokens(std::move(tokens)), _lookahead(RING_SIZE, _tokens.front()), _reporter(&reporter) {}
+
+  /**
+   * @brief Constructs a new Parser that pulls tokens from the scanner as it needs them.
+   * 
+   * Only a few tokens around the current position are held at any time, so the
+   * full token vector is never materialized.
+   * 
+   * @param scanner The scanner to pull tokens from, which must outlive the parser.
+   * @param reporter Where to report syntax errors, which must outlive the parser.
+   */
+  Parser(Scanner& scanner, Lox::Reporter& reporter)
+    : _scanner(&scanner), _lookahead(RING_SIZE, scanner.nextToken()), _reporter(&reporter) {}
   
   /**
    * @brief Parses the tokens into a list of statements.
@@ -46,9 +87,51 @@ public:
    */
   std::vector<std::shared_ptr<Stmt<R>>> parse();
 
+  /**
+   * @brief Parses the next top-level declaration, so that it can be executed before
+   *        the rest of the tokens are parsed.
+   * 
+   * Declarations with syntax errors are reported and skipped.
+   * 
+   * @return A smart pointer to the parsed declaration, or nullptr once the tokens are exhausted.
+   */
+  std::shared_ptr<Stmt<R>> parseNext();
+
+  /**
+   * @brief Enables or disables lazy parsing of function bodies.
+   * 
+   * When enabled, a function body is only brace-matched when its declaration is
+   * parsed, and is parsed into statements the first time the function is called.
+   * Syntax errors inside the body are then reported on that first call.
+   * 
+   * @param lazy Whether to parse function bodies lazily.
+   */
+  void setLazyFunctions(const bool& lazy) { _lazy_functions = lazy; }
+
+  /**
+   * @brief Creates a function body that is parsed from the source on first use.
+   * 
+   * @param source The source the function was declared in.
+   * @param offset The offset just after the body's opening brace.
+   * @param name The name of the function, to report a body that fails to parse.
+   * @return The deferred body.
+   */
+  static std::shared_ptr<const FunctionBody<R>> deferredBody(const Source& source, const size_t& offset, const Token& name);
+
 private:
-  std::vector<Token> _tokens; ///< The list of tokens to parse.
-  unsigned int _current = 0; ///< The current position in the token list.
+  static constexpr size_t RING_SIZE = 4; ///< Capacity of the lookahead ring buffer.
+
+  Scanner* _scanner = nullptr; ///< The scanner tokens are pulled from, or nullptr to read `_tokens`.
+  std::vector<Token> _tokens; ///< The list of tokens to parse when not pulling from a scanner.
+  size_t _next = 1; ///< Position in `_tokens` of the next token to pull.
+
+  std::vector<Token> _lookahead; ///< Ring buffer holding the previous, current and next tokens.
+  size_t _current = 0; ///< The position of the current token in the token stream.
+  size_t _pulled = 1; ///< The number of tokens pulled into the ring buffer so far.
+
+  Lox::Reporter* _reporter; ///< Where syntax errors are reported.
+  bool _lazy_functions = false; ///< Whether function bodies are parsed on first call.
+  bool _had_error = false; ///< Whether this parser has reported a syntax error.
 
   std::vector<std::shared_ptr<Expr<R>>> _allocated_exprs; ///< List of allocated expressions for cleanup.
   std::vector<std::shared_ptr<Stmt<R>>> _allocated_stmts; ///< List of allocated statements for cleanup.
@@ -101,6 +184,16 @@ private:
    */
   std::shared_ptr<Stmt<R>> forStatement();
 
+  /**
+   * @brief Parses the range form of a 'for' statement, `for (var i in a..b step s)`, or
+   *        the iterating form, `for (var x in generator)`.
+   * 
+   * @tparam R The return type for the expression and statement nodes.
+   * @return A shared pointer to a `Stmt<R>::For` object representing the loop, without a
+   *         stop expression for the iterating form.
+   */
+  std::shared_ptr<Stmt<R>> rangeStatement();
+
   /**
    * @brief Parses an if statement.
    * 
@@ -124,6 +217,14 @@ private:
    */
   std::shared_ptr<Stmt<R>> returnStatement();
 
+  /**
+   * @brief Parses a yield statement.
+   * 
+   * @tparam R The type of the expression that will be parsed.
+   * @return A smart pointer to a `Stmt<R>::Yield` object, representing the parsed yield statement.
+   */
+  std::shared_ptr<Stmt<R>> yieldStatement();
+
   /**
    * @brief Parses a while statement.
    * 
@@ -156,6 +257,60 @@ private:
    */
   std::shared_ptr<Stmt<R>> function(const std::string& kind);
 
+  /**
+   * @brief Skips over a function body by matching its braces, deferring its parse to the first call.
+   * 
+   * @param name The name of the function, to report a body that fails to parse.
+   * @return A body that parses the skipped tokens when its statements are first requested.
+   */
+  std::shared_ptr<const FunctionBody<R>> lazyBody(const Token& name);
+
+  /**
+   * @brief Signature of a prefix parse function, called after its token has been consumed.
+   */
+  using PrefixRule = std::shared_ptr<Expr<R>> (Parser<R>::*)();
+
+  /**
+   * @brief Signature of an infix parse function, called with the already parsed left operand
+   * after its operator token has been consumed.
+   */
+  using InfixRule = std::shared_ptr<Expr<R>> (Parser<R>::*)(const std::shared_ptr<Expr<R>>&);
+
+  /**
+   * @struct ParseRule
+   * @brief A row of the expression parsing table describing how a token type is parsed.
+   */
+  struct ParseRule
+  {
+    PrefixRule prefix = nullptr; ///< Parses the token when it starts an expression.
+    InfixRule infix = nullptr; ///< Parses the token when it follows a left operand.
+    Precedence precedence = PREC_NONE; ///< How tightly the token binds as an infix operator.
+  };
+
+  /**
+   * @brief Returns the parsing table entry for the given token type.
+   * 
+   * @param type The token type to look up.
+   * @return The parse rule for the token type.
+   */
+  static const ParseRule& getRule(const TokenType& type);
+
+  /**
+   * @brief Builds the parsing table, indexed by token type.
+   * 
+   * @return The table of parse rules.
+   */
+  static std::array<ParseRule, END + 1> makeRules();
+
+  /**
+   * @brief Parses an expression whose operators bind at least as tightly as the given precedence.
+   * 
+   * @tparam R The type of the expression that will be parsed.
+   * @param precedence The lowest precedence an infix operator may have to be consumed.
+   * @return A smart pointer to the parsed expression.
+   */
+  std::shared_ptr<Expr<R>> parsePrecedence(const Precedence& precedence);
+
   /**
    * @brief Parses an assignment expression.
    * 
@@ -163,106 +318,115 @@ private:
    * @return A smart pointer to the parsed assignment expression.
    */
   std::shared_ptr<Expr<R>> assignment();
-  
+
   /**
-   * @brief Parses a ternary expression.
+   * @brief Builds a read-modify-write update of a variable.
    * 
    * @tparam R The type of the expression that will be parsed.
-   * @return A smart pointer to the parsed ternary expression.
+   * @param target The expression being updated, which must be a variable.
+   * @param oper The compound assignment, increment or decrement operator.
+   * @param value The right-hand operand, or nullptr for increment and decrement.
+   * @param postfix Whether the expression evaluates to the value before the update.
+   * @return A smart pointer to the parsed update expression.
    */
-  std::shared_ptr<Expr<R>> ternary();
+  std::shared_ptr<Expr<R>> update(const std::shared_ptr<Expr<R>>& target, const Token& oper,
+                                  const std::shared_ptr<Expr<R>>& value, const bool& postfix);
 
   /**
-   * @brief Parses a logical OR expression. 
+   * @brief Parses a parenthesized expression.
    * 
    * @tparam R The type of the expression that will be parsed.
-   * @return A smart pointer to the parsed logical OR expression.
+   * @return A smart pointer to the parsed grouping expression.
    */
-  std::shared_ptr<Expr<R>> logicalOr();
+  std::shared_ptr<Expr<R>> grouping();
 
   /**
-   * @brief Parses a logical AND expression.
+   * @brief Parses a number, string, boolean or nil literal.
    * 
    * @tparam R The type of the expression that will be parsed.
-   * @return A smart pointer to the parsed logical AND expression.
+   * @return A smart pointer to the parsed literal expression.
    */
-  std::shared_ptr<Expr<R>> logicalAnd();
+  std::shared_ptr<Expr<R>> literal();
 
   /**
-   * @brief Parses a comma expression.
+   * @brief Parses a variable reference.
    * 
    * @tparam R The type of the expression that will be parsed.
-   * @return A smart pointer to the parsed comma expression.
+   * @return A smart pointer to the parsed variable expression.
    */
-  std::shared_ptr<Expr<R>> comma();
+  std::shared_ptr<Expr<R>> variable();
 
   /**
-   * @brief Parses an equality expression.
+   * @brief Parses a unary expression.
    * 
    * @tparam R The type of the expression that will be parsed.
-   * @return A smart pointer to the parsed equality expression.
+   * @return A smart pointer to the parsed unary expression.
    */
-  std::shared_ptr<Expr<R>> equality();
+  std::shared_ptr<Expr<R>> unary();
 
   /**
-   * @brief Parses a comparison expression.
+   * @brief Parses a prefix increment or decrement expression.
    * 
    * @tparam R The type of the expression that will be parsed.
-   * @return A smart pointer to the parsed comparison expression.
+   * @return A smart pointer to the parsed update expression.
    */
-  std::shared_ptr<Expr<R>> comparison();
+  std::shared_ptr<Expr<R>> prefixUpdate();
 
   /**
-   * @brief Parses a term expression.
+   * @brief Parses the right operand of a binary or comma expression.
    * 
    * @tparam R The type of the expression that will be parsed.
-   * @return A smart pointer to the parsed term expression.
+   * @param left The already parsed left operand.
+   * @return A smart pointer to the parsed binary expression.
    */
-  std::shared_ptr<Expr<R>> term();
+  std::shared_ptr<Expr<R>> binary(const std::shared_ptr<Expr<R>>& left);
 
   /**
-   * @brief Parses a factor expression.
+   * @brief Parses the right operand of a logical AND or OR expression.
    * 
    * @tparam R The type of the expression that will be parsed.
-   * @return A smart pointer to the parsed factor expression.
+   * @param left The already parsed left operand.
+   * @return A smart pointer to the parsed logical expression.
    */
-  std::shared_ptr<Expr<R>> factor();
+  std::shared_ptr<Expr<R>> logical(const std::shared_ptr<Expr<R>>& left);
 
   /**
-   * @brief Parses a unary expression.
+   * @brief Parses the value of a plain or compound assignment.
    * 
    * @tparam R The type of the expression that will be parsed.
-   * @return A smart pointer to the parsed unary expression.
+   * @param left The assignment target, which must be a variable.
+   * @return A smart pointer to the parsed assignment expression.
    */
-  std::shared_ptr<Expr<R>> unary();
+  std::shared_ptr<Expr<R>> assign(const std::shared_ptr<Expr<R>>& left);
+
+  /**
+   * @brief Parses the branches of a ternary expression.
+   * 
+   * @tparam R The type of the expression that will be parsed.
+   * @param condition The already parsed condition.
+   * @return A smart pointer to the parsed ternary expression.
+   */
+  std::shared_ptr<Expr<R>> ternary(const std::shared_ptr<Expr<R>>& condition);
 
   /**
-   * @brief Parses a function call expression.
+   * @brief Completes the parsing of a function call expression.
    * 
    * @tparam R The type of the expression that will be parsed.
-   * @return A smart pointer to an `Expr<R>` object representing the parsed function call expression, or the 
-   * primary expression if no call is detected.
+   * @param callee A smart pointer to the callee expression, representing the function being called.
+   * @return A smart pointer to an `Expr<R>::Call` object representing the parsed function call expression,
+   * including the callee, the closing parenthesis token, and the list of arguments.
    */
-  std::shared_ptr<Expr<R>> call();
+  std::shared_ptr<Expr<R>> finishCall(const std::shared_ptr<Expr<R>>& callee);
 
-/**
- * @brief Completes the parsing of a function call expression.
- * 
- * @tparam R The type of the expression that will be parsed.
- * @param callee A smart pointer to the callee expression, representing the function being called.
- * @return A smart pointer to an `Expr<R>::Call` object representing the parsed function call expression,
- * including the callee, the closing parenthesis token, and the list of arguments.
- */
-  std::shared_ptr<Expr<R>> finishCall(const std::shared_ptr<const Expr<R>>& callee);
-  
   /**
-   * @brief Parses a primary expression.
+   * @brief Parses a postfix increment or decrement expression.
    * 
    * @tparam R The type of the expression that will be parsed.
-   * @return A smart pointer to the parsed primary expression.
+   * @param left The already parsed operand.
+   * @return A smart pointer to the parsed update expression.
    */
-  std::shared_ptr<Expr<R>> primary();
-  
+  std::shared_ptr<Expr<R>> postfix(const std::shared_ptr<Expr<R>>& left);
+
   /**
    * @brief Checks if the current token matches the given type and advances if it does.
    * 
@@ -277,7 +441,7 @@ private:
    * @param types The list of token types to match.
    * @return True if the token matches any of the types, otherwise false.
    */
-  bool match(const std::vector<TokenType>& types);
+  bool match(std::initializer_list<TokenType> types);
 
   /**
    * @brief Checks if the current token matches the given type.
@@ -287,6 +451,14 @@ private:
    */
   bool check(const TokenType& type);
 
+  /**
+   * @brief Checks if the token after the current one matches the given type.
+   * 
+   * @param type The token type to check.
+   * @return True if the next token matches, otherwise false.
+   */
+  bool checkNext(const TokenType& type);
+
   /**
    * @brief Checks if the parser has reached the end of the token list.
    * 
@@ -301,28 +473,46 @@ private:
    * @param message The error message if the token doesn't match.
    * @return The consumed token.
    */
-  Token consume(const TokenType& type, const std::string& message);
+  const Token& consume(const TokenType& type, const std::string& message);
 
   /**
    * @brief Peeks at the current token.
    * 
    * @return The current token.
    */
-  Token peek();
+  const Token& peek();
 
   /**
    * @brief Advances to the next token and returns the previous token.
    * 
    * @return The previous token.
    */
-  Token advance();
+  const Token& advance();
 
   /**
    * @brief Returns the previous token.
    * 
    * @return The previous token.
    */
-  Token previous();
+  const Token& previous();
+
+  /**
+   * @brief Returns the token at the given position, pulling tokens into the ring buffer as needed.
+   * 
+   * The reference is only valid until a few more tokens have been pulled, so callers that
+   * keep a token across further parsing must copy it.
+   * 
+   * @param position The position in the token stream, at most one past the current token.
+   * @return The token at the given position.
+   */
+  const Token& tokenAt(const size_t& position);
+
+  /**
+   * @brief Pulls the next token from the scanner or the token list.
+   * 
+   * @return The next token, repeating the END token once the input is exhausted.
+   */
+  Token pull();
 
   /**
    * @brief Creates a parse error, logs it, and returns a ParseError object.
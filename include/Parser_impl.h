@@ -12,14 +12,29 @@ std::vector<std::shared_ptr<Stmt<R>>> Parser<R>::parse()
 {
   std::vector<std::shared_ptr<Stmt<R>>> statements;
 
+  while (std::shared_ptr<Stmt<R>> stmt = parseNext())
+    statements.push_back(stmt);
+
+  return statements;
+}
+
+/**
+ * @brief Parses the next top-level declaration, skipping those with syntax errors.
+ * 
+ * @tparam R The type of the expression that will be parsed.
+ * @return A smart pointer to the parsed declaration, or nullptr once the tokens are exhausted.
+ */
+template <class R>
+std::shared_ptr<Stmt<R>> Parser<R>::parseNext()
+{
   while (!isAtEnd())
   {
     std::shared_ptr<Stmt<R>> stmt = declaration();
     if (stmt != nullptr)
-      statements.push_back(stmt);
+      return stmt;
   }
 
-  return statements;
+  return nullptr;
 }
 
 /**
@@ -31,7 +46,7 @@ std::vector<std::shared_ptr<Stmt<R>>> Parser<R>::parse()
 template <class R>
 std::shared_ptr<Expr<R>> Parser<R>::expression()
 {
-  return comma();
+  return parsePrecedence(PREC_COMMA);
 }
 
 /**
@@ -106,6 +121,7 @@ std::shared_ptr<Stmt<R>> Parser<R>::statement()
   if (match(IF)) return ifStatement();
   if (match(PRINT)) return printStatement();
   if (match(RETURN)) return returnStatement();
+  if (match(YIELD)) return yieldStatement();
   if (match(WHILE)) return whileStatement();
   if (match(BREAK) || match(CONTINUE)) return jumpStatement();
   if (match(LEFT_BRACE)) return std::make_shared<typename Stmt<R>::Block>(block());
@@ -129,7 +145,11 @@ std::shared_ptr<Stmt<R>> Parser<R>::forStatement()
   if (match(SEMICOLON))
     initializer = nullptr;
   else if (match(VAR))
+  {
+    if (check(IDENTIFIER) && checkNext(IN))
+      return rangeStatement();
     initializer = varDeclaration();
+  }
   else
     initializer = expressionStatement();
     
@@ -174,6 +194,42 @@ std::shared_ptr<Stmt<R>> Parser<R>::forStatement()
   return body;
 }
 
+/**
+ * @brief Parses the range form of a 'for' statement, `for (var i in a..b step s)`, or
+ *        the iterating form, `for (var x in generator)`.
+ * 
+ * Unlike the C-style loop this is not desugared into a `While`; the interpreter runs it
+ * as a native counted loop. The `step` clause is optional and `step` is only treated as
+ * a keyword in this position. Without `..` the loop takes each value of a generator, or
+ * calls any other callable until it returns nil.
+ * 
+ * @tparam R The return type for the expression and statement nodes.
+ * @return A shared pointer to a `Stmt<R>::For` object representing the loop, without a
+ *         stop expression for the iterating form.
+ */
+template<class R>
+std::shared_ptr<Stmt<R>> Parser<R>::rangeStatement()
+{
+  Token name = consume(IDENTIFIER, "Expect variable name.");
+  consume(IN, "Expect 'in' after loop variable.");
+
+  std::shared_ptr<Expr<R>> start = assignment();
+  std::shared_ptr<Expr<R>> stop = nullptr;
+  if (match(DOT_DOT))
+    stop = assignment();
+
+  std::shared_ptr<Expr<R>> step = nullptr;
+  if (stop != nullptr && check(IDENTIFIER) && peek().lexeme() == "step")
+  {
+    advance();
+    step = assignment();
+  }
+  consume(RIGHT_PAREN, "Expect ')' after for clauses.");
+
+  std::shared_ptr<Stmt<R>> body = statement();
+  return std::make_shared<typename Stmt<R>::For>(name, start, stop, step, body);
+}
+
 /**
  * @brief Parses an if statement.
  * 
@@ -228,6 +284,24 @@ std::shared_ptr<Stmt<R>> Parser<R>::returnStatement()
   return std::make_shared<typename Stmt<R>::Return>(keyword, value);
 }
 
+/**
+ * @brief Parses a yield statement.
+ * 
+ * @tparam R The type of the expression that will be parsed.
+ * @return A smart pointer to a `Stmt<R>::Yield` object, representing the parsed yield statement.
+ */
+template <class R>
+std::shared_ptr<Stmt<R>> Parser<R>::yieldStatement()
+{
+  Token keyword = previous();
+  std::shared_ptr<Expr<R>> value = nullptr;
+  if (!check(SEMICOLON))
+    value = expression();
+
+  consume(SEMICOLON, "Expect ';' after yield value.");
+  return std::make_shared<typename Stmt<R>::Yield>(keyword, value);
+}
+
 /**
  * @brief Parses a while statement.
  * 
@@ -257,7 +331,7 @@ template <class R>
 std::shared_ptr<Stmt<R>> Parser<R>::jumpStatement()
 {
   Token keyword = previous();
-  consume(SEMICOLON, "Expect ';' after '" + keyword.lexeme + "'.");
+  consume(SEMICOLON, "Expect ';' after '" + std::string(keyword.lexeme()) + "'.");
   return std::make_shared<typename Stmt<R>::Jump>(keyword);
 }
 
@@ -302,206 +376,259 @@ std::shared_ptr<Stmt<R>> Parser<R>::function(const std::string& kind)
   consume(RIGHT_PAREN, "Expect ')' after parameters.");
 
   consume(LEFT_BRACE, "Expect '{' before " + kind + " body");
+  if (_lazy_functions)
+    return std::make_shared<typename Stmt<R>::Function>(name, parameters, lazyBody(name));
+
   std::vector<std::shared_ptr<const Stmt<R>>> body = block();
-  return std::make_shared<typename Stmt<R>::Function>(name, parameters, body);
+  return std::make_shared<typename Stmt<R>::Function>(name, parameters, std::make_shared<const FunctionBody<R>>(body));
 }
 
 /**
- * @brief Parses an assignment expression.
+ * @brief Skips over a function body by matching its braces, deferring its parse to the first call.
+ * 
+ * Only the balance of braces and parentheses is validated here; the body is rescanned
+ * from just after its opening brace when it is parsed.
  * 
  * @tparam R The type of the expression that will be parsed.
- * @return A smart pointer to the parsed assignment expression.
+ * @param name The name of the function, to report a body that fails to parse.
+ * @return A body that parses the skipped tokens when its statements are first requested.
  */
 template <class R>
-std::shared_ptr<Expr<R>> Parser<R>::assignment()
+std::shared_ptr<const FunctionBody<R>> Parser<R>::lazyBody(const Token& name)
 {
-  std::shared_ptr<Expr<R>> expr = ternary();
+  const Token brace = previous();
 
-  if (match(EQUAL))
+  int braces = 1;
+  int parens = 0;
+  while (!(braces == 1 && check(RIGHT_BRACE)))
   {
-    Token equals = previous();
-    std::shared_ptr<Expr<R>> value = assignment();
-    
-    // Attempt to cast expr to a std::shared_ptr of Expr<R>::Variable
-    auto variableExpr = std::dynamic_pointer_cast<typename Expr<R>::Variable>(expr);
-    if (variableExpr) {
-        Token name = variableExpr->name;
-        return std::make_shared<typename Expr<R>::Assign>(name, value);
-    }
+    if (isAtEnd()) throw error(peek(), "Expect '}' after block.");
 
-    error(equals, "Invalid assignment target.");
+    switch (advance().type)
+    {
+      case LEFT_BRACE: ++braces; break;
+      case RIGHT_BRACE: --braces; break;
+      case LEFT_PAREN: ++parens; break;
+      case RIGHT_PAREN: --parens; break;
+      default: break;
+    }
   }
 
-  
-  return expr;
+  if (parens != 0)
+    throw error(peek(), "Unbalanced parentheses in function body.");
+  advance();
+
+  return deferredBody(*brace.source, brace.offset + brace.length, name);
 }
 
 /**
- * @brief Parses a ternary expression.
+ * @brief Creates a function body that is parsed from the source on first use.
  * 
  * @tparam R The type of the expression that will be parsed.
- * @return A smart pointer to the parsed ternary expression.
+ * @param source The source the function was declared in.
+ * @param offset The offset just after the body's opening brace.
+ * @param name The name of the function, to report a body that fails to parse.
+ * @return The deferred body.
  */
 template <class R>
-std::shared_ptr<Expr<R>> Parser<R>::ternary()
+std::shared_ptr<const FunctionBody<R>> Parser<R>::deferredBody(const Source& source, const size_t& offset, const Token& name)
 {
-  std::shared_ptr<Expr<R>> expr = logicalOr();
+  auto parse = [&source, offset, name](Lox::Reporter& reporter) {
+    Scanner scanner(source, reporter, offset);
+    Parser<R> parser(scanner, reporter);
+    parser._lazy_functions = true;
 
-  if (match(QUESTION_MARK))
-  {
-    std::shared_ptr<Expr<R>> then_branch = expression();
-    consume(COLON, "Expect ':' after then branch of ternary expression.");
-    std::shared_ptr<Expr<R>> else_branch = ternary();
-    expr = std::make_shared<typename Expr<R>::Ternary>(expr, then_branch, else_branch);
-  }
+    std::vector<std::shared_ptr<const Stmt<R>>> statements;
+    try
+    {
+      statements = parser.block();
+    }
+    catch (const ParseError& error) {}
 
-  return expr;
+    if (parser._had_error)
+      throw RuntimeError(name, "Syntax error in body of '" + std::string(name.lexeme()) + "'.");
+    return statements;
+  };
+
+  return std::make_shared<const FunctionBody<R>>(parse, offset);
 }
 
 /**
- * @brief Parses a logical OR expression. 
+ * @brief Returns the parsing table entry for the given token type.
+ * 
  * @tparam R The type of the expression that will be parsed.
- * @return A smart pointer to the parsed logical OR expression.
+ * @param type The token type to look up.
+ * @return The parse rule for the token type.
  */
 template <class R>
-std::shared_ptr<Expr<R>> Parser<R>::logicalOr()
+const typename Parser<R>::ParseRule& Parser<R>::getRule(const TokenType& type)
 {
-  std::shared_ptr<Expr<R>> expr = logicalAnd();
-
-  while (match(OR))
-  {
-    Token oper = previous();
-    std::shared_ptr<Expr<R>> right = logicalAnd();
-    expr = std::make_shared<typename Expr<R>::Logical>(expr, oper, right);
-  }
-
-  return expr;
+  static const std::array<ParseRule, END + 1> rules = makeRules();
+  return rules[type];
 }
 
 /**
- * @brief Parses a logical AND expression.
+ * @brief Builds the parsing table, indexed by token type.
+ * 
+ * Token types without an entry can neither start an expression nor continue one.
  * 
  * @tparam R The type of the expression that will be parsed.
- * @return A smart pointer to the parsed logical AND expression.
+ * @return The table of parse rules.
  */
 template <class R>
-std::shared_ptr<Expr<R>> Parser<R>::logicalAnd()
+std::array<typename Parser<R>::ParseRule, END + 1> Parser<R>::makeRules()
 {
-  std::shared_ptr<Expr<R>> expr = equality();
+  std::array<ParseRule, END + 1> rules{};
 
-  while (match(AND))
-  {
-    Token oper = previous();
-    std::shared_ptr<Expr<R>> right = equality();
-    expr = std::make_shared<typename Expr<R>::Logical>(expr, oper, right);
-  }
+  rules[LEFT_PAREN]    = { &Parser<R>::grouping,     &Parser<R>::finishCall, PREC_CALL };
+  rules[COMMA]         = { nullptr,                  &Parser<R>::binary,     PREC_COMMA };
+  rules[MINUS]         = { &Parser<R>::unary,        &Parser<R>::binary,     PREC_TERM };
+  rules[PLUS]          = { nullptr,                  &Parser<R>::binary,     PREC_TERM };
+  rules[SLASH]         = { nullptr,                  &Parser<R>::binary,     PREC_FACTOR };
+  rules[STAR]          = { nullptr,                  &Parser<R>::binary,     PREC_FACTOR };
+  rules[QUESTION_MARK] = { nullptr,                  &Parser<R>::ternary,    PREC_TERNARY };
+  rules[BANG]          = { &Parser<R>::unary,        nullptr,                PREC_NONE };
+  rules[BANG_EQUAL]    = { nullptr,                  &Parser<R>::binary,     PREC_EQUALITY };
+  rules[EQUAL]         = { nullptr,                  &Parser<R>::assign,     PREC_ASSIGNMENT };
+  rules[EQUAL_EQUAL]   = { nullptr,                  &Parser<R>::binary,     PREC_EQUALITY };
+  rules[GREATER]       = { nullptr,                  &Parser<R>::binary,     PREC_COMPARISON };
+  rules[GREATER_EQUAL] = { nullptr,                  &Parser<R>::binary,     PREC_COMPARISON };
+  rules[LESS]          = { nullptr,                  &Parser<R>::binary,     PREC_COMPARISON };
+  rules[LESS_EQUAL]    = { nullptr,                  &Parser<R>::binary,     PREC_COMPARISON };
+  rules[PLUS_EQUAL]    = { nullptr,                  &Parser<R>::assign,     PREC_ASSIGNMENT };
+  rules[MINUS_EQUAL]   = { nullptr,                  &Parser<R>::assign,     PREC_ASSIGNMENT };
+  rules[STAR_EQUAL]    = { nullptr,                  &Parser<R>::assign,     PREC_ASSIGNMENT };
+  rules[SLASH_EQUAL]   = { nullptr,                  &Parser<R>::assign,     PREC_ASSIGNMENT };
+  rules[PLUS_PLUS]     = { &Parser<R>::prefixUpdate, &Parser<R>::postfix,    PREC_POSTFIX };
+  rules[MINUS_MINUS]   = { &Parser<R>::prefixUpdate, &Parser<R>::postfix,    PREC_POSTFIX };
+  rules[IDENTIFIER]    = { &Parser<R>::variable,     nullptr,                PREC_NONE };
+  rules[STRING]        = { &Parser<R>::literal,      nullptr,                PREC_NONE };
+  rules[NUMBER]        = { &Parser<R>::literal,      nullptr,                PREC_NONE };
+  rules[AND]           = { nullptr,                  &Parser<R>::logical,    PREC_AND };
+  rules[OR]            = { nullptr,                  &Parser<R>::logical,    PREC_OR };
+  rules[FALSE]         = { &Parser<R>::literal,      nullptr,                PREC_NONE };
+  rules[TRUE]          = { &Parser<R>::literal,      nullptr,                PREC_NONE };
+  rules[NIL]           = { &Parser<R>::literal,      nullptr,                PREC_NONE };
 
-  return expr;
+  return rules;
 }
 
 /**
- * @brief Parses a comma expression.
+ * @brief Parses an expression whose operators bind at least as tightly as the given precedence.
+ * 
+ * The prefix rule of the current token parses the leftmost operand, then infix rules are
+ * applied for as long as the next operator binds tightly enough. A postfix increment or
+ * decrement completes a unary operand, so no call or second postfix operator may follow it.
  * 
  * @tparam R The type of the expression that will be parsed.
- * @return A smart pointer to the parsed comma expression.
+ * @param precedence The lowest precedence an infix operator may have to be consumed.
+ * @return A smart pointer to the parsed expression.
  */
 template <class R>
-std::shared_ptr<Expr<R>> Parser<R>::comma()
+std::shared_ptr<Expr<R>> Parser<R>::parsePrecedence(const Precedence& precedence)
 {
-  std::shared_ptr<Expr<R>> expr = assignment();
+  PrefixRule prefix = getRule(peek().type).prefix;
+  if (prefix == nullptr)
+    throw error(peek(), "Expect expression.");
+
+  advance();
+  std::shared_ptr<Expr<R>> expr = (this->*prefix)();
 
-  while (match(COMMA))
+  Precedence ceiling = PREC_PRIMARY;
+  while (true)
   {
-    Token oper = previous();
-    std::shared_ptr<Expr<R>> right = assignment();
-    expr = std::make_shared<typename Expr<R>::Binary>(expr, oper, right);
+    const ParseRule& rule = getRule(peek().type);
+    if (rule.precedence < precedence || rule.precedence > ceiling)
+      break;
+
+    advance();
+    expr = (this->*rule.infix)(expr);
+    ceiling = rule.precedence == PREC_POSTFIX ? PREC_UNARY : rule.precedence;
   }
 
   return expr;
 }
 
 /**
- * @brief Parses an equality expression.
+ * @brief Parses an assignment expression.
  * 
  * @tparam R The type of the expression that will be parsed.
- * @return A smart pointer to the parsed equality expression.
+ * @return A smart pointer to the parsed assignment expression.
  */
 template <class R>
-std::shared_ptr<Expr<R>> Parser<R>::equality()
+std::shared_ptr<Expr<R>> Parser<R>::assignment()
 {
-  std::shared_ptr<Expr<R>> expr = comparison();
-
-  while (match({ BANG_EQUAL, EQUAL_EQUAL }))
-  {
-    Token oper = previous();
-    std::shared_ptr<Expr<R>> right = comparison();
-    expr = std::make_shared<typename Expr<R>::Binary>(expr, oper, right);
-  }
-
-  return expr;
+  return parsePrecedence(PREC_ASSIGNMENT);
 }
 
 /**
- * @brief Parses a comparison expression.
+ * @brief Builds a read-modify-write update of a variable.
  * 
  * @tparam R The type of the expression that will be parsed.
- * @return A smart pointer to the parsed comparison expression.
+ * @param target The expression being updated, which must be a variable.
+ * @param oper The compound assignment, increment or decrement operator.
+ * @param value The right-hand operand, or nullptr for increment and decrement.
+ * @param postfix Whether the expression evaluates to the value before the update.
+ * @return A smart pointer to the parsed update expression.
  */
 template <class R>
-std::shared_ptr<Expr<R>> Parser<R>::comparison()
+std::shared_ptr<Expr<R>> Parser<R>::update(const std::shared_ptr<Expr<R>>& target, const Token& oper,
+                                           const std::shared_ptr<Expr<R>>& value, const bool& postfix)
 {
-  std::shared_ptr<Expr<R>> expr = term();
+  auto variableExpr = std::dynamic_pointer_cast<typename Expr<R>::Variable>(target);
+  if (variableExpr)
+    return std::make_shared<typename Expr<R>::Update>(variableExpr->name, oper, value, postfix);
 
-  while (match({ GREATER, GREATER_EQUAL, LESS, LESS_EQUAL }))
-  {
-    Token oper = previous();
-    std::shared_ptr<Expr<R>> right = term();
-    expr = std::make_shared<typename Expr<R>::Binary>(expr, oper, right);
-  }
-
-  return expr;
+  error(oper, "Invalid assignment target.");
+  return target;
 }
 
 /**
- * @brief Parses a term expression.
+ * @brief Parses a parenthesized expression.
  * 
  * @tparam R The type of the expression that will be parsed.
- * @return A smart pointer to the parsed term expression.
+ * @return A smart pointer to the parsed grouping expression.
  */
 template <class R>
-std::shared_ptr<Expr<R>> Parser<R>::term()
+std::shared_ptr<Expr<R>> Parser<R>::grouping()
 {
-  std::shared_ptr<Expr<R>> expr = factor();
-
-  while (match({ MINUS, PLUS }))
-  {
-    Token oper = previous();
-    std::shared_ptr<Expr<R>> right = factor();
-    expr = std::make_shared<typename Expr<R>::Binary>(expr, oper, right);
-  }
-
-  return expr;
+  std::shared_ptr<Expr<R>> expr = expression();
+  consume(RIGHT_PAREN, "Expect ')' after expression.");
+  return std::make_shared<typename Expr<R>::Grouping>(expr);
 }
 
 /**
- * @brief Parses a factor expression.
+ * @brief Parses a number, string, boolean or nil literal.
  * 
  * @tparam R The type of the expression that will be parsed.
- * @return A smart pointer to the parsed factor expression.
+ * @return A smart pointer to the parsed literal expression.
  */
 template <class R>
-std::shared_ptr<Expr<R>> Parser<R>::factor()
+std::shared_ptr<Expr<R>> Parser<R>::literal()
 {
-  std::shared_ptr<Expr<R>> expr = unary();
-
-  while (match({ SLASH, STAR }))
+  switch (previous().type)
   {
-    Token oper = previous();
-    std::shared_ptr<Expr<R>> right = unary();
-    expr = std::make_shared<typename Expr<R>::Binary>(expr, oper, right);
+    case FALSE:
+      return std::make_shared<typename Expr<R>::Literal>(false);
+    case TRUE:
+      return std::make_shared<typename Expr<R>::Literal>(true);
+    case NIL:
+      return std::make_shared<typename Expr<R>::Literal>(std::monostate()); // NULL
+    default:
+      return std::make_shared<typename Expr<R>::Literal>(previous().literal());
   }
+}
 
-  return expr;
+/**
+ * @brief Parses a variable reference.
+ * 
+ * @tparam R The type of the expression that will be parsed.
+ * @return A smart pointer to the parsed variable expression.
+ */
+template <class R>
+std::shared_ptr<Expr<R>> Parser<R>::variable()
+{
+  return std::make_shared<typename Expr<R>::Variable>(previous());
 }
 
 /**
@@ -513,36 +640,97 @@ std::shared_ptr<Expr<R>> Parser<R>::factor()
 template <class R>
 std::shared_ptr<Expr<R>> Parser<R>::unary()
 {
-  if (match({ BANG, MINUS }))
-  {
-    Token oper = previous();
-    std::shared_ptr<Expr<R>> right = unary();
-    return std::make_shared<typename Expr<R>::Unary>(oper, right);
-  }
+  Token oper = previous();
+  std::shared_ptr<Expr<R>> right = parsePrecedence(PREC_UNARY);
+  return std::make_shared<typename Expr<R>::Unary>(oper, right);
+}
+
+/**
+ * @brief Parses a prefix increment or decrement expression.
+ * 
+ * @tparam R The type of the expression that will be parsed.
+ * @return A smart pointer to the parsed update expression.
+ */
+template <class R>
+std::shared_ptr<Expr<R>> Parser<R>::prefixUpdate()
+{
+  Token oper = previous();
+  std::shared_ptr<Expr<R>> right = parsePrecedence(PREC_UNARY);
+  return update(right, oper, nullptr, false);
+}
 
-  return call();
+/**
+ * @brief Parses the right operand of a binary or comma expression.
+ * 
+ * The right operand is parsed one precedence level higher, making the operators left-associative.
+ * 
+ * @tparam R The type of the expression that will be parsed.
+ * @param left The already parsed left operand.
+ * @return A smart pointer to the parsed binary expression.
+ */
+template <class R>
+std::shared_ptr<Expr<R>> Parser<R>::binary(const std::shared_ptr<Expr<R>>& left)
+{
+  Token oper = previous();
+  std::shared_ptr<Expr<R>> right = parsePrecedence(static_cast<Precedence>(getRule(oper.type).precedence + 1));
+  return std::make_shared<typename Expr<R>::Binary>(left, oper, right);
 }
 
 /**
- * @brief Parses a function call expression.
+ * @brief Parses the right operand of a logical AND or OR expression.
  * 
- * @return A smart pointer to an `Expr<R>` object representing the parsed function call expression, or the 
- * primary expression if no call is detected.
+ * @tparam R The type of the expression that will be parsed.
+ * @param left The already parsed left operand.
+ * @return A smart pointer to the parsed logical expression.
  */
 template <class R>
-std::shared_ptr<Expr<R>> Parser<R>::call()
+std::shared_ptr<Expr<R>> Parser<R>::logical(const std::shared_ptr<Expr<R>>& left)
 {
-  std::shared_ptr<Expr<R>> expr = primary();
+  Token oper = previous();
+  std::shared_ptr<Expr<R>> right = parsePrecedence(static_cast<Precedence>(getRule(oper.type).precedence + 1));
+  return std::make_shared<typename Expr<R>::Logical>(left, oper, right);
+}
 
-  while (true)
-  {
-    if (match(LEFT_PAREN))
-      expr = finishCall(expr);
-    else
-      break;
-  }
+/**
+ * @brief Parses the value of a plain or compound assignment.
+ * 
+ * The value is parsed at assignment precedence, making assignment right-associative.
+ * 
+ * @tparam R The type of the expression that will be parsed.
+ * @param left The assignment target, which must be a variable.
+ * @return A smart pointer to the parsed assignment expression.
+ */
+template <class R>
+std::shared_ptr<Expr<R>> Parser<R>::assign(const std::shared_ptr<Expr<R>>& left)
+{
+  Token equals = previous();
+  std::shared_ptr<Expr<R>> value = assignment();
 
-  return expr;
+  if (equals.type != EQUAL)
+    return update(left, equals, value, false);
+
+  auto variableExpr = std::dynamic_pointer_cast<typename Expr<R>::Variable>(left);
+  if (variableExpr)
+    return std::make_shared<typename Expr<R>::Assign>(variableExpr->name, value);
+
+  error(equals, "Invalid assignment target.");
+  return left;
+}
+
+/**
+ * @brief Parses the branches of a ternary expression.
+ * 
+ * @tparam R The type of the expression that will be parsed.
+ * @param condition The already parsed condition.
+ * @return A smart pointer to the parsed ternary expression.
+ */
+template <class R>
+std::shared_ptr<Expr<R>> Parser<R>::ternary(const std::shared_ptr<Expr<R>>& condition)
+{
+  std::shared_ptr<Expr<R>> then_branch = expression();
+  consume(COLON, "Expect ':' after then branch of ternary expression.");
+  std::shared_ptr<Expr<R>> else_branch = parsePrecedence(PREC_TERNARY);
+  return std::make_shared<typename Expr<R>::Ternary>(condition, then_branch, else_branch);
 }
 
 /**
@@ -553,7 +741,7 @@ std::shared_ptr<Expr<R>> Parser<R>::call()
  * including the callee, the closing parenthesis token, and the list of arguments.
  */
 template <class R>
-std::shared_ptr<Expr<R>> Parser<R>::finishCall(const std::shared_ptr<const Expr<R>>& callee)
+std::shared_ptr<Expr<R>> Parser<R>::finishCall(const std::shared_ptr<Expr<R>>& callee)
 {
   std::vector<std::shared_ptr<const Expr<R>>> arguments;
 
@@ -572,37 +760,16 @@ std::shared_ptr<Expr<R>> Parser<R>::finishCall(const std::shared_ptr<const Expr<
 }
 
 /**
- * @brief Parses a primary expression.
+ * @brief Parses a postfix increment or decrement expression.
  * 
  * @tparam R The type of the expression that will be parsed.
- * @return A smart pointer to the parsed primary expression.
+ * @param left The already parsed operand.
+ * @return A smart pointer to the parsed update expression.
  */
 template <class R>
-std::shared_ptr<Expr<R>> Parser<R>::primary()
+std::shared_ptr<Expr<R>> Parser<R>::postfix(const std::shared_ptr<Expr<R>>& left)
 {
-  if (match(FALSE))
-    return std::make_shared<typename Expr<R>::Literal>(false);
-
-  if (match(TRUE))
-    return std::make_shared<typename Expr<R>::Literal>(true);
-
-  if (match(NIL))
-    return std::make_shared<typename Expr<R>::Literal>(std::monostate()); // NULL
-
-  if (match({ NUMBER, STRING }))
-    return std::make_shared<typename Expr<R>::Literal>(previous().literal);
-
-  if (match(IDENTIFIER))
-    return std::make_shared<typename Expr<R>::Variable>(previous());
-
-  if (match(LEFT_PAREN))
-  {
-    std::shared_ptr<Expr<R>> expr = expression();
-    consume(RIGHT_PAREN, "Expect ')' after expression.");
-    return std::make_shared<typename Expr<R>::Grouping>(expr);
-  }
-
-  throw error(peek(), "Expect expression.");
+  return update(left, previous(), nullptr, true);
 }
 
 /**
@@ -632,7 +799,7 @@ bool Parser<R>::match(const TokenType& type)
  * @return True if the token matches any of the types, otherwise false.
  */
 template <class R>
-bool Parser<R>::match(const std::vector<TokenType>& types)
+bool Parser<R>::match(std::initializer_list<TokenType> types)
 {
   for (TokenType type : types)
     if (check(type))
@@ -657,6 +824,20 @@ bool Parser<R>::check(const TokenType& type)
   return peek().type == type;
 }
 
+/**
+ * @brief Checks if the token after the current one matches the given type.
+ * 
+ * @tparam R The type of the expression that will be parsed.
+ * @param type The token type to check.
+ * @return True if the next token matches, otherwise false.
+ */
+template <class R>
+bool Parser<R>::checkNext(const TokenType& type)
+{
+  if (isAtEnd()) return false;
+  return tokenAt(_current + 1).type == type;
+}
+
 /**
  * @brief Checks if the parser has reached the end of the token list.
  * 
@@ -678,7 +859,7 @@ bool Parser<R>::isAtEnd()
  * @return The consumed token.
  */
 template <class R>
-Token Parser<R>::consume(const TokenType& type, const std::string& message)
+const Token& Parser<R>::consume(const TokenType& type, const std::string& message)
 {
   if (check(type)) return advance();
 
@@ -692,9 +873,9 @@ Token Parser<R>::consume(const TokenType& type, const std::string& message)
  * @return The current token.
  */
 template <class R>
-Token Parser<R>::peek()
+const Token& Parser<R>::peek()
 {
-  return _tokens[_current];
+  return tokenAt(_current);
 }
 
 /**
@@ -704,7 +885,7 @@ Token Parser<R>::peek()
  * @return The previous token.
  */
 template <class R>
-Token Parser<R>::advance()
+const Token& Parser<R>::advance()
 {
   if (!isAtEnd()) ++_current;
   return previous();
@@ -717,9 +898,42 @@ Token Parser<R>::advance()
  * @return The previous token.
  */
 template <class R>
-Token Parser<R>::previous()
+const Token& Parser<R>::previous()
 {
-  return _tokens[_current - 1];
+  return _lookahead[(_current - 1) % RING_SIZE];
+}
+
+/**
+ * @brief Returns the token at the given position, pulling tokens into the ring buffer as needed.
+ * 
+ * @tparam R The type of the expression that will be parsed.
+ * @param position The position in the token stream, at most one past the current token.
+ * @return The token at the given position.
+ */
+template <class R>
+const Token& Parser<R>::tokenAt(const size_t& position)
+{
+  while (_pulled <= position)
+    _lookahead[_pulled++ % RING_SIZE] = pull();
+
+  return _lookahead[position % RING_SIZE];
+}
+
+/**
+ * @brief Pulls the next token from the scanner or the token list.
+ * 
+ * @tparam R The type of the expression that will be parsed.
+ * @return The next token, repeating the END token once the input is exhausted.
+ */
+template <class R>
+Token Parser<R>::pull()
+{
+  if (_scanner != nullptr)
+    return _scanner->nextToken();
+
+  if (_next < _tokens.size())
+    return _tokens[_next++];
+  return _tokens.back();
 }
 
 /**
@@ -733,7 +947,8 @@ Token Parser<R>::previous()
 template <class R>
 ParseError Parser<R>::error(const Token& token, const std::string& message)
 {
-  Lox::error(token, message);
+  _reporter->error(token, message);
+  _had_error = true;
   return ParseError(message);
 }
 
@@ -0,0 +1,197 @@
+/**
+ * @file Program.h
+ * @brief The embedding API of libcpplox: scripts compiled once into an immutable
+ *        Program, and lightweight Contexts that run it and call its functions.
+ *
+ * A host compiles a script once, then creates a Context per request, thread or
+ * tenant. Contexts share the Program's text and syntax tree but nothing else, so
+ * several can run at once on different threads.
+ *
+ * @code
+ * std::shared_ptr<const Program> program = Program::compile("fun add(a, b) { return a + b; }");
+ * Context context(program);
+ * Context::Function add = context.function("add");
+ * LiteralValue sum = context.call(add, { 1.0, 2.0 });
+ * @endcode
+ */
+
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Interpreter.h"
+#include "LoxCallable.h"
+#include "Source.h"
+#include "Stmt.h"
+#include "utils.h"
+
+/**
+ * @brief Thrown when a script passed to `Program::compile` has syntax errors.
+ *
+ * The message holds every error reported, one per line.
+ */
+class CompileError : public std::runtime_error
+{
+public:
+  CompileError(const std::string& message)
+    : std::runtime_error(message) {}
+};
+
+/**
+ * @class Program
+ * @brief The text and syntax tree of a script, compiled once and never modified,
+ *        so that it can be shared by every Context running it.
+ */
+class Program
+{
+public:
+  /**
+   * @brief Scans and parses a script.
+   * @param text The source code of the script.
+   * @return The compiled program.
+   * @throws CompileError if the script has syntax errors.
+   */
+  static std::shared_ptr<const Program> compile(std::string text);
+
+  /**
+   * @brief Scans and parses a script file, mapping it into memory if possible.
+   * @param path The path of the script.
+   * @return The compiled program.
+   * @throws std::runtime_error if the file cannot be opened.
+   * @throws CompileError if the script has syntax errors.
+   */
+  static std::shared_ptr<const Program> load(const std::string& path);
+
+  /**
+   * @brief Returns the text of the script.
+   * @return The source the syntax tree refers to.
+   */
+  const Source& source() const { return *_source; }
+
+  /**
+   * @brief Returns the top-level statements of the script.
+   * @return The syntax tree.
+   */
+  const std::vector<std::shared_ptr<Stmt<LiteralValue>>>& statements() const { return _statements; }
+
+private:
+  std::unique_ptr<const Source> _source; ///< The text of the script.
+  std::vector<std::shared_ptr<Stmt<LiteralValue>>> _statements; ///< Its top-level statements.
+
+  /**
+   * @brief Scans and parses a script.
+   * @param source The text of the script.
+   * @throws CompileError if the script has syntax errors.
+   */
+  Program(std::unique_ptr<const Source> source);
+};
+
+/**
+ * @class Context
+ * @brief An interpreter with globals of its own that has run a Program, and from
+ *        which the host calls the functions the program defines.
+ *
+ * Functions are looked up once by name and then called through the returned
+ * handle, without looking them up or parsing anything again. Arguments passed by
+ * reference are copied into the parameters, so a string longer than the short-string
+ * buffer is allocated again on every call; arguments the host hands over are moved
+ * into the parameters instead, without copying.
+ */
+class Context
+{
+public:
+  /**
+   * @brief A function defined by the program, resolved for calling.
+   */
+  class Function
+  {
+  public:
+    /**
+     * @brief Returns the number of arguments the function expects.
+     * @return The arity of the function.
+     */
+    size_t arity() const { return _arity; }
+
+  private:
+    friend class Context;
+
+    Function(std::shared_ptr<LoxCallable> callable)
+      : _callable(std::move(callable)), _arity(_callable->arity()) {}
+
+    std::shared_ptr<LoxCallable> _callable; ///< The function.
+    size_t _arity; ///< The number of arguments it expects.
+  };
+
+  /**
+   * @brief Creates an interpreter and runs the program's top-level statements in it,
+   *        and the fibers they start.
+   * @param program The program to run, retained by the context.
+   * @param out The stream `print` writes to.
+   * @param err The stream runtime errors of the top-level statements are reported to.
+   * @throws std::runtime_error if the top-level statements raise a runtime error.
+   */
+  Context(std::shared_ptr<const Program> program, std::ostream& out = std::cout, std::ostream& err = std::cerr);
+
+  Context(const Context&) = delete;
+  Context& operator=(const Context&) = delete;
+
+  /**
+   * @brief Looks up a function among the globals.
+   * @param name The name of the function.
+   * @return The function, to be passed to `call`.
+   * @throws std::invalid_argument if there is no such global or it is not callable.
+   */
+  Function function(std::string_view name) const;
+
+  /**
+   * @brief Returns the value of a global.
+   * @param name The name of the global.
+   * @return The value.
+   * @throws std::invalid_argument if there is no such global.
+   */
+  const LiteralValue& global(std::string_view name) const;
+
+  /**
+   * @brief Calls a function with host values.
+   * @param function The function, looked up in this context.
+   * @param arguments The arguments, one per parameter.
+   * @return The value the function returned.
+   * @throws std::invalid_argument if the number of arguments does not match the function's arity.
+   * @throws RuntimeError if the function raises a runtime error.
+   */
+  LiteralValue call(const Function& function, const std::vector<LiteralValue>& arguments);
+
+  /**
+   * @brief Calls a function with host values, moving them into its parameters.
+   * @param function The function, looked up in this context.
+   * @param arguments The arguments, one per parameter, moved from.
+   * @return The value the function returned.
+   * @throws std::invalid_argument if the number of arguments does not match the function's arity.
+   * @throws RuntimeError if the function raises a runtime error.
+   */
+  LiteralValue call(const Function& function, std::vector<LiteralValue>&& arguments);
+
+  /**
+   * @brief Returns the interpreter of the context, e.g. to define native functions.
+   * @return The interpreter.
+   */
+  Interpreter& interpreter() { return _interpreter; }
+
+private:
+  std::shared_ptr<const Program> _program; ///< The program run, which functions refer to.
+  Lox::Reporter _reporter; ///< Where runtime errors are reported.
+  Interpreter _interpreter; ///< The interpreter holding the globals.
+
+  /**
+   * @brief Checks the number of arguments a host passes to a function.
+   * @param function The function.
+   * @param count The number of arguments.
+   * @throws std::invalid_argument if the number does not match the function's arity.
+   */
+  static void checkArity(const Function& function, const size_t& count);
+};
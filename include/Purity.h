@@ -0,0 +1,57 @@
+/**
+ * @file Purity.h
+ * @brief Conservative proofs that Lox expressions have no effects beyond their value,
+ *        so that they may be evaluated in any order, or at the same time.
+ *
+ * An expression is pure if it only reads variables, and only calls Lox functions
+ * that are pure in turn. A function is pure if its body neither prints, assigns,
+ * declares variables or functions, runs range loops nor yields, and every
+ * expression in it is pure. Declarations are ruled out because `var` defines its
+ * variable in the interpreter's top-level scope, which the calls would then share.
+ *
+ * Callees are resolved by name among the top-level variables of the interpreter, as
+ * they are when the call runs; native functions are never pure. Since those variables
+ * may be assigned other functions later, a proof keeps what it found in each, and
+ * only holds as long as they are unchanged.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Expr.h"
+
+class Interpreter;
+
+namespace Purity
+{
+  /**
+   * @brief Whether an expression is pure, and the callees that was found with.
+   */
+  struct Proof
+  {
+    bool pure = false; /**< Whether evaluating the expression has no effects beyond its value */
+    std::vector<std::pair<std::string, std::shared_ptr<LoxCallable>>> callees; /**< Each top-level variable a callee was looked up in, with the function it held, or null */
+  };
+
+  /**
+   * @brief Checks whether an expression is pure.
+   * @param expr The expression.
+   * @param interpreter The interpreter that would evaluate it, whose top-level
+   *        variables the callees are looked up in.
+   * @return The proof.
+   */
+  Proof prove(const Expr<LiteralValue>& expr, const Interpreter& interpreter);
+
+  /**
+   * @brief Checks whether a proof still holds, i.e. its callees are bound to the same
+   *        functions as when it was made.
+   * @param proof The proof.
+   * @param interpreter The interpreter the proof was made for.
+   * @return True if every callee is unchanged.
+   */
+  bool holds(const Proof& proof, const Interpreter& interpreter);
+}
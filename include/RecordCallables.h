@@ -0,0 +1,230 @@
+/**
+ * @file RecordCallables.h
+ * @brief The native functions that stream the records of large files to a Lox
+ *        callback: `eachLine` and `eachCsv`, the records they pass, and `fieldCount`
+ *        and `fieldNumber`, which look at a record without copying out of it.
+ *
+ * The file is mapped into memory rather than read, and records and fields are found
+ * with the vectorized kernels of the scanner (see ScanKernels.h), as spans of the
+ * mapping. Nothing is allocated per record: the callback is passed the same record
+ * object each time, pointing at the next spans. A field only becomes a string when
+ * the script asks for it by calling the record, and `fieldNumber` parses it in place.
+ * A record that the callback keeps, e.g. in a variable, keeps its spans and the
+ * mapping alive, and the next records get a record object of their own.
+ *
+ * `eachCsv` follows RFC 4180: fields are separated by commas, and a field in double
+ * quotes may hold commas, line breaks and doubled quotes. Line breaks are "\n" or
+ * "\r\n" for both functions.
+ *
+ * Pages of the file are read in as the scan reaches them, which blocks the thread, so
+ * other fibers do not run meanwhile.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Interpreter.h"
+#include "LoxCallable.h"
+
+class MappedFile;
+
+/**
+ * @brief A record of a file as a Lox value, which returns the field at an index when
+ *        called.
+ */
+class LoxRecord : public LoxCallable
+{
+public:
+  /**
+   * @brief A field, as a span of the mapped file.
+   */
+  struct Field
+  {
+    std::string_view text; /**< The field, without the quotes around it if it had any */
+    bool escaped = false; /**< Whether it holds doubled quotes, each of which stands for one */
+  };
+
+  /**
+   * @brief Constructs a record with no fields.
+   * @param file The file its fields point into, kept mapped as long as the record lives.
+   */
+  LoxRecord(std::shared_ptr<const MappedFile> file)
+    : _file(std::move(file)) {}
+
+  /**
+   * @brief Returns the number of arguments required by a record.
+   *
+   * @return 1.
+   */
+  size_t arity() override { return 1; }
+
+  /**
+   * @brief Copies a field out of the file.
+   *
+   * @param interpreter The interpreter reading the field (unused).
+   * @param arguments The index of the field, from 0.
+   * @return The field as a string, or nil if the record has no field at that index.
+   * @throws NativeError if the index is not a number.
+   */
+  LiteralValue call(Interpreter&, const std::vector<LiteralValue>& arguments) override;
+
+  /**
+   * @brief Returns a string representation of the record.
+   *
+   * @return A string indicating that this is a record.
+   */
+  std::string toString() override { return "<record>"; }
+
+  /**
+   * @brief Returns the fields, for the scanner to refill.
+   * @return The fields.
+   */
+  std::vector<Field>& fields() { return _fields; }
+
+  /**
+   * @brief Returns the number of fields.
+   * @return The number of fields.
+   */
+  size_t size() const { return _fields.size(); }
+
+  /**
+   * @brief Returns the field at an index argument.
+   * @param index The index, from 0.
+   * @return The field, or null if the record has no field at that index.
+   * @throws NativeError if the index is not a number.
+   */
+  const Field* field(const LiteralValue& index) const;
+
+private:
+  std::shared_ptr<const MappedFile> _file; ///< The file the fields point into.
+  std::vector<Field> _fields; ///< The fields.
+};
+
+/**
+ * @brief The `eachLine(path, fn)` native, which calls a function with every line of a
+ *        file, as a record of one field.
+ */
+class EachLineCallable : public LoxCallable
+{
+  /**
+   * @brief Returns the number of arguments required by `eachLine`.
+   *
+   * @return 2.
+   */
+  size_t arity() override { return 2; }
+
+  /**
+   * @brief Calls the function with every line, until it returns false.
+   *
+   * @param interpreter The interpreter calling the function.
+   * @param arguments The path of the file and the function.
+   * @return The number of lines passed.
+   * @throws NativeError if the arguments are not a path and a function of one
+   *         argument, or the file cannot be mapped.
+   */
+  LiteralValue call(Interpreter& interpreter, const std::vector<LiteralValue>& arguments) override;
+
+  /**
+   * @brief Returns a string representation of the `eachLine` function.
+   *
+   * @return A string indicating that this is a native function.
+   */
+  std::string toString() override { return "<native fn>"; }
+};
+
+/**
+ * @brief The `eachCsv(path, fn)` native, which calls a function with every record of
+ *        a CSV file.
+ */
+class EachCsvCallable : public LoxCallable
+{
+  /**
+   * @brief Returns the number of arguments required by `eachCsv`.
+   *
+   * @return 2.
+   */
+  size_t arity() override { return 2; }
+
+  /**
+   * @brief Calls the function with every record, until it returns false.
+   *
+   * @param interpreter The interpreter calling the function.
+   * @param arguments The path of the file and the function.
+   * @return The number of records passed.
+   * @throws NativeError if the arguments are not a path and a function of one
+   *         argument, or the file cannot be mapped.
+   */
+  LiteralValue call(Interpreter& interpreter, const std::vector<LiteralValue>& arguments) override;
+
+  /**
+   * @brief Returns a string representation of the `eachCsv` function.
+   *
+   * @return A string indicating that this is a native function.
+   */
+  std::string toString() override { return "<native fn>"; }
+};
+
+/**
+ * @brief The `fieldCount(record)` native, which returns the number of fields of a record.
+ */
+class FieldCountCallable : public LoxCallable
+{
+  /**
+   * @brief Returns the number of arguments required by `fieldCount`.
+   *
+   * @return 1.
+   */
+  size_t arity() override { return 1; }
+
+  /**
+   * @brief Counts the fields of a record.
+   *
+   * @param interpreter The interpreter counting (unused).
+   * @param arguments The record.
+   * @return The number of fields.
+   * @throws NativeError if the argument is not a record.
+   */
+  LiteralValue call(Interpreter&, const std::vector<LiteralValue>& arguments) override;
+
+  /**
+   * @brief Returns a string representation of the `fieldCount` function.
+   *
+   * @return A string indicating that this is a native function.
+   */
+  std::string toString() override { return "<native fn>"; }
+};
+
+/**
+ * @brief The `fieldNumber(record, i)` native, which parses a field of a record as a
+ *        number without copying it.
+ */
+class FieldNumberCallable : public LoxCallable
+{
+  /**
+   * @brief Returns the number of arguments required by `fieldNumber`.
+   *
+   * @return 2.
+   */
+  size_t arity() override { return 2; }
+
+  /**
+   * @brief Parses a field as a number.
+   *
+   * @param interpreter The interpreter parsing (unused).
+   * @param arguments The record and the index of the field, from 0.
+   * @return The number, or nil if there is no such field or it is not a number.
+   * @throws NativeError if the arguments are not a record and a number.
+   */
+  LiteralValue call(Interpreter&, const std::vector<LiteralValue>& arguments) override;
+
+  /**
+   * @brief Returns a string representation of the `fieldNumber` function.
+   *
+   * @return A string indicating that this is a native function.
+   */
+  std::string toString() override { return "<native fn>"; }
+};
@@ -0,0 +1,81 @@
+/**
+ * @file ScanKernels.h
+ * @brief Vectorized helpers used to skip over runs of characters in source code and
+ *        in data files.
+ *
+ * Each helper has a scalar implementation and, on x86-64, SSE2 and AVX2 versions that
+ * examine 16 or 32 bytes at a time. The fastest version the CPU supports is selected
+ * at runtime the first time a helper is called.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace ScanKernels
+{
+  /**
+   * @enum Level
+   * @brief The instruction sets the helpers can be implemented with.
+   */
+  enum Level
+  {
+    SCALAR, /**< Portable one-byte-at-a-time loops */
+    SSE2, /**< 16 bytes at a time */
+    AVX2 /**< 32 bytes at a time */
+  };
+
+  /**
+   * @brief Returns the fastest level supported by the CPU.
+   * @return The best supported level.
+   */
+  Level supported();
+
+  /**
+   * @brief Returns the level the helpers currently dispatch to.
+   * @return The selected level.
+   */
+  Level selected();
+
+  /**
+   * @brief Overrides the level the helpers dispatch to, e.g. to compare levels in a benchmark.
+   * @param level The level to use, which must not be above `supported()`.
+   */
+  void select(const Level& level);
+
+  /**
+   * @brief Skips a run of spaces, tabs, carriage returns and newlines.
+   * @param text The text to search.
+   * @param from The offset to start at.
+   * @return The offset of the first non-whitespace character, or the size of the text.
+   */
+  size_t skipWhitespace(std::string_view text, const size_t& from);
+
+  /**
+   * @brief Skips a run of identifier characters (letters, digits and underscores).
+   * @param text The text to search.
+   * @param from The offset to start at.
+   * @return The offset of the first non-identifier character, or the size of the text.
+   */
+  size_t skipIdentifier(std::string_view text, const size_t& from);
+
+  /**
+   * @brief Finds the next occurrence of a character.
+   * @param text The text to search.
+   * @param from The offset to start at.
+   * @param c The character to find.
+   * @return The offset of the character, or the size of the text if it does not occur.
+   */
+  size_t find(std::string_view text, const size_t& from, const char& c);
+
+  /**
+   * @brief Finds the next separator, double quote or newline, which end a field of
+   *        delimited records such as CSV.
+   * @param text The text to search.
+   * @param from The offset to start at.
+   * @param separator The character separating fields.
+   * @return The offset of the delimiter, or the size of the text if there is none.
+   */
+  size_t findDelimiter(std::string_view text, const size_t& from, const char& separator);
+}
@@ -12,10 +12,12 @@
 
 #pragma once
 
+#include <optional>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 
+#include "Source.h"
 #include "Token.h"
 #include "utils.h"
 
@@ -26,11 +28,33 @@
 class Scanner
 {
 public: 
+    /**
+     * @brief An error found while scanning, when errors are collected instead of reported,
+     *        e.g. while scanning speculatively.
+     */
+    struct ScanError
+    {
+      size_t start; /**< Start of the lexeme the error was found in */
+      size_t offset; /**< Offset the error is reported at */
+      std::string message; /**< The error message */
+    };
+
     /**
      * @brief Constructs a Scanner object with the given source code.
+     * @param source The source code to scan, which must outlive the scanned tokens.
+     * @param reporter Where to report the errors found.
+     * @param from The offset to start scanning at, e.g. to rescan a function body.
+     */
+    Scanner(const Source& source, Lox::Reporter& reporter, const size_t& from = 0);
+
+    /**
+     * @brief Constructs a Scanner starting part way into the source, collecting its errors
+     *        instead of reporting them.
      * @param source The source code to scan.
+     * @param from The offset to start scanning at.
+     * @param errors Where to collect the errors found.
      */
-    Scanner(const std::string& source);
+    Scanner(const Source& source, const size_t& from, std::vector<ScanError>& errors);
 
     /**
      * @brief Scans the source code and returns a vector of tokens.
@@ -38,24 +62,73 @@ public:
      */
     std::vector<Token> scanTokens();
 
+    /**
+     * @brief Scans the source code on several threads and returns a vector of tokens.
+     *
+     * The source is split into chunks at line starts, and every chunk is scanned
+     * speculatively on its own thread as if it began outside of any lexeme. The chunks
+     * are then stitched in order: wherever the previous chunk's last lexeme (e.g. a string
+     * or block comment) runs past the boundary, the chunk is rescanned from the true
+     * position until it lines up with a speculative token again. The result, including
+     * the errors reported, is identical to `scanTokens()`.
+     *
+     * @param jobs The maximum number of threads to scan with.
+     * @return A vector containing all the tokens found in the source code.
+     */
+    std::vector<Token> scanTokens(const unsigned& jobs);
+
+    /**
+     * @brief Scans and returns the next token, letting a parser pull tokens on demand
+     *        instead of materializing the whole token vector.
+     * @return The next token, or an END token once the source is exhausted.
+     */
+    Token nextToken();
+
 private: 
     /**
-     * @brief Scans the next token from the source code.
+     * @brief The result of speculatively scanning one chunk of the source.
+     */
+    struct Chunk
+    {
+      std::vector<Token> tokens; /**< Tokens of the lexemes starting in the chunk */
+      std::vector<ScanError> errors; /**< Errors found in those lexemes */
+      size_t exit = 0; /**< Offset at which the lexeme following the chunk starts */
+    };
+
+    /// Chunks smaller than this are not worth a thread of their own.
+    static constexpr size_t MIN_CHUNK_SIZE = 1 << 16;
+
+    /**
+     * @brief Scans the lexemes starting in the given range as if the range began outside
+     *        of any lexeme.
+     * @param from The offset the range starts at.
+     * @param to The offset the range ends at.
+     * @param chunk The chunk to record the tokens and errors in.
+     */
+    void scanChunk(const size_t& from, const size_t& to, Chunk& chunk) const;
+
+    /**
+     * @brief Scans the next lexeme from the source code.
+     * @return The token it produced, if any.
+     */
+    std::optional<Token> scanLexeme();
+
+    /**
+     * @brief Scans the next lexeme from the source code, producing at most one token.
      */
     void scanToken();
 
     /**
-     * @brief Adds a token of the given type to the tokens vector.
+     * @brief Records a token of the given type as the one produced by the current lexeme.
      * @param type The type of the token to be added.
      */
     void addToken(const TokenType& type);
 
     /**
-     * @brief Adds a token of the given type and literal value to the tokens vector.
-     * @param type The type of the token to be added.
-     * @param literal The literal value of the token.
+     * @brief Reports an error at the current position, or collects it when scanning speculatively.
+     * @param message The error message.
      */
-    void addToken(const TokenType& type, const LiteralValue& literal);
+    void error(const std::string& message);
 
     /**
      * @brief Checks if the scanner has reached the end of the source code.
@@ -70,20 +143,6 @@ private:
      */
     bool isDigit(const char& c);
 
-    /**
-     * @brief Checks if the given character is an alphabetic character.
-     * @param c The character to check.
-     * @return True if the character is alphabetic, false otherwise.
-     */
-    bool isAlpha(const char& c);
-
-    /**
-     * @brief Checks if the given character is an alphanumeric character.
-     * @param c The character to check.
-     * @return True if the character is alphanumeric, false otherwise.
-     */
-    bool isAlphaNumeric(const char& c);
-
     /**
      * @brief Scans a number token from the source code.
      */
@@ -129,8 +188,11 @@ private:
      */
     char peekNext();
 
+    /// The source the tokens refer to.
+    const Source& _source;
+
     /// The source code to be scanned.
-    std::string _source;
+    std::string_view _text;
     
     /// Start position of the current lexeme being scanned.
     size_t _start = 0;
@@ -138,12 +200,13 @@ private:
     /// Current position in the source code.
     size_t _current = 0;
 
-    /// Current line number in the source code.
-    size_t _line = 1;
+    /// Token produced by the lexeme being scanned, if any.
+    std::optional<Token> _token;
+
+    /// Where errors are collected instead of reported, if anywhere.
+    std::vector<ScanError>* _errors = nullptr;
 
-    /// Vector to store the scanned tokens.
-    std::vector<Token> _tokens;
+    /// Where errors are reported, unless they are collected.
+    Lox::Reporter* _reporter = nullptr;
 
-    /// Unordered map of keywords and their corresponding token types.
-    const std::unordered_map<std::string, TokenType> _keywords;
 };
@@ -0,0 +1,264 @@
+/**
+ * @file Scheduler.h
+ * @brief Header file for the Scheduler class, which interleaves the fibers of one
+ *        interpreter on its thread, and for the Fiber class, the Lox value of a fiber.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <list>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "Environment.h"
+#include "Interpreter.h"
+#include "IoLoop.h"
+#include "LoxCallable.h"
+
+class Scheduler;
+
+/**
+ * @brief A function running as a fiber of the interpreter that started it, which is
+ *        joined by calling it.
+ */
+class Fiber : public LoxCallable
+{
+public:
+  /**
+   * @brief Waits for the fiber to finish, running the other fibers meanwhile.
+   *
+   * @param interpreter The interpreter joining the fiber.
+   * @param arguments No arguments.
+   * @return The value the function returned, or nil if it stopped with a runtime error.
+   * @throws NativeError if the fiber belongs to another interpreter, or if joining it
+   *         would wait forever.
+   */
+  LiteralValue call(Interpreter& interpreter, const std::vector<LiteralValue>&) override;
+
+  /**
+   * @brief Returns a string representation of the fiber.
+   *
+   * @return A string indicating that this is a fiber.
+   */
+  std::string toString() override { return "<fiber>"; }
+
+private:
+  friend class Scheduler;
+
+  /**
+   * @brief The registers and stack a fiber is suspended on.
+   */
+  struct Context
+  {
+    void* stack = nullptr; /**< The lowest address of its stack, null for the thread's own */
+    void* pointer = nullptr; /**< Where its registers were saved when it was switched out */
+  };
+
+  Scheduler* _scheduler; ///< The scheduler running the fiber.
+  std::shared_ptr<LoxCallable> _function; ///< The function it calls, null for the thread's own fiber.
+  std::vector<LiteralValue> _arguments; ///< The arguments it calls the function with.
+  LiteralValue _result; ///< The value the function returned.
+  std::exception_ptr _error; ///< The error other than a runtime error it stopped with, if any.
+  std::shared_ptr<Environment> _scope; ///< Its innermost scopes while it is switched out.
+  Context _context; ///< Where it is suspended.
+  std::vector<Fiber*> _joiners; ///< The fibers waiting for it to finish.
+  Fiber* _joining = nullptr; ///< The fiber it is waiting for, if any.
+  std::list<std::shared_ptr<Fiber>>::iterator _position; ///< Its entry in the scheduler's unfinished fibers.
+  bool _finished = false; ///< Whether the function has returned.
+  bool _deadlocked = false; ///< Whether it was woken up because no fiber could run.
+
+  /**
+   * @brief Constructs a fiber that has not started yet.
+   */
+  Fiber(Scheduler& scheduler, std::shared_ptr<LoxCallable> function, std::vector<LiteralValue> arguments)
+    : _scheduler(&scheduler), _function(std::move(function)), _arguments(std::move(arguments)) {}
+};
+
+/**
+ * @class Scheduler
+ * @brief Runs the fibers of an interpreter one at a time on the interpreter's thread,
+ *        switching between them cooperatively.
+ *
+ * Every fiber runs on a call stack of its own, so it can be switched out anywhere in
+ * the interpreter, however deeply nested. The interpreter counts loop iterations and
+ * calls, and offers to switch after every `Interpreter::quantum` of them; the switch
+ * only happens if another fiber is ready to run. Fibers also give way when they sleep,
+ * call `yield_now()` or join an unfinished fiber. The code run by the interpreter
+ * before any fiber is started counts as a fiber too, the main one.
+ *
+ * A switch saves the callee-saved registers on the old stack and loads those of the
+ * new one, without a system call (on x86-64; other targets fall back to ucontext),
+ * and swaps the interpreter's innermost scopes with the ones the new fiber was using.
+ * Stacks are reserved with a guard page below them, and are only backed by memory as
+ * far as they are used, so thousands of fibers are cheap; those of finished fibers
+ * are reused.
+ *
+ * File operations started through `perform` suspend the fiber until they complete,
+ * so that other fibers compute meanwhile. The operations of fibers that block one
+ * after another are passed to the I/O loop together, once no fiber is left ready.
+ *
+ * Nothing else runs while a fiber waits on anything but the scheduler, e.g. on a
+ * channel or a task.
+ */
+class Scheduler
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr size_t stack_size = 8 << 20; ///< The bytes reserved for a fiber's stack, as much as a thread's.
+  static constexpr size_t pooled_stacks = 64; ///< The most stacks of finished fibers kept for reuse.
+
+  /**
+   * @brief Constructs a scheduler with the main fiber only.
+   * @param interpreter The interpreter whose fibers it runs.
+   */
+  Scheduler(Interpreter& interpreter);
+
+  /**
+   * @brief Releases the stacks kept for reuse. Fibers that never finished are abandoned.
+   */
+  ~Scheduler();
+
+  Scheduler(const Scheduler&) = delete;
+  Scheduler& operator=(const Scheduler&) = delete;
+
+  /**
+   * @brief Starts a fiber, which first runs once the running fiber gives way.
+   *
+   * @param function The function to call.
+   * @param arguments The arguments to pass to it.
+   * @return The fiber.
+   */
+  std::shared_ptr<Fiber> start(std::shared_ptr<LoxCallable> function, std::vector<LiteralValue> arguments);
+
+  /**
+   * @brief Switches to the next fiber ready to run, if any, leaving the running one
+   *        ready to run again after it.
+   */
+  void yield();
+
+  /**
+   * @brief Suspends the running fiber for the given time, running the others meanwhile.
+   * @param duration How long to sleep.
+   */
+  void sleep(const Clock::duration& duration);
+
+  /**
+   * @brief Waits for a fiber to finish, running the others meanwhile.
+   *
+   * @param fiber The fiber.
+   * @throws NativeError if the fiber is the running one, or if every unfinished fiber
+   *         would be left waiting for another.
+   */
+  void join(Fiber& fiber);
+
+  /**
+   * @brief Waits for every fiber started so far, and those they start, to finish.
+   *
+   * Must be called from the main fiber.
+   */
+  void joinAll();
+
+  /**
+   * @brief Runs a file operation, running the other fibers until it completes.
+   * @param request The operation, whose outcome it holds on return.
+   */
+  void perform(IoLoop::Request& request);
+
+  /**
+   * @brief Returns the loop running file operations, creating it on first use, and
+   *        again in a process forked after it was created.
+   * @return The loop.
+   */
+  IoLoop& io();
+
+  /**
+   * @brief Replaces the loop running file operations, e.g. to compare backends.
+   *
+   * Must not be called while operations are in flight.
+   * @param io The new loop.
+   */
+  void io(std::unique_ptr<IoLoop> io) { _io = std::move(io); _io_owner = getpid(); }
+
+private:
+  /**
+   * @brief A fiber sleeping until a point in time.
+   */
+  struct Sleeper
+  {
+    Clock::time_point deadline; /**< When it wakes up */
+    Fiber* fiber; /**< The fiber */
+
+    /**
+     * @brief Orders sleepers so that the first to wake up is on top of the queue.
+     */
+    bool operator>(const Sleeper& other) const { return deadline > other.deadline; }
+  };
+
+  Interpreter& _interpreter; ///< The interpreter the fibers run in.
+  Fiber _main; ///< The fiber of the thread's own stack.
+  Fiber* _running; ///< The fiber running now.
+  std::list<std::shared_ptr<Fiber>> _fibers; ///< The started fibers that have not finished yet.
+  std::deque<Fiber*> _ready; ///< The fibers ready to run, in the order they got ready.
+  std::priority_queue<Sleeper, std::vector<Sleeper>, std::greater<Sleeper>> _sleepers; ///< The sleeping fibers.
+  std::vector<void*> _stacks; ///< Stacks of finished fibers, kept for reuse.
+  std::shared_ptr<Fiber> _finished; ///< The fiber that finished last, whose stack is released once switched off.
+  const void* _main_stack = nullptr; ///< The bottom of the thread's own stack, learnt for AddressSanitizer.
+  size_t _main_stack_size = 0; ///< The size of the thread's own stack, learnt for AddressSanitizer.
+  std::unique_ptr<IoLoop> _io; ///< The loop running file operations, if any were run.
+  pid_t _io_owner = 0; ///< The process that created `_io`.
+  std::vector<IoLoop::Request*> _completed; ///< The operations handed back by the last poll of the loop.
+
+  /**
+   * @brief Marks the sleepers whose time has come as ready to run.
+   * @return True if any fiber is ready to run.
+   */
+  bool wake();
+
+  /**
+   * @brief Marks the fibers whose file operations have completed as ready to run.
+   */
+  void collect();
+
+  /**
+   * @brief Switches to the next fiber ready to run, waiting for a sleeper or a file
+   *        operation if there is none, and returns once the running fiber is switched
+   *        back to.
+   *
+   * The running fiber must have been queued or made to wait for something first. If no
+   * fiber can ever run again, the fiber the main one waits for is woken up instead, and
+   * marked as deadlocked.
+   */
+  void block();
+
+  /**
+   * @brief Switches from the running fiber to another.
+   */
+  void switchTo(Fiber& next);
+
+  /**
+   * @brief Tells AddressSanitizer, if enabled, that a switch to a fiber's stack is over.
+   * @param fake_stack What the sanitizer saved when the fiber was switched off, if anything.
+   */
+  void finishSwitch(void* fake_stack);
+
+  /**
+   * @brief Releases the stack of the fiber that finished last, now that it is not in use.
+   */
+  void releaseFinished();
+
+  /**
+   * @brief Runs a fiber's function on its own stack, and switches off it for good.
+   * @param argument The scheduler, whose running fiber is the one starting.
+   */
+  [[noreturn]] static void run(void* argument);
+};
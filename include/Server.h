@@ -0,0 +1,48 @@
+/**
+ * @file Server.h
+ * @brief A warm interpreter process that runs scripts sent to it over a Unix domain
+ *        socket, and the thin client that sends them.
+ *
+ * The server keeps the syntax tree of every script it has run, and parses a script
+ * again only once its file changes. Each request still runs in a fresh Interpreter,
+ * so requests cannot see each other's globals, and writes to streams of its own,
+ * which are sent back along with the exit status. Each connection is served on a
+ * thread of its own, so that a slow client or a long script does not hold up the
+ * others; the scripts parsed so far are shared between them. Requests over 64 MiB,
+ * or that take over 10 seconds to arrive, are dropped.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace Server
+{
+  /**
+   * @brief What a request asks the server to run.
+   */
+  enum RequestKind : uint8_t
+  {
+    RUN_FILE, /**< The script at an absolute path */
+    RUN_SOURCE /**< Source code sent with the request */
+  };
+
+  /**
+   * @brief Listens on a socket and serves run requests until interrupted.
+   * @param socket_path The path of the socket, replaced if it already exists.
+   * @param cache_dir The directory parsed scripts are cached in on disk, or empty for none.
+   * @param lazy Whether function bodies are parsed on their first call.
+   * @return EXIT_FAILURE if the socket cannot be set up, EXIT_SUCCESS once interrupted.
+   */
+  int serve(const std::string& socket_path, const std::string& cache_dir, const bool& lazy);
+
+  /**
+   * @brief Sends a run request to a server, relaying its output and exit status.
+   * @param socket_path The path of the server's socket.
+   * @param kind What to run.
+   * @param payload The path of the script, or its source code.
+   * @return The exit status of the script, or EXIT_FAILURE if the server cannot be reached.
+   */
+  int request(const std::string& socket_path, const RequestKind& kind, const std::string& payload);
+}
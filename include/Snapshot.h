@@ -0,0 +1,55 @@
+/**
+ * @file Snapshot.h
+ * @brief Heap snapshots of the interpreter's global state, so that a prelude of
+ *        definitions can be restored instead of executed again on every run.
+ *
+ * A snapshot holds the text and syntax tree of the script that was run, every
+ * value reachable from the global environments, and the functions and closures
+ * among them. Native functions are stored by the global name they are registered
+ * under and re-bound to the restoring interpreter's own natives.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Expr.h"
+#include "Interpreter.h"
+#include "Source.h"
+#include "Stmt.h"
+
+namespace Snapshot
+{
+  /**
+   * @brief The script restored from a snapshot, which must be retained for as long
+   *        as the interpreter uses the restored functions.
+   */
+  struct Restored
+  {
+    std::unique_ptr<const Source> source; /**< The text of the script */
+    std::vector<std::shared_ptr<Stmt<LiteralValue>>> statements; /**< Its top-level statements */
+  };
+
+  /**
+   * @brief Saves the global state of an interpreter after it has run a script.
+   * @param path The file to write the snapshot to.
+   * @param interpreter The interpreter that ran the script.
+   * @param source The script.
+   * @param statements The top-level statements of the script, which every function
+   *        reachable from the globals must have been declared in.
+   * @throws std::runtime_error if the state cannot be saved or written.
+   */
+  void save(const std::string& path, const Interpreter& interpreter, const Source& source,
+            const std::vector<std::shared_ptr<Stmt<LiteralValue>>>& statements);
+
+  /**
+   * @brief Restores the global state saved in a snapshot into an interpreter.
+   * @param path The file to read the snapshot from.
+   * @param interpreter The interpreter to restore into, replacing its globals.
+   * @return The script the snapshot was taken after.
+   * @throws std::runtime_error if the snapshot cannot be read or was written by another build.
+   */
+  Restored restore(const std::string& path, Interpreter& interpreter);
+}
@@ -0,0 +1,127 @@
+/**
+ * @file Source.h
+ * @brief Header file for the Source class which owns the text of a script.
+ *
+ * Tokens refer to their lexemes by offset into a Source instead of copying them,
+ * so a Source must outlive every token and syntax tree produced from it.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class Source
+ * @brief Retains the text of a script and maps offsets within it back to line numbers.
+ *
+ * The text is either owned as a string or, for files that are only read once right
+ * away, a read-only memory mapping of the file. The line-start table is only built the
+ * first time a line number is requested, which normally happens only when an error
+ * is reported. Tokens keep their offsets in 32 bits, so texts of more than
+ * `MAX_SIZE` bytes are rejected rather than mis-tokenized.
+ */
+class Source
+{
+public:
+  /// The size of the largest text a Source holds.
+  static constexpr size_t MAX_SIZE = UINT32_MAX;
+
+  /**
+   * @brief Constructs a Source that takes ownership of the given text.
+   * @param text The source code.
+   * @throws std::runtime_error if the text is larger than `MAX_SIZE`.
+   */
+  Source(std::string text)
+    : _storage(std::move(text)), _text(bounded(_storage)) {}
+
+  /**
+   * @brief Constructs a Source for a fragment of a larger text, e.g. one declaration
+   *        of a document being edited, whose line numbers continue the text's.
+   * @param text The source code of the fragment.
+   * @param first_line The line of the larger text the fragment starts on.
+   * @throws std::runtime_error if the text is larger than `MAX_SIZE`.
+   */
+  Source(std::string text, const int& first_line)
+    : _storage(std::move(text)), _text(bounded(_storage)), _first_line(first_line) {}
+
+  /**
+   * @brief Unmaps the text if it was mapped from a file.
+   */
+  ~Source();
+
+  // Tokens point at their Source, so it must stay put.
+  Source(const Source&) = delete;
+  Source& operator=(const Source&) = delete;
+
+  /**
+   * @brief Loads a script, mapping it into memory if asked to and it is a regular
+   *        file, and reading it otherwise.
+   *
+   * Reading a mapped file that was truncated since raises SIGBUS, so only texts that
+   * are used up right away, such as cache entries, should be mapped. Scripts are read,
+   * since their tokens go back to the text for as long as they run.
+   *
+   * @param path The file path of the script.
+   * @param mapped Whether to map a regular file rather than copy it.
+   * @return The loaded source, or nullptr if the file cannot be opened.
+   * @throws std::runtime_error if the file cannot be read or is larger than `MAX_SIZE`.
+   */
+  static std::unique_ptr<const Source> load(const std::string& path, const bool& mapped = false);
+
+  /**
+   * @brief Returns the source code.
+   * @return A view of the retained source code.
+   */
+  std::string_view text() const { return _text; }
+
+  /**
+   * @brief Returns the line number containing the given offset.
+   *
+   * Safe to call from several threads, e.g. a background parser and the interpreter.
+   *
+   * @param offset The offset into the source code.
+   * @return The 1-based line number of the offset.
+   */
+  int line(const size_t& offset) const;
+
+  /**
+   * @brief Returns the line number of the start of the text.
+   * @return 1, unless the text is a fragment of a larger one.
+   */
+  int firstLine() const { return _first_line; }
+
+  /**
+   * @brief Moves the fragment to another line, after lines were added or removed above it.
+   * @param first_line The line the fragment now starts on.
+   */
+  void relocate(const int& first_line) { _first_line = first_line; }
+
+private:
+  /**
+   * @brief Constructs a Source over a mapped file, taking ownership of the mapping.
+   * @param mapping The start of the mapping.
+   * @param size The size of the mapping.
+   */
+  Source(void* mapping, const size_t& size)
+    : _text(static_cast<const char*>(mapping), size), _mapping(mapping) {}
+
+  /**
+   * @brief Checks that a text is small enough for tokens to refer into.
+   * @param text The text.
+   * @return The text.
+   * @throws std::runtime_error if the text is larger than `MAX_SIZE`.
+   */
+  static std::string_view bounded(std::string_view text);
+
+  std::string _storage; ///< The retained source code, unless mapped.
+  std::string_view _text; ///< The source code, in `_storage` or the mapping.
+  void* _mapping = nullptr; ///< The mapping the text lives in, if any.
+  int _first_line = 1; ///< The line number of the start of the text.
+  mutable std::vector<size_t> _line_starts; ///< Offsets at which each line begins, built on demand.
+  mutable std::once_flag _line_starts_built; ///< Guards building `_line_starts`.
+};
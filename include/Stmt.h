@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Token.h"
+#include "FunctionBody.h"
 
 template <class R>
 class Stmt
@@ -17,6 +18,8 @@ public:
   class Var;
   class While;
   class Jump;
+  class For;
+  class Yield;
 
   struct Visitor
   {
@@ -29,6 +32,8 @@ public:
     virtual R visitVarStmt(const Stmt<R>::Var& stmt) = 0;
     virtual R visitWhileStmt(const Stmt<R>::While& stmt) = 0;
     virtual R visitJumpStmt(const Stmt<R>::Jump& stmt) = 0;
+    virtual R visitForStmt(const Stmt<R>::For& stmt) = 0;
+    virtual R visitYieldStmt(const Stmt<R>::Yield& stmt) = 0;
   };
 
   virtual R accept(Visitor& visitor) const = 0;
@@ -85,7 +90,7 @@ template <class R>
 class Stmt<R>::Function : public Stmt<R>
 {
 public:
-  Function(const Token& name, const std::vector<Token>& params, const std::vector<std::shared_ptr<const Stmt<R>>>& body):
+  Function(const Token& name, const std::vector<Token>& params, const std::shared_ptr<const FunctionBody<R>>& body):
     name(name), params(params), body(body) {}
 
   R accept(Stmt<R>::Visitor& visitor) const override
@@ -95,7 +100,7 @@ public:
 
   const Token name;
   const std::vector<Token> params;
-  const std::vector<std::shared_ptr<const Stmt<R>>> body;
+  const std::shared_ptr<const FunctionBody<R>> body;
 };
 
 template <class R>
@@ -175,3 +180,38 @@ public:
 
   const Token keyword;
 };
+
+template <class R>
+class Stmt<R>::For : public Stmt<R>
+{
+public:
+  For(const Token& name, const std::shared_ptr<const Expr<R>>& start, const std::shared_ptr<const Expr<R>>& stop, const std::shared_ptr<const Expr<R>>& step, const std::shared_ptr<const Stmt<R>>& body):
+    name(name), start(start), stop(stop), step(step), body(body) {}
+
+  R accept(Stmt<R>::Visitor& visitor) const override
+  {
+    return visitor.visitForStmt(*this);
+  }
+
+  const Token name;
+  const std::shared_ptr<const Expr<R>> start;
+  const std::shared_ptr<const Expr<R>> stop;
+  const std::shared_ptr<const Expr<R>> step;
+  const std::shared_ptr<const Stmt<R>> body;
+};
+
+template <class R>
+class Stmt<R>::Yield : public Stmt<R>
+{
+public:
+  Yield(const Token& keyword, const std::shared_ptr<const Expr<R>>& value):
+    keyword(keyword), value(value) {}
+
+  R accept(Stmt<R>::Visitor& visitor) const override
+  {
+    return visitor.visitYieldStmt(*this);
+  }
+
+  const Token keyword;
+  const std::shared_ptr<const Expr<R>> value;
+};
@@ -0,0 +1,285 @@
+/**
+ * @file TaskCallables.h
+ * @brief The native functions that run Lox code in parallel: `spawn`, `worker`,
+ *        `await` and `parallel_for`, and the tasks they return.
+ *
+ * Every task runs in an interpreter of its own on a thread of the TaskRuntime, and
+ * shares no mutable state with the code that spawned it:
+ * - Copied when the task is spawned: its arguments, the spawner's top-level
+ *   variables, and the variables the function captured. Assignments on either side
+ *   are not seen by the other.
+ * - Shared: the syntax tree, and the closures of the other functions the task calls,
+ *   which it should only read.
+ * - Copied back when the task is awaited: its return value, what it printed, and the
+ *   runtime error it stopped with, which is raised again by `await`.
+ *
+ * An interpreter waits for the tasks it spawned before it is destroyed, and then
+ * writes out what the tasks nobody awaited printed and reports the errors they
+ * stopped with, as if they had been awaited in the order spawned. Tasks that may
+ * block for long, such as workers receiving from channels, run on threads of their
+ * own instead of the runtime's, with the same copies.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Interpreter.h"
+#include "LoxCallable.h"
+
+/**
+ * @brief A function running on the task runtime, which is awaited by calling it or
+ *        by passing it to `await`.
+ */
+class Task : public LoxCallable
+{
+public:
+  /**
+   * @brief Starts running a function on the task runtime.
+   *
+   * @param spawner The interpreter spawning the task, whose top-level variables are copied.
+   * @param function The function to run, whose closure is copied.
+   * @param arguments The arguments to pass to it.
+   * @return The running task.
+   */
+  static std::shared_ptr<Task> spawn(Interpreter& spawner, const std::shared_ptr<LoxCallable>& function,
+                                     std::vector<LiteralValue> arguments);
+
+  /**
+   * @brief Starts running a function on a thread of its own rather than on the task
+   *        runtime, for functions that may block for long, e.g. on a channel.
+   *
+   * @param spawner The interpreter starting the task, whose top-level variables are copied.
+   * @param function The function to run, whose closure is copied.
+   * @param arguments The arguments to pass to it.
+   * @return The running task.
+   */
+  static std::shared_ptr<Task> start(Interpreter& spawner, const std::shared_ptr<LoxCallable>& function,
+                                     std::vector<LiteralValue> arguments);
+
+  /**
+   * @brief Waits for the tasks an interpreter spawned, running pending tasks meanwhile,
+   *        then writes out what the tasks nobody awaited printed and reports their errors.
+   *
+   * @param spawner The interpreter.
+   */
+  static void join(const Interpreter& spawner);
+
+  /**
+   * @brief Waits for the task, running pending tasks meanwhile.
+   *
+   * What the task printed is written to the stream of the first interpreter to await it.
+   *
+   * @param interpreter The interpreter awaiting the task.
+   * @return The value the function returned.
+   * @throws RuntimeError, or any other error, the function stopped with.
+   */
+  LiteralValue await(Interpreter& interpreter);
+
+  /**
+   * @brief Drops what the task printed and the error it stops with, for a task whose
+   *        value turned out not to be needed.
+   */
+  void discard();
+
+  /**
+   * @brief Awaits the task.
+   *
+   * @param interpreter The interpreter awaiting the task.
+   * @param arguments No arguments.
+   * @return The value the function returned.
+   */
+  LiteralValue call(Interpreter& interpreter, const std::vector<LiteralValue>&) override { return await(interpreter); }
+
+  /**
+   * @brief Returns a string representation of the task.
+   *
+   * @return A string indicating that this is a task.
+   */
+  std::string toString() override { return "<task>"; }
+
+private:
+  const Interpreter* _spawner; ///< The interpreter that waits for the task before it is destroyed.
+  std::atomic<bool> _done = false; ///< Whether the function has returned or failed.
+  LiteralValue _result; ///< The value it returned.
+  std::exception_ptr _error; ///< The error it stopped with, if any.
+  std::ostringstream _out; ///< What it printed.
+  std::ostringstream _errors; ///< The errors it reported.
+  std::once_flag _flushed; ///< Makes sure the output is written once.
+  size_t _number = 0; ///< The order it was spawned in, among all tasks.
+
+  Task(const Interpreter& spawner)
+    : _spawner(&spawner) {}
+
+  /**
+   * @brief Creates a task and the job that runs it, counting it as unfinished.
+   *
+   * @param spawner The interpreter spawning the task.
+   * @param function The function to run.
+   * @param arguments The arguments to pass to it.
+   * @return The task, and the job to run it with.
+   */
+  static std::pair<std::shared_ptr<Task>, std::function<void()>> prepare(
+    Interpreter& spawner, const std::shared_ptr<LoxCallable>& function, std::vector<LiteralValue> arguments);
+
+  /**
+   * @brief Removes the task from those of its spawner that were not awaited.
+   */
+  void forget();
+
+  /**
+   * @brief Writes out what the task printed and reported, and forgets that it was not awaited.
+   *
+   * @param interpreter The interpreter whose streams to write to.
+   */
+  void flush(const Interpreter& interpreter);
+};
+
+/**
+ * @brief The `spawn(fn, args...)` native, which runs `fn(args...)` as a task.
+ */
+class SpawnCallable : public LoxCallable
+{
+  /**
+   * @brief Returns the number of arguments required by `spawn`, at least the function.
+   *
+   * @return 1.
+   */
+  size_t arity() override { return 1; }
+
+  /**
+   * @brief Accepts the arguments for the function after it.
+   *
+   * @return True.
+   */
+  bool variadic() override { return true; }
+
+  /**
+   * @brief Spawns a task calling the function with the remaining arguments.
+   *
+   * @param interpreter The interpreter spawning the task.
+   * @param arguments The function, followed by its arguments.
+   * @return The task.
+   * @throws NativeError if the first argument is not callable or the rest do not match its arity.
+   */
+  LiteralValue call(Interpreter& interpreter, const std::vector<LiteralValue>& arguments) override;
+
+  /**
+   * @brief Returns a string representation of the `spawn` function.
+   *
+   * @return A string indicating that this is a native function.
+   */
+  std::string toString() override { return "<native fn>"; }
+};
+
+/**
+ * @brief The `worker(fn, args...)` native, which runs `fn(args...)` on a thread of its
+ *        own and returns it as a task.
+ */
+class WorkerCallable : public LoxCallable
+{
+  /**
+   * @brief Returns the number of arguments required by `worker`, at least the function.
+   *
+   * @return 1.
+   */
+  size_t arity() override { return 1; }
+
+  /**
+   * @brief Accepts the arguments for the function after it.
+   *
+   * @return True.
+   */
+  bool variadic() override { return true; }
+
+  /**
+   * @brief Starts a worker calling the function with the remaining arguments.
+   *
+   * @param interpreter The interpreter starting the worker.
+   * @param arguments The function, followed by its arguments.
+   * @return The task running the worker.
+   * @throws NativeError if the first argument is not callable or the rest do not match its arity.
+   */
+  LiteralValue call(Interpreter& interpreter, const std::vector<LiteralValue>& arguments) override;
+
+  /**
+   * @brief Returns a string representation of the `worker` function.
+   *
+   * @return A string indicating that this is a native function.
+   */
+  std::string toString() override { return "<native fn>"; }
+};
+
+/**
+ * @brief The `await(task)` native, which waits for a task and returns its result.
+ */
+class AwaitCallable : public LoxCallable
+{
+  /**
+   * @brief Returns the number of arguments required by `await`.
+   *
+   * @return 1.
+   */
+  size_t arity() override { return 1; }
+
+  /**
+   * @brief Waits for the task.
+   *
+   * @param interpreter The interpreter awaiting the task.
+   * @param arguments The task.
+   * @return The value the task's function returned.
+   * @throws NativeError if the argument is not a task.
+   */
+  LiteralValue call(Interpreter& interpreter, const std::vector<LiteralValue>& arguments) override;
+
+  /**
+   * @brief Returns a string representation of the `await` function.
+   *
+   * @return A string indicating that this is a native function.
+   */
+  std::string toString() override { return "<native fn>"; }
+};
+
+/**
+ * @brief The `parallel_for(lo, hi, fn)` native, which calls `fn(i)` for every
+ *        integer step `i` from `lo` up to but excluding `hi`, in parallel.
+ *
+ * The range is split into a few chunks per worker, and each chunk runs as a task
+ * with copies of the variables, as `spawn` makes. The caller runs chunks as well
+ * until all of them are done. Output is written in index order, and the first
+ * error in index order is raised once every chunk has finished.
+ */
+class ParallelForCallable : public LoxCallable
+{
+  /**
+   * @brief Returns the number of arguments required by `parallel_for`.
+   *
+   * @return 3.
+   */
+  size_t arity() override { return 3; }
+
+  /**
+   * @brief Calls the function for every index in the range, and waits for all of the calls.
+   *
+   * @param interpreter The interpreter calling `parallel_for`.
+   * @param arguments The lower bound, the upper bound and the function.
+   * @return nil.
+   * @throws NativeError if the bounds are not numbers or the function does not take one argument.
+   */
+  LiteralValue call(Interpreter& interpreter, const std::vector<LiteralValue>& arguments) override;
+
+  /**
+   * @brief Returns a string representation of the `parallel_for` function.
+   *
+   * @return A string indicating that this is a native function.
+   */
+  std::string toString() override { return "<native fn>"; }
+};
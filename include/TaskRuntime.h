@@ -0,0 +1,109 @@
+/**
+ * @file TaskRuntime.h
+ * @brief Header file for the TaskRuntime class, a work-stealing pool of threads
+ *        that runs the tasks Lox scripts spawn.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+/**
+ * @class TaskRuntime
+ * @brief A pool of worker threads, each with a deque of jobs of its own.
+ *
+ * A worker pushes the jobs it submits onto the back of its own deque and pops them
+ * from there, newest first, while idle workers steal the oldest jobs from the front
+ * of the others' deques. Threads that wait for a job to finish run pending jobs in
+ * the meantime instead of blocking, so jobs may wait for the jobs they submit
+ * without tying up a worker, even when there is only one.
+ *
+ * The pool is started on first use and lives until the process exits.
+ */
+class TaskRuntime
+{
+public:
+  /// A unit of work, which must not throw.
+  using Job = std::function<void()>;
+
+  /**
+   * @brief Sets the number of worker threads, if the pool has not been started yet.
+   * @param threads The number of workers, or 0 for one per hardware thread.
+   */
+  static void setThreads(const unsigned& threads);
+
+  /**
+   * @brief Returns the pool, starting it on first use.
+   * @return The process-wide pool.
+   */
+  static TaskRuntime& instance();
+
+  /**
+   * @brief Returns the number of worker threads.
+   * @return The size of the pool.
+   */
+  size_t threads() const { return _workers.size(); }
+
+  /**
+   * @brief Queues a job, on the deque of the calling worker if it is one.
+   * @param job The job to run.
+   */
+  void submit(Job job);
+
+  /**
+   * @brief Runs pending jobs until a condition holds, waiting only when there are none.
+   * @param done Checked after every job, and whenever a job finishes on another thread.
+   */
+  void helpUntil(const std::function<bool()>& done);
+
+private:
+  /**
+   * @brief The deque of jobs of one worker.
+   */
+  struct Worker
+  {
+    std::mutex mutex; /**< Guards the deque */
+    std::deque<Job> jobs; /**< Its own jobs at the back, the oldest at the front for thieves */
+  };
+
+  std::vector<std::unique_ptr<Worker>> _workers; ///< One deque per worker thread.
+  std::atomic<size_t> _pending = 0; ///< The number of jobs queued but not yet taken.
+  std::atomic<size_t> _next = 0; ///< The deque the next job from outside the pool goes to.
+  std::mutex _idle_mutex; ///< Guards the sleep of idle workers.
+  std::condition_variable _idle; ///< Signalled when a job is queued.
+  std::mutex _finished_mutex; ///< Guards the sleep of threads waiting in `helpUntil`.
+  std::condition_variable _finished; ///< Signalled when a job finishes.
+
+  /**
+   * @brief Starts the worker threads, which are never joined.
+   * @param threads The number of workers.
+   */
+  TaskRuntime(const unsigned& threads);
+
+  /**
+   * @brief Runs jobs on a worker thread, sleeping while there are none.
+   * @param index The worker's deque.
+   */
+  void work(const size_t& index);
+
+  /**
+   * @brief Takes a job from the calling worker's own deque, or steals one from another.
+   * @return The job, or nothing if every deque is empty.
+   */
+  std::optional<Job> take();
+
+  /**
+   * @brief Takes and runs one pending job.
+   * @return False if there was none.
+   */
+  bool runPending();
+};
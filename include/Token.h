@@ -1,10 +1,14 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <variant>
 
+#include "Source.h"
+
 /**
  * @enum TokenType
  * @brief Enumerates the types of tokens that can be encountered.
@@ -18,6 +22,7 @@ enum TokenType
   RIGHT_BRACE, /**< Token for '}' */
   COMMA, /**< Token for ',' */
   DOT, /**< Token for '.' */
+  DOT_DOT, /**< Token for '..' */
   MINUS, /**< Token for '-' */
   PLUS, /**< Token for '+' */
   SEMICOLON, /**< Token for ';' */
@@ -35,6 +40,12 @@ enum TokenType
   GREATER_EQUAL, /**< Token for '>=' */
   LESS, /**< Token for '<' */
   LESS_EQUAL, /**< Token for '<=' */
+  PLUS_EQUAL, /**< Token for '+=' */
+  MINUS_EQUAL, /**< Token for '-=' */
+  STAR_EQUAL, /**< Token for '*=' */
+  SLASH_EQUAL, /**< Token for '/=' */
+  PLUS_PLUS, /**< Token for '++' */
+  MINUS_MINUS, /**< Token for '--' */
 
   // Literals.
   IDENTIFIER, /**< Token for identifiers */
@@ -60,6 +71,8 @@ enum TokenType
   WHILE, /**< Token for keyword 'while' */
   BREAK, /**< Token for keyword 'break' */
   CONTINUE, /**< Token for keyword 'continue' */
+  IN, /**< Token for keyword 'in' */
+  YIELD, /**< Token for keyword 'yield' */
 
   END /**< Token to signify the end of the file */
 };
@@ -70,37 +83,66 @@ class LoxCallable;
 using LiteralValue = std::variant<std::monostate, std::string, double, bool, std::shared_ptr<LoxCallable>>;
 
 
+/**
+ * @brief Transparent string hash, allowing maps keyed by `std::string` to be searched
+ * with a `std::string_view` lexeme without allocating.
+ */
+struct StringHash
+{
+  using is_transparent = void;
+
+  size_t operator()(std::string_view text) const
+  {
+    return std::hash<std::string_view>{}(text);
+  }
+};
+
 /**
  * @class Token
- * @brief Represents a token with its type, lexeme, literal
+ * @brief Represents a token by its type and the position of its lexeme in the source.
+ *
+ * Tokens do not own their lexeme; they refer to a span of the retained `Source`, which
+ * must outlive them. The lexeme, literal value and line number are derived on demand.
  */
 class Token
 {
 public:
-  const TokenType type; /**< Type of the token. */
-  const std::string lexeme; /**< Lexeme of the token. */
-  const LiteralValue literal; /**< Literal value of the token, if applicable. */
-  const int line; /**< Line number in the source where the token was found. */
+  TokenType type; /**< Type of the token. */
+  uint32_t offset; /**< Offset of the lexeme in the source. */
+  uint32_t length; /**< Length of the lexeme. */
+  const Source* source; /**< Source the token was scanned from. */
 
   /**
    * @brief Constructor for the Token class.
    * @param type The type of the token.
-   * @param lexeme The lexeme of the token.
-   * @param line The line number where the token was found.
+   * @param offset The offset of the lexeme in the source.
+   * @param length The length of the lexeme.
+   * @param source The source the token was scanned from.
    */
-  Token(const TokenType& type, const std::string& lexeme, const int& line)
-    : type(type), lexeme(lexeme), line(line) {}
+  Token(const TokenType& type, const size_t& offset, const size_t& length, const Source& source)
+    : type(type), offset(offset), length(length), source(&source) {}
 
   /**
-   * @brief Constructor for the Token class.
-   * @param type The type of the token.
-   * @param lexeme The lexeme of the token.
-   * @param literal The literal value of the token.
-   * @param line The line number where the token was found.
+   * @brief Returns the lexeme of the token.
+   * @return A view of the lexeme in the source.
+   */
+  std::string_view lexeme() const { return source->text().substr(offset, length); }
+
+  /**
+   * @brief Returns the literal value of the token, if applicable.
+   * @return The number or string value of a literal token, otherwise `std::monostate`.
+   */
+  LiteralValue literal() const;
+
+  /**
+   * @brief Returns the line number where the token was found.
+   * 
+   * Like jlox, this is the line the token ends on, which only differs from the line it
+   * starts on for multi-line strings.
+   * 
+   * @return The line number of the token.
    */
-  Token(const TokenType& type, const std::string& lexeme, 
-        const LiteralValue& literal, const int& line)
-    : type(type), lexeme(lexeme), literal(literal), line(line) {}
+  int line() const { return source->line(offset + length); }
 
   /**
    * @brief Stream insertion operator for the Token class.
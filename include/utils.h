@@ -1,4 +1,4 @@
-/** 
+/**
  * @file utils.h
  * @brief Utility functions for error reporting in the Lox interpreter.
  */
@@ -13,41 +13,93 @@
 namespace Lox
 {
   /**
-   * @brief Flag to indicate if an error has occurred.
+   * @class Reporter
+   * @brief Reports the errors of one run of the interpreter and remembers whether any occurred.
+   *
+   * Every scanner, parser and interpreter reports to the Reporter it was given, so
+   * that scripts run side by side, e.g. on several threads, keep their errors apart.
    */
-  extern bool had_error;
+  class Reporter
+  {
+  public:
+    /**
+     * @brief Constructs a Reporter that writes errors to the given stream.
+     * @param err The stream to write errors to.
+     */
+    Reporter(std::ostream& err = std::cerr)
+      : _err(&err) {}
 
-  /**
-   * @brief Flag to indicate if a runtime error has occured.
-   */
-  extern bool had_runtime_error;
+    /**
+     * @brief Checks whether a syntax error has been reported.
+     * @return True if an error has occurred.
+     */
+    bool hadError() const { return _had_error; }
 
-  /**
-   * @brief Reports an error with the given message and location.
-   * @param line The line number where the error occurred.
-   * @param where The context or location of the error.
-   * @param message The error message.
-   */
-  void report(const int& line, const std::string& where, const std::string& message);
+    /**
+     * @brief Checks whether a runtime error has been reported.
+     * @return True if a runtime error has occurred.
+     */
+    bool hadRuntimeError() const { return _had_runtime_error; }
 
-  /**
-   * @brief Reports a general error with the given message and location.
-   * @param line The line number where the error occurred.
-   * @param message The error message.
-   */
-  void error(const int& line, const std::string& message);
+    /**
+     * @brief Returns the stream errors are written to.
+     * @return The stream given on construction.
+     */
+    std::ostream& stream() const { return *_err; }
 
-  /**
-   * @brief Reports an error related to a specific token.
-   * @param token The token that caused the error.
-   * @param message The error message to be displayed.
-   */
-  void error(const Token& token, const std::string& message);
+    /**
+     * @brief Forgets the errors reported so far, e.g. between lines of the prompt.
+     */
+    void reset() { _had_error = _had_runtime_error = false; }
 
-  /**
-   * @brief Reports a specific runtime error.
-   * @param error The RuntimeError object that contains the token and message for the error.
-   */
-  void runtimeError(const RuntimeError& error);
+    /**
+     * @brief Forgets the runtime errors reported so far, so that later code still runs.
+     */
+    void resetRuntimeError() { _had_runtime_error = false; }
+
+    /**
+     * @brief Reports an error with the given message and location.
+     * @param line The line number where the error occurred.
+     * @param where The context or location of the error.
+     * @param message The error message.
+     */
+    void report(const int& line, const std::string& where, const std::string& message);
+
+    /**
+     * @brief Reports a general error with the given message and location.
+     * @param line The line number where the error occurred.
+     * @param message The error message.
+     */
+    void error(const int& line, const std::string& message);
+
+    /**
+     * @brief Reports an error related to a specific token.
+     * @param token The token that caused the error.
+     * @param message The error message to be displayed.
+     */
+    void error(const Token& token, const std::string& message);
+
+    /**
+     * @brief Reports a specific runtime error.
+     * @param error The RuntimeError object that contains the token and message for the error.
+     */
+    void runtimeError(const RuntimeError& error);
+
+    /**
+     * @brief Writes out syntax errors reported to another Reporter, e.g. on another
+     *        thread, as if they had been reported here.
+     * @param errors What the other Reporter wrote, nothing if it had no errors.
+     */
+    void relay(const std::string& errors)
+    {
+      if (errors.empty()) return;
+      *_err << errors;
+      _had_error = true;
+    }
 
+  private:
+    std::ostream* _err; ///< The stream errors are written to.
+    bool _had_error = false; ///< Flag to indicate if an error has occurred.
+    bool _had_runtime_error = false; ///< Flag to indicate if a runtime error has occured.
+  };
 }
@@ -0,0 +1,634 @@
+#include "AstCache.h"
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+#include <unistd.h>
+
+#include "BinaryIO.h"
+#include "Parser.h"
+
+namespace AstCache
+{
+  namespace
+  {
+    /// Written at the start of every entry.
+    constexpr char MAGIC[8] = { 'L', 'O', 'X', 'A', 'S', 'T', '\0', '\0' };
+
+    /// Tag of an absent (null) node.
+    constexpr uint8_t NONE = 0;
+
+    /**
+     * @brief Tags of the expression nodes.
+     */
+    enum ExprTag : uint8_t
+    {
+      ASSIGN = 1, BINARY, CALL, GROUPING, LITERAL, LOGICAL, UNARY, TERNARY, VARIABLE, UPDATE
+    };
+
+    /**
+     * @brief Tags of the statement nodes.
+     */
+    enum StmtTag : uint8_t
+    {
+      BLOCK = 1, EXPRESSION, IF_STMT, FUNCTION, PRINT_STMT, RETURN_STMT, VAR_STMT, WHILE_STMT, JUMP, FOR_STMT, YIELD_STMT
+    };
+
+    /**
+     * @brief Tags of the literal values.
+     */
+    enum LiteralTag : uint8_t
+    {
+      NIL_VALUE, STRING_VALUE, NUMBER_VALUE, BOOL_VALUE
+    };
+
+    /**
+     * @brief Tags of function bodies.
+     */
+    enum BodyTag : uint8_t
+    {
+      PARSED_BODY, DEFERRED_BODY
+    };
+
+    /**
+     * @brief Hashes the script text together with the interpreter version and the
+     *        parse mode (64-bit FNV-1a).
+     *
+     * Lazy and eager parses get entries of their own, since a lazy entry holds bodies
+     * whose syntax errors an eager run must report.
+     */
+    uint64_t key(const Source& source, const bool& lazy)
+    {
+      uint64_t hash = 14695981039346656037ull;
+      for (std::string_view text : { source.text(), version(), lazy ? std::string_view("lazy") : std::string_view("eager") })
+        for (unsigned char c : text)
+          hash = (hash ^ c) * 1099511628211ull;
+      return hash;
+    }
+
+    /**
+     * @class Writer
+     * @brief Serializes a syntax tree by visiting it, appending to a byte buffer.
+     */
+    class Writer : public BinaryWriter, public Expr<LiteralValue>::Visitor, public Stmt<LiteralValue>::Visitor
+    {
+    public:
+      /// Where to number the function declarations written, if anywhere.
+      std::vector<const Stmt<LiteralValue>::Function*>* functions = nullptr;
+
+      void token(const Token& token)
+      {
+        raw(static_cast<uint8_t>(token.type));
+        raw(token.offset);
+        raw(token.length);
+      }
+
+      void expr(const std::shared_ptr<const Expr<LiteralValue>>& expr)
+      {
+        if (expr == nullptr) raw(NONE);
+        else expr->accept(*this);
+      }
+
+      void stmt(const std::shared_ptr<const Stmt<LiteralValue>>& stmt)
+      {
+        if (stmt == nullptr) raw(NONE);
+        else stmt->accept(*this);
+      }
+
+      void stmts(const std::vector<std::shared_ptr<const Stmt<LiteralValue>>>& statements)
+      {
+        size(statements.size());
+        for (const auto& statement : statements)
+          stmt(statement);
+      }
+
+      LiteralValue visitAssignExpr(const Expr<LiteralValue>::Assign& expr) override
+      {
+        raw(ASSIGN);
+        token(expr.name);
+        this->expr(expr.value);
+        return std::monostate();
+      }
+
+      LiteralValue visitBinaryExpr(const Expr<LiteralValue>::Binary& expr) override
+      {
+        raw(BINARY);
+        this->expr(expr.left);
+        token(expr.oper);
+        this->expr(expr.right);
+        return std::monostate();
+      }
+
+      LiteralValue visitCallExpr(const Expr<LiteralValue>::Call& expr) override
+      {
+        raw(CALL);
+        this->expr(expr.callee);
+        token(expr.paren);
+        size(expr.arguments.size());
+        for (const auto& argument : expr.arguments)
+          this->expr(argument);
+        return std::monostate();
+      }
+
+      LiteralValue visitGroupingExpr(const Expr<LiteralValue>::Grouping& expr) override
+      {
+        raw(GROUPING);
+        this->expr(expr.expression);
+        return std::monostate();
+      }
+
+      LiteralValue visitLiteralExpr(const Expr<LiteralValue>::Literal& expr) override
+      {
+        raw(LITERAL);
+        if (std::holds_alternative<std::string>(expr.value))
+        {
+          raw(STRING_VALUE);
+          string(std::get<std::string>(expr.value));
+        }
+        else if (std::holds_alternative<double>(expr.value))
+        {
+          raw(NUMBER_VALUE);
+          raw(std::get<double>(expr.value));
+        }
+        else if (std::holds_alternative<bool>(expr.value))
+        {
+          raw(BOOL_VALUE);
+          raw(std::get<bool>(expr.value));
+        }
+        else
+          raw(NIL_VALUE);
+        return std::monostate();
+      }
+
+      LiteralValue visitLogicalExpr(const Expr<LiteralValue>::Logical& expr) override
+      {
+        raw(LOGICAL);
+        this->expr(expr.left);
+        token(expr.oper);
+        this->expr(expr.right);
+        return std::monostate();
+      }
+
+      LiteralValue visitUnaryExpr(const Expr<LiteralValue>::Unary& expr) override
+      {
+        raw(UNARY);
+        token(expr.oper);
+        this->expr(expr.right);
+        return std::monostate();
+      }
+
+      LiteralValue visitTernaryExpr(const Expr<LiteralValue>::Ternary& expr) override
+      {
+        raw(TERNARY);
+        this->expr(expr.condition);
+        this->expr(expr.then_branch);
+        this->expr(expr.else_branch);
+        return std::monostate();
+      }
+
+      LiteralValue visitVariableExpr(const Expr<LiteralValue>::Variable& expr) override
+      {
+        raw(VARIABLE);
+        token(expr.name);
+        return std::monostate();
+      }
+
+      LiteralValue visitUpdateExpr(const Expr<LiteralValue>::Update& expr) override
+      {
+        raw(UPDATE);
+        token(expr.name);
+        token(expr.oper);
+        this->expr(expr.value);
+        raw(expr.postfix);
+        return std::monostate();
+      }
+
+      LiteralValue visitBlockStmt(const Stmt<LiteralValue>::Block& stmt) override
+      {
+        raw(BLOCK);
+        stmts(stmt.statements);
+        return std::monostate();
+      }
+
+      LiteralValue visitExpressionStmt(const Stmt<LiteralValue>::Expression& stmt) override
+      {
+        raw(EXPRESSION);
+        expr(stmt.expression);
+        return std::monostate();
+      }
+
+      LiteralValue visitIfStmt(const Stmt<LiteralValue>::If& stmt) override
+      {
+        raw(IF_STMT);
+        expr(stmt.condition);
+        this->stmt(stmt.then_branch);
+        this->stmt(stmt.else_branch);
+        return std::monostate();
+      }
+
+      LiteralValue visitFunctionStmt(const Stmt<LiteralValue>::Function& stmt) override
+      {
+        raw(FUNCTION);
+        token(stmt.name);
+        size(stmt.params.size());
+        for (const Token& param : stmt.params)
+          token(param);
+
+        if (stmt.body->parsed())
+        {
+          raw(PARSED_BODY);
+          stmts(stmt.body->statements());
+        }
+        else
+        {
+          raw(DEFERRED_BODY);
+          size(stmt.body->offset());
+        }
+
+        // Numbered after the body, in the order the reader creates them.
+        if (functions != nullptr) functions->push_back(&stmt);
+        return std::monostate();
+      }
+
+      LiteralValue visitPrintStmt(const Stmt<LiteralValue>::Print& stmt) override
+      {
+        raw(PRINT_STMT);
+        expr(stmt.expression);
+        return std::monostate();
+      }
+
+      LiteralValue visitReturnStmt(const Stmt<LiteralValue>::Return& stmt) override
+      {
+        raw(RETURN_STMT);
+        token(stmt.keyword);
+        expr(stmt.value);
+        return std::monostate();
+      }
+
+      LiteralValue visitVarStmt(const Stmt<LiteralValue>::Var& stmt) override
+      {
+        raw(VAR_STMT);
+        token(stmt.name);
+        expr(stmt.initializer);
+        return std::monostate();
+      }
+
+      LiteralValue visitWhileStmt(const Stmt<LiteralValue>::While& stmt) override
+      {
+        raw(WHILE_STMT);
+        expr(stmt.condition);
+        this->stmt(stmt.body);
+        return std::monostate();
+      }
+
+      LiteralValue visitJumpStmt(const Stmt<LiteralValue>::Jump& stmt) override
+      {
+        raw(JUMP);
+        token(stmt.keyword);
+        return std::monostate();
+      }
+
+      LiteralValue visitForStmt(const Stmt<LiteralValue>::For& stmt) override
+      {
+        raw(FOR_STMT);
+        token(stmt.name);
+        expr(stmt.start);
+        expr(stmt.stop);
+        expr(stmt.step);
+        this->stmt(stmt.body);
+        return std::monostate();
+      }
+
+      LiteralValue visitYieldStmt(const Stmt<LiteralValue>::Yield& stmt) override
+      {
+        raw(YIELD_STMT);
+        token(stmt.keyword);
+        expr(stmt.value);
+        return std::monostate();
+      }
+    };
+
+    /**
+     * @class Reader
+     * @brief Rebuilds a syntax tree from its serialization, throwing on malformed input.
+     */
+    class Reader : public BinaryReader
+    {
+    public:
+      using ExprPtr = std::shared_ptr<const Expr<LiteralValue>>;
+      using StmtPtr = std::shared_ptr<const Stmt<LiteralValue>>;
+
+      /// Where to number the function declarations read, if anywhere.
+      std::vector<const Stmt<LiteralValue>::Function*>* functions = nullptr;
+
+      Reader(std::string_view buffer, const Source& source)
+        : BinaryReader(buffer), _source(source) {}
+
+      Token token()
+      {
+        uint8_t type = raw<uint8_t>();
+        uint32_t offset = raw<uint32_t>();
+        uint32_t length = raw<uint32_t>();
+        if (type > END || size_t(offset) + length > _source.text().size())
+          throw std::runtime_error("Corrupt cache entry.");
+        return Token(static_cast<TokenType>(type), offset, length, _source);
+      }
+
+      LiteralValue literal()
+      {
+        switch (raw<uint8_t>())
+        {
+          case NIL_VALUE: return std::monostate();
+          case STRING_VALUE: return std::string(string());
+          case NUMBER_VALUE: return raw<double>();
+          case BOOL_VALUE: return raw<bool>();
+          default: throw std::runtime_error("Corrupt cache entry.");
+        }
+      }
+
+      template <class Node>
+      ExprPtr binary()
+      {
+        ExprPtr left = expr();
+        Token oper = token();
+        return std::make_shared<Node>(left, oper, expr());
+      }
+
+      ExprPtr expr()
+      {
+        using E = Expr<LiteralValue>;
+        switch (raw<uint8_t>())
+        {
+          case NONE: return nullptr;
+          case ASSIGN:
+          {
+            Token name = token();
+            return std::make_shared<E::Assign>(name, expr());
+          }
+          case BINARY: return binary<E::Binary>();
+          case LOGICAL: return binary<E::Logical>();
+          case CALL:
+          {
+            ExprPtr callee = expr();
+            Token paren = token();
+            std::vector<ExprPtr> arguments(size());
+            for (ExprPtr& argument : arguments)
+              argument = expr();
+            return std::make_shared<E::Call>(callee, paren, arguments);
+          }
+          case GROUPING: return std::make_shared<E::Grouping>(expr());
+          case LITERAL: return std::make_shared<E::Literal>(literal());
+          case UNARY:
+          {
+            Token oper = token();
+            return std::make_shared<E::Unary>(oper, expr());
+          }
+          case TERNARY:
+          {
+            ExprPtr condition = expr();
+            ExprPtr then_branch = expr();
+            ExprPtr else_branch = expr();
+            return std::make_shared<E::Ternary>(condition, then_branch, else_branch);
+          }
+          case VARIABLE: return std::make_shared<E::Variable>(token());
+          case UPDATE:
+          {
+            Token name = token();
+            Token oper = token();
+            ExprPtr value = expr();
+            return std::make_shared<E::Update>(name, oper, value, raw<bool>());
+          }
+          default: throw std::runtime_error("Corrupt cache entry.");
+        }
+      }
+
+      std::vector<StmtPtr> stmts()
+      {
+        std::vector<StmtPtr> statements(size());
+        for (StmtPtr& statement : statements)
+          statement = stmt();
+        return statements;
+      }
+
+      std::shared_ptr<Stmt<LiteralValue>> stmt()
+      {
+        using S = Stmt<LiteralValue>;
+        switch (raw<uint8_t>())
+        {
+          case NONE: return nullptr;
+          case BLOCK: return std::make_shared<S::Block>(stmts());
+          case EXPRESSION: return std::make_shared<S::Expression>(expr());
+          case IF_STMT:
+          {
+            ExprPtr condition = expr();
+            StmtPtr then_branch = stmt();
+            return std::make_shared<S::If>(condition, then_branch, stmt());
+          }
+          case FUNCTION:
+          {
+            Token name = token();
+            std::vector<Token> params;
+            for (size_t count = size(); params.size() < count; )
+              params.push_back(token());
+
+            std::shared_ptr<const FunctionBody<LiteralValue>> body;
+            if (raw<uint8_t>() == PARSED_BODY)
+              body = std::make_shared<const FunctionBody<LiteralValue>>(stmts());
+            else
+              body = Parser<LiteralValue>::deferredBody(_source, size(), name);
+
+            auto function = std::make_shared<S::Function>(name, params, body);
+            if (functions != nullptr) functions->push_back(function.get());
+            return function;
+          }
+          case PRINT_STMT: return std::make_shared<S::Print>(expr());
+          case RETURN_STMT:
+          {
+            Token keyword = token();
+            return std::make_shared<S::Return>(keyword, expr());
+          }
+          case VAR_STMT:
+          {
+            Token name = token();
+            return std::make_shared<S::Var>(name, expr());
+          }
+          case WHILE_STMT:
+          {
+            ExprPtr condition = expr();
+            return std::make_shared<S::While>(condition, stmt());
+          }
+          case JUMP: return std::make_shared<S::Jump>(token());
+          case FOR_STMT:
+          {
+            Token name = token();
+            ExprPtr start = expr();
+            ExprPtr stop = expr();
+            ExprPtr step = expr();
+            return std::make_shared<S::For>(name, start, stop, step, stmt());
+          }
+          case YIELD_STMT:
+          {
+            Token keyword = token();
+            return std::make_shared<S::Yield>(keyword, expr());
+          }
+          default: throw std::runtime_error("Corrupt cache entry.");
+        }
+      }
+
+    private:
+      const Source& _source; ///< The script the tokens refer to.
+    };
+  }
+
+  /**
+   * @brief Identifies the interpreter build, since the format follows the syntax tree classes.
+   * @return The version string.
+   */
+  std::string_view version()
+  {
+    return "cpplox-ast 2 " __DATE__ " " __TIME__;
+  }
+
+  /**
+   * @brief Serializes statements into the binary format of cache entries.
+   * @param statements The statements to serialize.
+   * @param functions If given, receives every function declaration written, in order.
+   * @return The serialized bytes.
+   */
+  std::string serialize(const std::vector<std::shared_ptr<Stmt<LiteralValue>>>& statements,
+                        std::vector<const Stmt<LiteralValue>::Function*>* functions)
+  {
+    Writer writer;
+    writer.functions = functions;
+    writer.size(statements.size());
+    for (const auto& statement : statements)
+      writer.stmt(statement);
+    return std::move(writer.buffer);
+  }
+
+  /**
+   * @brief Rebuilds statements from their serialization.
+   * @param data The serialized bytes.
+   * @param source The script the tokens refer to.
+   * @param functions If given, receives every function declaration read, in the order written.
+   * @return The statements.
+   * @throws std::runtime_error if the data is malformed.
+   */
+  std::vector<std::shared_ptr<Stmt<LiteralValue>>> deserialize(std::string_view data, const Source& source,
+                                                               std::vector<const Stmt<LiteralValue>::Function*>* functions)
+  {
+    Reader reader(data, source);
+    reader.functions = functions;
+
+    std::vector<std::shared_ptr<Stmt<LiteralValue>>> statements(reader.size());
+    for (std::shared_ptr<Stmt<LiteralValue>>& statement : statements)
+      statement = reader.stmt();
+
+    if (!reader.atEnd()) throw std::runtime_error("Trailing bytes after syntax tree.");
+    return statements;
+  }
+
+  /**
+   * @brief Returns the directory entries are kept in when none is given.
+   * @return `$XDG_CACHE_HOME/cpplox` or `$HOME/.cache/cpplox`, or an empty string
+   *         if neither variable is set.
+   */
+  std::string defaultDirectory()
+  {
+    if (const char* cache = std::getenv("XDG_CACHE_HOME"); cache != nullptr && *cache != '\0')
+      return std::string(cache) + "/cpplox";
+    if (const char* home = std::getenv("HOME"); home != nullptr && *home != '\0')
+      return std::string(home) + "/.cache/cpplox";
+    return "";
+  }
+
+  /**
+   * @brief Returns the path of the entry for a script.
+   * @param directory The cache directory.
+   * @param source The script.
+   * @param lazy Whether function bodies are parsed on their first call.
+   * @return The path the script's entry is stored at.
+   */
+  std::string entryPath(const std::string& directory, const Source& source, const bool& lazy)
+  {
+    std::ostringstream path;
+    path << directory << '/' << std::hex << key(source, lazy) << ".ast";
+    return path.str();
+  }
+
+  /**
+   * @brief Loads the cached syntax tree of a script.
+   * @param directory The cache directory.
+   * @param source The script, which the loaded tokens will refer to.
+   * @param lazy Whether function bodies are parsed on their first call.
+   * @return The top-level statements, or nothing if there is no valid entry.
+   */
+  std::optional<std::vector<std::shared_ptr<Stmt<LiteralValue>>>> load(const std::string& directory, const Source& source,
+                                                                       const bool& lazy)
+  {
+    std::unique_ptr<const Source> entry = Source::load(entryPath(directory, source, lazy), true);
+    if (!entry) return std::nullopt;
+
+    try
+    {
+      BinaryReader reader(entry->text());
+      if (reader.raw<std::array<char, sizeof(MAGIC)>>() != std::to_array(MAGIC)
+          || reader.raw<uint64_t>() != key(source, lazy)
+          || reader.raw<uint64_t>() != source.text().size())
+        return std::nullopt;
+
+      return deserialize(reader.string(), source);
+    }
+    catch (const std::runtime_error&)
+    {
+      return std::nullopt;
+    }
+  }
+
+  /**
+   * @brief Stores the syntax tree of a script, which must have parsed without errors.
+   * @param directory The cache directory, created if needed.
+   * @param source The script.
+   * @param lazy Whether function bodies were left to be parsed on their first call.
+   * @param statements The top-level statements of the script.
+   * @return False if the entry could not be written.
+   */
+  bool store(const std::string& directory, const Source& source, const bool& lazy,
+             const std::vector<std::shared_ptr<Stmt<LiteralValue>>>& statements)
+  {
+    BinaryWriter writer;
+    writer.buffer.append(MAGIC, sizeof(MAGIC));
+    writer.raw(key(source, lazy));
+    writer.raw(static_cast<uint64_t>(source.text().size()));
+    writer.string(serialize(statements));
+
+    // Write to a temporary file first so that readers never see a partial entry.
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    const std::string path = entryPath(directory, source, lazy);
+    // Jobs running on several threads may store the same entry at once.
+    const std::string temporary = path + ".tmp" + std::to_string(getpid()) + "."
+      + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+      std::ofstream file(temporary, std::ios::binary);
+      if (!file.write(writer.buffer.data(), writer.buffer.size())) return false;
+    }
+
+    std::filesystem::rename(temporary, path, error);
+    if (error)
+    {
+      std::filesystem::remove(temporary, error);
+      return false;
+    }
+    return true;
+  }
+}
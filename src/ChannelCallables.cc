@@ -0,0 +1,83 @@
+#include "ChannelCallables.h"
+
+namespace
+{
+  constexpr size_t max_capacity = 1 << 20; ///< The largest capacity a script may ask for.
+
+  /**
+   * @brief Returns the channel an argument holds.
+   * @throws NativeError if it holds anything else.
+   */
+  LoxChannel& channel(const LiteralValue& argument)
+  {
+    std::shared_ptr<LoxChannel> channel;
+    if (std::holds_alternative<std::shared_ptr<LoxCallable>>(argument))
+      channel = std::dynamic_pointer_cast<LoxChannel>(std::get<std::shared_ptr<LoxCallable>>(argument));
+    if (channel == nullptr)
+      throw NativeError("Expected a channel.");
+    return *channel;
+  }
+}
+
+/**
+ * @brief Creates a channel holding at least the given number of values at once.
+ *
+ * @param interpreter The interpreter creating the channel (unused).
+ * @param arguments The capacity.
+ * @return The channel.
+ * @throws NativeError if the capacity is not a number from 1 to 2^20.
+ */
+LiteralValue ChannelCallable::call(Interpreter&, const std::vector<LiteralValue>& arguments)
+{
+  // Written so that NaN fails too, and infinity never reaches the cast.
+  if (!std::holds_alternative<double>(arguments[0]) || !(std::get<double>(arguments[0]) >= 1) ||
+      !(std::get<double>(arguments[0]) <= max_capacity))
+    throw NativeError("Channel capacity must be a number from 1 to " + std::to_string(max_capacity) + ".");
+
+  return std::shared_ptr<LoxCallable>(std::make_shared<LoxChannel>(static_cast<size_t>(std::get<double>(arguments[0]))));
+}
+
+/**
+ * @brief Sends the value to the channel.
+ *
+ * @param interpreter The interpreter sending (unused).
+ * @param arguments The channel and the value.
+ * @return True, or false if the channel was closed.
+ * @throws NativeError if the first argument is not a channel or the value cannot be sent.
+ */
+LiteralValue SendCallable::call(Interpreter&, const std::vector<LiteralValue>& arguments)
+{
+  LoxChannel& target = channel(arguments[0]);
+  // Functions, tasks and channels hold state that the receiver would share.
+  if (std::holds_alternative<std::shared_ptr<LoxCallable>>(arguments[1]))
+    throw NativeError("Can only send numbers, strings, booleans and nil.");
+
+  return target.send(arguments[1]);
+}
+
+/**
+ * @brief Receives the oldest value of the channel.
+ *
+ * @param interpreter The interpreter receiving (unused).
+ * @param arguments The channel.
+ * @return The value, or nil once the channel is closed and drained.
+ * @throws NativeError if the argument is not a channel.
+ */
+LiteralValue RecvCallable::call(Interpreter&, const std::vector<LiteralValue>& arguments)
+{
+  return channel(arguments[0]).receive();
+}
+
+/**
+ * @brief Closes the channel.
+ *
+ * @param interpreter The interpreter closing it (unused).
+ * @param arguments The channel.
+ * @return nil.
+ * @throws NativeError if the argument is not a channel.
+ */
+LiteralValue CloseCallable::call(Interpreter&, const std::vector<LiteralValue>& arguments)
+{
+  channel(arguments[0]).close();
+  return std::monostate();
+}
@@ -7,9 +7,20 @@
  * @param name The name of the variable.
  * @param value The value to assign to the variable.
  */
-void Environment::define(const std::string& name, const LiteralValue& value)
+void Environment::define(std::string_view name, const LiteralValue& value)
 {
-  _values.insert({name, value});
+  _values.insert({std::string(name), value});
+}
+
+/**
+ * @brief Defines a new variable, taking over its value rather than copying it.
+ * 
+ * @param name The name of the variable.
+ * @param value The value to move into the variable.
+ */
+void Environment::define(std::string_view name, LiteralValue&& value)
+{
+  _values.insert({std::string(name), std::move(value)});
 }
 
 /**
@@ -24,12 +35,7 @@ void Environment::define(const std::string& name, const LiteralValue& value)
  */
 LiteralValue Environment::get(const Token& name)
 {
-  auto it = _values.find(name.lexeme);
-  if (it != _values.end()) return it->second;
-
-  if (_enclosing != nullptr) return _enclosing->get(name);
-
-  throw RuntimeError(name, "Undefined variable '" + name.lexeme + "'.");
+  return lookup(name);
 }
 
 /**
@@ -44,18 +50,48 @@ LiteralValue Environment::get(const Token& name)
  */
 void Environment::assign(const Token& name, const LiteralValue& value)
 {
-  auto it = _values.find(name.lexeme);
-  if (it != _values.end())
-  {
-    it->second = value;
-    return; 
-  }
+  lookup(name) = value;
+}
 
-  if (_enclosing != nullptr)
+/**
+ * @brief Locates an existing variable and returns a reference to its stored value.
+ * 
+ * @param name The token representing the variable name.
+ * @return A reference to the value of the variable.
+ * @throws RuntimeError if the variable is not found in the current or enclosing environments.
+ */
+LiteralValue& Environment::lookup(const Token& name)
+{
+  LiteralValue* value = find(name.lexeme());
+  if (value != nullptr) return *value;
+
+  throw RuntimeError(name, "Undefined variable '" + std::string(name.lexeme()) + "'.");
+}
+
+/**
+ * @brief Locates a variable without throwing if it is undefined.
+ * 
+ * @param name The name of the variable.
+ * @return A pointer to the value of the variable, or nullptr if it is not found.
+ */
+LiteralValue* Environment::find(std::string_view name)
+{
+  for (Environment* environment = this; environment != nullptr; environment = environment->_enclosing.get())
   {
-    _enclosing->assign(name, value);
-    return;
+    auto it = environment->_values.find(name);
+    if (it != environment->_values.end()) return &it->second;
   }
+  return nullptr;
+}
 
-  throw RuntimeError(name, "Undefined variable '" + name.lexeme + "'.");
+/**
+ * @brief Copies the environment together with every environment enclosing it.
+ * 
+ * @return The copy.
+ */
+Environment Environment::snapshot() const
+{
+  Environment copy(_enclosing == nullptr ? nullptr : std::make_shared<Environment>(_enclosing->snapshot()));
+  copy._values = _values;
+  return copy;
 }
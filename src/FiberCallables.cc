@@ -0,0 +1,56 @@
+#include "FiberCallables.h"
+
+#include <chrono>
+
+#include "Scheduler.h"
+
+/**
+ * @brief Starts a fiber calling the function with the remaining arguments.
+ *
+ * @param interpreter The interpreter starting the fiber.
+ * @param arguments The function, followed by its arguments.
+ * @return The fiber, which first runs once the caller gives way.
+ * @throws NativeError if the first argument is not callable or the rest do not match its arity.
+ */
+LiteralValue FiberCallable::call(Interpreter& interpreter, const std::vector<LiteralValue>& arguments)
+{
+  if (!std::holds_alternative<std::shared_ptr<LoxCallable>>(arguments[0]))
+    throw NativeError("Can only start functions as fibers.");
+
+  const std::shared_ptr<LoxCallable>& function = std::get<std::shared_ptr<LoxCallable>>(arguments[0]);
+  function->checkArity(arguments.size() - 1);
+
+  return std::shared_ptr<LoxCallable>(
+    interpreter.scheduler().start(function, std::vector<LiteralValue>(arguments.begin() + 1, arguments.end())));
+}
+
+/**
+ * @brief Suspends the running fiber, running the others meanwhile.
+ *
+ * @param interpreter The interpreter sleeping.
+ * @param arguments The number of milliseconds to sleep.
+ * @return nil.
+ * @throws NativeError if the time is not a non-negative number.
+ */
+LiteralValue SleepCallable::call(Interpreter& interpreter, const std::vector<LiteralValue>& arguments)
+{
+  if (!std::holds_alternative<double>(arguments[0]) || !(std::get<double>(arguments[0]) >= 0))
+    throw NativeError("Sleep time must be a non-negative number.");
+
+  interpreter.scheduler().sleep(std::chrono::duration_cast<Scheduler::Clock::duration>(
+    std::chrono::duration<double, std::milli>(std::get<double>(arguments[0]))));
+  return std::monostate();
+}
+
+/**
+ * @brief Switches to the next fiber ready to run, if any.
+ *
+ * @param interpreter The interpreter yielding.
+ * @param arguments No arguments.
+ * @return nil.
+ */
+LiteralValue YieldNowCallable::call(Interpreter& interpreter, const std::vector<LiteralValue>&)
+{
+  interpreter.scheduler().yield();
+  return std::monostate();
+}
@@ -0,0 +1,94 @@
+#include "FileCallables.h"
+
+#include <cstring>
+#include <utility>
+
+#include "Scheduler.h"
+
+namespace
+{
+  /**
+   * @brief Returns the string an argument holds.
+   * @throws NativeError naming what was expected if it holds anything else.
+   */
+  const std::string& text(const LiteralValue& argument, const char* what)
+  {
+    if (!std::holds_alternative<std::string>(argument))
+      throw NativeError(std::string(what) + " must be a string.");
+    return std::get<std::string>(argument);
+  }
+
+  /**
+   * @brief Runs a file operation on the running fiber.
+   * @return The request, holding what was read.
+   * @throws NativeError if the operation failed.
+   */
+  IoLoop::Request perform(Interpreter& interpreter, const IoLoop::Request::Kind& kind, const std::string& path, std::string data)
+  {
+    IoLoop::Request request{ kind, path, std::move(data) };
+    interpreter.scheduler().perform(request);
+    if (request.error != 0)
+      throw NativeError(std::string("Could not ") + (kind == IoLoop::Request::Kind::READ ? "read" : "write") +
+        " file '" + path + "': " + std::strerror(request.error) + ".");
+    return request;
+  }
+}
+
+/**
+ * @brief Reads a whole file, running the other fibers meanwhile.
+ *
+ * @param interpreter The interpreter reading.
+ * @param arguments The path of the file.
+ * @return The contents of the file.
+ * @throws NativeError if the path is not a string or the file cannot be read.
+ */
+LiteralValue ReadFileCallable::call(Interpreter& interpreter, const std::vector<LiteralValue>& arguments)
+{
+  return perform(interpreter, IoLoop::Request::Kind::READ, text(arguments[0], "Path"), {}).data;
+}
+
+/**
+ * @brief Writes a whole file, creating it if need be, running the other fibers meanwhile.
+ *
+ * @param interpreter The interpreter writing.
+ * @param arguments The path of the file and the string to write.
+ * @return nil.
+ * @throws NativeError if the arguments are not strings or the file cannot be written.
+ */
+LiteralValue WriteFileCallable::call(Interpreter& interpreter, const std::vector<LiteralValue>& arguments)
+{
+  perform(interpreter, IoLoop::Request::Kind::WRITE, text(arguments[0], "Path"), text(arguments[1], "Data"));
+  return std::monostate();
+}
+
+/**
+ * @brief Returns the next line, without its line ending.
+ *
+ * @param interpreter The interpreter iterating (unused).
+ * @param arguments No arguments.
+ * @return The line, or nil after the last one.
+ */
+LiteralValue LoxLines::call(Interpreter&, const std::vector<LiteralValue>&)
+{
+  if (_position >= _text.size()) return std::monostate();
+
+  size_t end = _text.find('\n', _position);
+  if (end == std::string::npos) end = _text.size();
+  const size_t start = std::exchange(_position, end + 1);
+  if (end > start && _text[end - 1] == '\r') --end;
+  return _text.substr(start, end - start);
+}
+
+/**
+ * @brief Reads a whole file, running the other fibers meanwhile.
+ *
+ * @param interpreter The interpreter reading.
+ * @param arguments The path of the file.
+ * @return The lines of the file, which return the next one when called.
+ * @throws NativeError if the path is not a string or the file cannot be read.
+ */
+LiteralValue ReadLinesCallable::call(Interpreter& interpreter, const std::vector<LiteralValue>& arguments)
+{
+  return std::shared_ptr<LoxCallable>(
+    std::make_shared<LoxLines>(perform(interpreter, IoLoop::Request::Kind::READ, text(arguments[0], "Path"), {}).data));
+}
@@ -0,0 +1,492 @@
+#include "Generator.h"
+
+#include <new>
+#include <utility>
+
+namespace
+{
+  /**
+   * @brief Keeps the coroutine frames a thread has freed, by size, for the next
+   *        coroutines of the same size, so that re-entering a loop or block in a
+   *        generator does not go back to the heap.
+   */
+  class FramePool
+  {
+  public:
+    static constexpr size_t granularity = 64; ///< Frame sizes are rounded up to a multiple of this.
+    static constexpr size_t classes = 32; ///< The number of sizes kept; larger frames are not.
+    static constexpr size_t capacity = 64; ///< The most frames kept of each size.
+
+    ~FramePool()
+    {
+      for (Free*& list : _lists)
+        while (list != nullptr)
+          ::operator delete(std::exchange(list, list->next));
+      destroyed = true;
+    }
+
+    void* allocate(const size_t& size)
+    {
+      const size_t index = (size - 1) / granularity;
+      if (index >= classes) return ::operator new(size);
+      if (_lists[index] == nullptr) return ::operator new((index + 1) * granularity);
+
+      --_counts[index];
+      return std::exchange(_lists[index], _lists[index]->next);
+    }
+
+    void release(void* frame, const size_t& size)
+    {
+      const size_t index = (size - 1) / granularity;
+      if (index >= classes || _counts[index] == capacity)
+      {
+        ::operator delete(frame);
+        return;
+      }
+
+      ++_counts[index];
+      _lists[index] = new (frame) Free{ _lists[index] };
+    }
+
+    /// Whether the pool of this thread is gone, when frames are freed as the thread exits.
+    static thread_local bool destroyed;
+
+  private:
+    /**
+     * @brief A freed frame, linking to the next one of the same size.
+     */
+    struct Free
+    {
+      Free* next; /**< The next frame, or null */
+    };
+
+    Free* _lists[classes] = {}; ///< The frames kept, by size.
+    size_t _counts[classes] = {}; ///< How many frames of each size are kept.
+  };
+
+  thread_local bool FramePool::destroyed = false;
+  thread_local FramePool frame_pool; ///< The frames freed by this thread.
+
+  /**
+   * @class Analyzer
+   * @brief Finds the statements of a function body that contain a `yield`. Every
+   *        visit returns whether the statement does.
+   */
+  class Analyzer : public Stmt<LiteralValue>::Visitor
+  {
+  public:
+    Generator::Yielding yielding; ///< The statements found.
+
+    bool stmt(const std::shared_ptr<const Stmt<LiteralValue>>& stmt)
+    {
+      if (stmt == nullptr || !std::get<bool>(stmt->accept(*this))) return false;
+      yielding.insert(stmt.get());
+      return true;
+    }
+
+    bool stmts(const std::vector<std::shared_ptr<const Stmt<LiteralValue>>>& statements)
+    {
+      bool found = false;
+      for (const auto& statement : statements)
+        found = stmt(statement) || found;
+      return found;
+    }
+
+    LiteralValue visitBlockStmt(const Stmt<LiteralValue>::Block& stmt) override
+    {
+      return stmts(stmt.statements);
+    }
+
+    LiteralValue visitIfStmt(const Stmt<LiteralValue>::If& stmt) override
+    {
+      bool then_yields = this->stmt(stmt.then_branch);
+      return this->stmt(stmt.else_branch) || then_yields;
+    }
+
+    LiteralValue visitWhileStmt(const Stmt<LiteralValue>::While& stmt) override { return this->stmt(stmt.body); }
+    LiteralValue visitForStmt(const Stmt<LiteralValue>::For& stmt) override { return this->stmt(stmt.body); }
+    LiteralValue visitYieldStmt(const Stmt<LiteralValue>::Yield&) override { return true; }
+
+    // A nested function's yields make it a generator of its own.
+    LiteralValue visitFunctionStmt(const Stmt<LiteralValue>::Function&) override { return false; }
+    LiteralValue visitExpressionStmt(const Stmt<LiteralValue>::Expression&) override { return false; }
+    LiteralValue visitPrintStmt(const Stmt<LiteralValue>::Print&) override { return false; }
+    LiteralValue visitReturnStmt(const Stmt<LiteralValue>::Return&) override { return false; }
+    LiteralValue visitVarStmt(const Stmt<LiteralValue>::Var&) override { return false; }
+    LiteralValue visitJumpStmt(const Stmt<LiteralValue>::Jump&) override { return false; }
+  };
+}
+
+/**
+ * @class Generator::Steps
+ * @brief A coroutine running a statement of a generator's body, which its parent
+ *        statement awaits.
+ *
+ * It starts suspended, and starts running when awaited. Once it finishes, it resumes
+ * the coroutine awaiting it, which receives the error it stopped with, if any.
+ */
+class Generator::Steps
+{
+public:
+  /**
+   * @brief The state of the coroutine, kept in its frame.
+   */
+  struct promise_type
+  {
+    std::coroutine_handle<> parent = std::noop_coroutine(); /**< What to resume once finished */
+    std::exception_ptr error; /**< The error it stopped with, if any */
+
+    /**
+     * @brief Resumes the parent once the coroutine has finished.
+     */
+    struct Finish
+    {
+      bool await_ready() noexcept { return false; }
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> self) noexcept { return self.promise().parent; }
+      void await_resume() noexcept {}
+    };
+
+    Steps get_return_object() { return Steps(std::coroutine_handle<promise_type>::from_promise(*this)); }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    Finish final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { error = std::current_exception(); }
+
+    static void* operator new(size_t size)
+    {
+      return FramePool::destroyed ? ::operator new(size) : frame_pool.allocate(size);
+    }
+
+    static void operator delete(void* frame, size_t size)
+    {
+      if (FramePool::destroyed)
+        ::operator delete(frame);
+      else
+        frame_pool.release(frame, size);
+    }
+  };
+
+  Steps(Steps&& other) noexcept
+    : _handle(std::exchange(other._handle, nullptr)) {}
+
+  ~Steps()
+  {
+    if (_handle) _handle.destroy();
+  }
+
+  bool await_ready() const noexcept { return false; }
+
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> parent) noexcept
+  {
+    _handle.promise().parent = parent;
+    return _handle;
+  }
+
+  void await_resume()
+  {
+    if (_handle.promise().error) std::rethrow_exception(_handle.promise().error);
+  }
+
+  /**
+   * @brief Hands the coroutine over to the caller, who destroys it.
+   * @return The coroutine.
+   */
+  std::coroutine_handle<> release() { return std::exchange(_handle, nullptr); }
+
+private:
+  std::coroutine_handle<promise_type> _handle; ///< The coroutine, owned.
+
+  Steps(std::coroutine_handle<promise_type> handle)
+    : _handle(handle) {}
+};
+
+/**
+ * @brief Suspends the body, returning to whoever resumed the generator.
+ */
+struct Generator::Suspend
+{
+  Generator& generator; /**< The generator whose body is suspended */
+
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> leaf) noexcept { generator._leaf = leaf; }
+  void await_resume() const noexcept {}
+};
+
+/**
+ * @brief Finds the statements of a function body that contain a `yield`.
+ * @param statements The body.
+ * @return The statements, none if the function is not a generator.
+ */
+Generator::Yielding Generator::analyze(const std::vector<std::shared_ptr<const Stmt<LiteralValue>>>& statements)
+{
+  Analyzer analyzer;
+  analyzer.stmts(statements);
+  return std::move(analyzer.yielding);
+}
+
+/**
+ * @brief Takes the next value of a loop over a generator, or over any other callable.
+ * @param interpreter The interpreter running the loop.
+ * @param iterable The generator or callable.
+ * @param name The loop variable, to report errors at.
+ * @param value Receives the next value.
+ * @return False once there are no values left.
+ * @throws RuntimeError if the iterable cannot be iterated over.
+ */
+bool Generator::next(Interpreter& interpreter, const LiteralValue& iterable, const Token& name, LiteralValue& value)
+{
+  if (!std::holds_alternative<std::shared_ptr<LoxCallable>>(iterable))
+    throw RuntimeError(name, "Can only iterate over generators and functions.");
+
+  LoxCallable& callable = *std::get<std::shared_ptr<LoxCallable>>(iterable);
+  try
+  {
+    if (auto generator = dynamic_cast<Generator*>(&callable))
+    {
+      if (!generator->resume(interpreter)) return false;
+      value = std::move(generator->_value);
+      return true;
+    }
+
+    if (callable.arity() != 0)
+      throw NativeError("Can only iterate over functions without parameters.");
+    value = callable.call(interpreter, {});
+  }
+  catch (const NativeError& error)
+  {
+    throw RuntimeError(name, error.what());
+  }
+  return !std::holds_alternative<std::monostate>(value);
+}
+
+/**
+ * @brief Creates a generator that has not started running its body yet.
+ * @param interpreter The interpreter calling the generator function.
+ * @param statements The body of the function.
+ * @param yielding The statements of the body that contain a `yield`.
+ * @param scope The scope of the call, holding the arguments.
+ */
+Generator::Generator(Interpreter& interpreter, const std::vector<std::shared_ptr<const Stmt<LiteralValue>>>& statements,
+                     const Yielding& yielding, Environment scope)
+  : _interpreter(&interpreter), _yielding(yielding), _scope(std::make_shared<Environment>(std::move(scope)))
+{
+  _root = _leaf = body(statements).release();
+}
+
+/**
+ * @brief Destroys the generator, abandoning its body where it was suspended.
+ */
+Generator::~Generator()
+{
+  // The coroutines being awaited are destroyed along with the frames awaiting them.
+  if (_root) _root.destroy();
+}
+
+/**
+ * @brief Runs the body up to its next `yield`.
+ * @param interpreter The interpreter resuming the generator.
+ * @return False once the body has returned, in which case no value was yielded.
+ * @throws NativeError if the generator belongs to another interpreter or is already running.
+ * @throws RuntimeError, or any other error, the body stopped with.
+ */
+bool Generator::resume(Interpreter& interpreter)
+{
+  if (&interpreter != _interpreter)
+    throw NativeError("Generators can only be resumed by the interpreter that created them.");
+  if (_running)
+    throw NativeError("Generator is already running.");
+  if (!_root) return false;
+
+  _running = true;
+  std::swap(_interpreter->environment._enclosing, _scope);
+  _leaf.resume();
+  std::swap(_interpreter->environment._enclosing, _scope);
+  _running = false;
+
+  if (!_root.done()) return true;
+
+  _root.destroy();
+  _root = _leaf = nullptr;
+  _scope.reset();
+  if (_error) std::rethrow_exception(std::exchange(_error, nullptr));
+  return false;
+}
+
+/**
+ * @brief Runs the body up to its next `yield`.
+ *
+ * @param interpreter The interpreter resuming the generator.
+ * @param arguments No arguments.
+ * @return The value yielded, or nil once the body has returned.
+ */
+LiteralValue Generator::call(Interpreter& interpreter, const std::vector<LiteralValue>&)
+{
+  if (!resume(interpreter)) return std::monostate();
+  return std::move(_value);
+}
+
+/**
+ * @brief Installs a new innermost scope in the interpreter.
+ * @return The scopes it replaced, for `leave`.
+ */
+std::shared_ptr<Environment> Generator::enter(Environment scope)
+{
+  return std::exchange(_interpreter->environment._enclosing, std::make_shared<Environment>(std::move(scope)));
+}
+
+/**
+ * @brief Restores the scopes `enter` replaced.
+ */
+void Generator::leave(std::shared_ptr<Environment> previous)
+{
+  _interpreter->environment._enclosing = std::move(previous);
+}
+
+/**
+ * @brief Evaluates the value of a `yield`, and suspends the body.
+ */
+Generator::Suspend Generator::yield(const Stmt<LiteralValue>::Yield& stmt)
+{
+  _value = stmt.value == nullptr ? LiteralValue(std::monostate()) : _interpreter->evaluate(stmt.value);
+  return Suspend{ *this };
+}
+
+/**
+ * @brief Returns the coroutine running a statement that contains a `yield`.
+ */
+Generator::Steps Generator::step(const Stmt<LiteralValue>& stmt)
+{
+  if (auto block = dynamic_cast<const Stmt<LiteralValue>::Block*>(&stmt))
+    return this->block(block->statements);
+  if (auto branch = dynamic_cast<const Stmt<LiteralValue>::If*>(&stmt))
+    return this->branch(*branch);
+  if (auto loop = dynamic_cast<const Stmt<LiteralValue>::While*>(&stmt))
+    return this->loop(*loop);
+  if (auto range = dynamic_cast<const Stmt<LiteralValue>::For*>(&stmt))
+    return this->range(*range);
+  return single(static_cast<const Stmt<LiteralValue>::Yield&>(stmt));
+}
+
+/**
+ * @brief Runs the body of the function, and records how it stopped.
+ */
+Generator::Steps Generator::body(const std::vector<std::shared_ptr<const Stmt<LiteralValue>>>& statements)
+{
+  try
+  {
+    co_await block(statements);
+  }
+  catch (const Return&) {}
+  catch (...)
+  {
+    _error = std::current_exception();
+  }
+}
+
+/**
+ * @brief Runs statements in order.
+ *
+ * Declarations always define in the top-level scope, so a scope of the block's own
+ * would stay empty: the statements run in the enclosing scopes instead.
+ */
+Generator::Steps Generator::block(const std::vector<std::shared_ptr<const Stmt<LiteralValue>>>& statements)
+{
+  for (const auto& statement : statements)
+  {
+    if (!_yielding.contains(statement.get()))
+      _interpreter->execute(statement);
+    else if (auto yield = dynamic_cast<const Stmt<LiteralValue>::Yield*>(statement.get()))
+      co_await this->yield(*yield);
+    else
+      co_await step(*statement);
+  }
+}
+
+/**
+ * @brief Runs the taken branch of an if statement.
+ */
+Generator::Steps Generator::branch(const Stmt<LiteralValue>::If& stmt)
+{
+  const std::shared_ptr<const Stmt<LiteralValue>>& taken =
+    _interpreter->isTruthy(_interpreter->evaluate(stmt.condition)) ? stmt.then_branch : stmt.else_branch;
+
+  if (taken == nullptr) co_return;
+  if (_yielding.contains(taken.get()))
+    co_await step(*taken);
+  else
+    _interpreter->execute(taken);
+}
+
+/**
+ * @brief Runs a while loop.
+ */
+Generator::Steps Generator::loop(const Stmt<LiteralValue>::While& stmt)
+{
+  while (_interpreter->isTruthy(_interpreter->evaluate(stmt.condition)))
+  {
+    _interpreter->tick();
+    try
+    {
+      co_await step(*stmt.body);
+    }
+    catch (const Continue&)
+    {
+      continue;
+    }
+    catch (const Break&)
+    {
+      break;
+    }
+  }
+}
+
+/**
+ * @brief Runs a range loop, or a loop over a generator.
+ */
+Generator::Steps Generator::range(const Stmt<LiteralValue>::For& stmt)
+{
+  const bool iterating = stmt.stop == nullptr;
+  const LiteralValue iterable = iterating ? _interpreter->evaluate(stmt.start) : LiteralValue();
+  const Interpreter::Range values = iterating ? Interpreter::Range{ 0, 0, 1 } : _interpreter->range(stmt);
+
+  Environment scope(_interpreter->environment._enclosing);
+  scope.define(stmt.name.lexeme(), iterating ? LiteralValue() : LiteralValue(values.first));
+  std::shared_ptr<Environment> previous = enter(std::move(scope));
+  try
+  {
+    // Taken from the loop's own scope, like Interpreter::visitForStmt does.
+    LiteralValue& variable = *_interpreter->environment._enclosing->find(stmt.name.lexeme());
+    for (double counter = values.first; iterating ? next(*_interpreter, iterable, stmt.name, variable)
+                                                  : values.contains(counter); counter += values.step)
+    {
+      if (!iterating) variable = counter;
+      _interpreter->tick();
+      try
+      {
+        co_await step(*stmt.body);
+      }
+      catch (const Continue&)
+      {
+        continue;
+      }
+      catch (const Break&)
+      {
+        break;
+      }
+    }
+  }
+  catch (...)
+  {
+    leave(std::move(previous));
+    throw;
+  }
+  leave(std::move(previous));
+}
+
+/**
+ * @brief Runs a `yield` on its own, as the body of a loop or branch.
+ */
+Generator::Steps Generator::single(const Stmt<LiteralValue>::Yield& stmt)
+{
+  co_await yield(stmt);
+}
@@ -0,0 +1,214 @@
+#include "IncrementalParser.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Parser.h"
+
+/**
+ * @brief Constructs an IncrementalParser by parsing the whole document.
+ * @param text The text of the document.
+ * @param reporter Where to report syntax errors, which must outlive the parser.
+ */
+IncrementalParser::IncrementalParser(std::string_view text, Lox::Reporter& reporter)
+  : _reporter(&reporter)
+{
+  replace(0, 0, split(std::string(text), 1));
+}
+
+/**
+ * @brief Replaces part of the document and reparses the declarations it affects.
+ *
+ * The segments just before and after the edit are always rebuilt as well, since
+ * the edit may join their declarations with the edited one or split them apart.
+ *
+ * @param offset The offset of the text to replace.
+ * @param removed The length of the text to replace.
+ * @param inserted The text to insert in its place.
+ * @throws std::out_of_range if the replaced text runs past the end of the document.
+ */
+void IncrementalParser::edit(const size_t& offset, const size_t& removed, std::string_view inserted)
+{
+  if (offset > _size || removed > _size - offset)
+    throw std::out_of_range("Edit runs past the end of the document.");
+
+  size_t first = 0;
+  size_t last = 0;
+  if (!_segments.empty())
+  {
+    first = segmentAt(offset == 0 ? 0 : offset - 1);
+    last = segmentAt(std::min(offset + removed, _size - 1)) + 1;
+  }
+
+  std::string text;
+  for (size_t i = first; i < last; ++i)
+    text += _segments[i].source->text();
+  text.replace(offset - (first < _segments.size() ? _starts[first] : 0), removed, inserted);
+
+  Split split = IncrementalParser::split(text, lineAt(first));
+  while (true)
+  {
+    // An 'else' continues the declaration before it.
+    if (first > 0 && !split.tokens.empty() && split.tokens.front().type == ELSE)
+      text.insert(0, _segments[--first].source->text());
+    // The edit left a declaration, string or comment open, so take in more of the
+    // following segments, doubling the range each time.
+    else if (!split.complete && last < _segments.size())
+    {
+      size_t end = std::min(_segments.size(), last + std::max<size_t>(last - first, 1));
+      for (; last < end; ++last)
+        text += _segments[last].source->text();
+    }
+    else
+      break;
+
+    split = IncrementalParser::split(text, lineAt(first));
+  }
+
+  replace(first, last, split);
+}
+
+/**
+ * @brief Returns the top-level statements of the whole document.
+ * @return The statements of every segment, in order.
+ */
+std::vector<std::shared_ptr<Stmt<LiteralValue>>> IncrementalParser::statements() const
+{
+  std::vector<std::shared_ptr<Stmt<LiteralValue>>> statements;
+  for (const Segment& segment : _segments)
+    statements.insert(statements.end(), segment.statements.begin(), segment.statements.end());
+  return statements;
+}
+
+/**
+ * @brief Returns the current text of the document.
+ * @return The text of every segment, in order.
+ */
+std::string IncrementalParser::text() const
+{
+  std::string text;
+  text.reserve(_size);
+  for (const Segment& segment : _segments)
+    text += segment.source->text();
+  return text;
+}
+
+/**
+ * @brief Scans a range of text and splits it at the ends of top-level declarations.
+ * @param text The range of text.
+ * @param first_line The line the range starts on.
+ * @return The split range.
+ */
+IncrementalParser::Split IncrementalParser::split(std::string text, const int& first_line)
+{
+  Split split;
+  split.source = std::make_shared<const Source>(std::move(text), first_line);
+  split.tokens = Scanner(*split.source, 0, split.errors).scanTokens();
+  split.tokens.pop_back();
+
+  int depth = 0;
+  for (size_t i = 0; i < split.tokens.size(); ++i)
+  {
+    const Token& token = split.tokens[i];
+    if (token.type == LEFT_PAREN || token.type == LEFT_BRACE)
+      ++depth;
+    else if (token.type == RIGHT_PAREN || token.type == RIGHT_BRACE)
+      depth = std::max(depth - 1, 0);
+
+    if (depth == 0 && (token.type == SEMICOLON || token.type == RIGHT_BRACE)
+        && (i + 1 == split.tokens.size() || split.tokens[i + 1].type != ELSE))
+      split.ends.push_back(token.offset + token.length);
+  }
+
+  size_t size = split.source->text().size();
+  split.complete = split.ends.empty() ? size == 0 : split.ends.back() == size;
+  return split;
+}
+
+/**
+ * @brief Replaces a run of segments with the segments of a split range of text.
+ *
+ * Each new segment gets a copy of its text and of its tokens, rebased onto it, so
+ * that it can later be replaced on its own. Whatever follows the last declaration
+ * of the range becomes a segment of its own.
+ *
+ * @param first The index of the first segment replaced.
+ * @param last The index just after the last segment replaced.
+ * @param split The range of text the new segments are parsed from.
+ */
+void IncrementalParser::replace(const size_t& first, const size_t& last, const Split& split)
+{
+  std::string_view text = split.source->text();
+  std::vector<size_t> ends = split.ends;
+  if (!split.complete) ends.push_back(text.size());
+
+  std::vector<Segment> segments;
+  size_t begin = 0;
+  size_t next_token = 0;
+  size_t next_error = 0;
+  for (const size_t& end : ends)
+  {
+    auto source = std::make_shared<Source>(std::string(text.substr(begin, end - begin)), split.source->line(begin));
+
+    std::vector<Token> tokens;
+    for (; next_token < split.tokens.size() && split.tokens[next_token].offset < end; ++next_token)
+    {
+      const Token& token = split.tokens[next_token];
+      tokens.emplace_back(token.type, token.offset - begin, token.length, *source);
+    }
+    tokens.emplace_back(END, end - begin, 0, *source);
+
+    for (; next_error < split.errors.size() && split.errors[next_error].start < end; ++next_error)
+      _reporter->error(source->line(split.errors[next_error].offset - begin), split.errors[next_error].message);
+
+    segments.push_back({ source, Parser<LiteralValue>(std::move(tokens), *_reporter).parse() });
+    begin = end;
+  }
+
+  // Lines added or removed move every later segment.
+  size_t removed = 0;
+  for (size_t i = first; i < last; ++i)
+    removed += _segments[i].source->text().size();
+  int lines = last < _segments.size()
+    ? split.source->firstLine() + static_cast<int>(std::count(text.begin(), text.end(), '\n')) - lineAt(last)
+    : 0;
+
+  _segments.erase(_segments.begin() + first, _segments.begin() + last);
+  _segments.insert(_segments.begin() + first, std::make_move_iterator(segments.begin()), std::make_move_iterator(segments.end()));
+  _size = _size - removed + text.size();
+  _reparsed = text.size();
+
+  _starts.resize(_segments.size());
+  for (size_t i = first; i < _segments.size(); ++i)
+  {
+    _starts[i] = i == 0 ? 0 : _starts[i - 1] + _segments[i - 1].source->text().size();
+    if (lines != 0 && i >= first + segments.size())
+      _segments[i].source->relocate(_segments[i].source->firstLine() + lines);
+  }
+}
+
+/**
+ * @brief Finds the segment containing an offset into the document.
+ * @param offset The offset, which must be within the document.
+ * @return The index of the segment.
+ */
+size_t IncrementalParser::segmentAt(const size_t& offset) const
+{
+  return std::upper_bound(_starts.begin(), _starts.end(), offset) - _starts.begin() - 1;
+}
+
+/**
+ * @brief Returns the line a segment starts on, or the line after the last segment.
+ * @param index The index of the segment.
+ * @return The line number.
+ */
+int IncrementalParser::lineAt(const size_t& index) const
+{
+  if (index < _segments.size())
+    return _segments[index].source->firstLine();
+  if (_segments.empty())
+    return 1;
+
+  std::string_view text = _segments.back().source->text();
+  return _segments.back().source->firstLine() + std::count(text.begin(), text.end(), '\n');
+}
@@ -1,15 +1,84 @@
 #include "Interpreter.h"
 
+#include "ChannelCallables.h"
+#include "FiberCallables.h"
+#include "FileCallables.h"
+#include "Generator.h"
 #include "LoxCallable.h"
 #include "LoxFunction.h"
+#include "RecordCallables.h"
+#include "Scheduler.h"
+#include "TaskCallables.h"
 
 /**
  * @brief Initializes the interpreter's global environment and sets up built-in functions.
+ * 
+ * @param reporter Where to report runtime errors, which must outlive the interpreter.
+ * @param out The stream `print` writes to.
  */
-Interpreter::Interpreter()
-  : globals(Environment()), environment(globals)
+Interpreter::Interpreter(Lox::Reporter& reporter, std::ostream& out)
+  : globals(Environment()), environment(globals), _reporter(reporter), _out(out)
 {
   globals.define("clock", std::make_shared<ClockCallable>());
+  globals.define("spawn", std::make_shared<SpawnCallable>());
+  globals.define("await", std::make_shared<AwaitCallable>());
+  globals.define("parallel_for", std::make_shared<ParallelForCallable>());
+  globals.define("worker", std::make_shared<WorkerCallable>());
+  globals.define("channel", std::make_shared<ChannelCallable>());
+  globals.define("send", std::make_shared<SendCallable>());
+  globals.define("recv", std::make_shared<RecvCallable>());
+  globals.define("close", std::make_shared<CloseCallable>());
+  globals.define("fiber", std::make_shared<FiberCallable>());
+  globals.define("sleep", std::make_shared<SleepCallable>());
+  globals.define("yield_now", std::make_shared<YieldNowCallable>());
+  globals.define("readFile", std::make_shared<ReadFileCallable>());
+  globals.define("writeFile", std::make_shared<WriteFileCallable>());
+  globals.define("readLines", std::make_shared<ReadLinesCallable>());
+  globals.define("eachLine", std::make_shared<EachLineCallable>());
+  globals.define("eachCsv", std::make_shared<EachCsvCallable>());
+  globals.define("fieldCount", std::make_shared<FieldCountCallable>());
+  globals.define("fieldNumber", std::make_shared<FieldNumberCallable>());
+}
+
+/**
+ * @brief Runs the fibers the interpreter started and waits for the tasks it spawned,
+ *        which run code it owns.
+ */
+Interpreter::~Interpreter()
+{
+  joinFibers();
+  Task::join(*this);
+}
+
+/**
+ * @brief Returns the scheduler that runs the interpreter's fibers, creating it on first use.
+ * 
+ * @return The scheduler.
+ */
+Scheduler& Interpreter::scheduler()
+{
+  if (_scheduler == nullptr)
+    _scheduler = std::make_unique<Scheduler>(*this);
+  return *_scheduler;
+}
+
+/**
+ * @brief Runs the fibers the interpreter started until all of them have finished.
+ */
+void Interpreter::joinFibers()
+{
+  if (_scheduler != nullptr)
+    _scheduler->joinAll();
+}
+
+/**
+ * @brief Starts a new quantum, switching to another fiber first if one is ready to run.
+ */
+void Interpreter::preempt()
+{
+  _ticks = quantum;
+  if (_scheduler != nullptr)
+    _scheduler->yield();
 }
 
 /**
@@ -26,7 +95,7 @@ void Interpreter::interpret(const std::vector<std::shared_ptr<Stmt<LiteralValue>
   }
   catch (const RuntimeError& error)
   {
-    Lox::runtimeError(error);
+    _reporter.runtimeError(error);
   }
 }
 
@@ -38,8 +107,12 @@ void Interpreter::interpret(const std::vector<std::shared_ptr<Stmt<LiteralValue>
  */
 LiteralValue Interpreter::visitBinaryExpr(const Expr<LiteralValue>::Binary& expr)
 {
-  LiteralValue left = evaluate(expr.left);
-  LiteralValue right = evaluate(expr.right);
+  LiteralValue left, right;
+  if (_parallel_depth == 0 || !forkOperands(expr, left, right))
+  {
+    left = evaluate(expr.left);
+    right = evaluate(expr.right);
+  }
 
   switch (expr.oper.type)
   {
@@ -99,23 +172,18 @@ LiteralValue Interpreter::visitBinaryExpr(const Expr<LiteralValue>::Binary& expr
  */
 LiteralValue Interpreter::visitCallExpr(const Expr<LiteralValue>::Call& expr)
 {
-  LiteralValue callee = evaluate(expr.callee);
-
   std::vector<LiteralValue> arguments;
-  for (auto argument : expr.arguments)
-    arguments.push_back(evaluate(argument));
-
-  if (!std::holds_alternative<std::shared_ptr<LoxCallable>>(callee))
-    throw RuntimeError(expr.paren, "Can only call functions and classes.");
+  std::shared_ptr<LoxCallable> function = resolveCall(expr, arguments);
+  tick();
 
-  std::shared_ptr<LoxCallable> function = std::get<std::shared_ptr<LoxCallable>>(callee);
-
-  if (arguments.size() != function->arity())
-    throw RuntimeError(expr.paren, "Expected " + 
-      std::to_string(function->arity()) + " arguments, but got " +
-      std::to_string(arguments.size()) + ".");
-
-  return function->call(*this, arguments);
+  try
+  {
+    return function->call(*this, arguments);
+  }
+  catch (const NativeError& error)
+  {
+    throw RuntimeError(expr.paren, error.what());
+  }
 }
 
 /**
@@ -208,7 +276,7 @@ LiteralValue Interpreter::visitTernaryExpr(const Expr<LiteralValue>::Ternary& ex
  */
 LiteralValue Interpreter::visitVariableExpr(const Expr<LiteralValue>::Variable& expr)
 {
-  return environment.get(expr.name);
+  return variable(expr.name);
 }
 
 /**
@@ -222,22 +290,87 @@ LiteralValue Interpreter::visitVariableExpr(const Expr<LiteralValue>::Variable&
 LiteralValue Interpreter::visitAssignExpr(const Expr<LiteralValue>::Assign& expr)
 {
   LiteralValue value = evaluate(expr.value);
-  environment.assign(expr.name, value);
+  variable(expr.name) = value;
 
   return value;
 }
 
+/**
+ * @brief Visits a compound assignment, increment or decrement and updates the variable in place.
+ * 
+ * @param expr The update expression to evaluate.
+ * @return The value of the variable before the update for postfix forms, otherwise after it.
+ */
+LiteralValue Interpreter::visitUpdateExpr(const Expr<LiteralValue>::Update& expr)
+{
+  LiteralValue value = std::monostate();
+  if (expr.value != nullptr)
+    value = evaluate(expr.value);
+
+  LiteralValue& target = variable(expr.name);
+  LiteralValue previous = expr.postfix ? target : LiteralValue();
+
+  switch (expr.oper.type)
+  {
+    case PLUS_EQUAL:
+      if (std::holds_alternative<std::string>(target) && std::holds_alternative<std::string>(value))
+      {
+        std::get<std::string>(target) += std::get<std::string>(value);
+        break;
+      }
+      if (std::holds_alternative<double>(target) && std::holds_alternative<double>(value))
+      {
+        std::get<double>(target) += std::get<double>(value);
+        break;
+      }
+
+      throw RuntimeError(expr.oper, "Operands must be two numbers or two strings.");
+
+    case PLUS_PLUS:
+      checkNumberOperand(expr.oper, target);
+      std::get<double>(target) += 1;
+      break;
+
+    case MINUS_MINUS:
+      checkNumberOperand(expr.oper, target);
+      std::get<double>(target) -= 1;
+      break;
+
+    case MINUS_EQUAL:
+      checkNumberOperands(expr.oper, target, value);
+      std::get<double>(target) -= std::get<double>(value);
+      break;
+
+    case STAR_EQUAL:
+      checkNumberOperands(expr.oper, target, value);
+      std::get<double>(target) *= std::get<double>(value);
+      break;
+
+    case SLASH_EQUAL:
+      checkNumberOperands(expr.oper, target, value);
+      std::get<double>(target) /= std::get<double>(value);
+      break;
+
+    default:
+      break;
+  }
+
+  return expr.postfix ? previous : target;
+}
+
 /**
  * @brief Visits a block statement and executes all statements in the block.
  * 
  * Executes a block of statements in a new environment that is a child of the current environment.
+ * The top-level variables are always looked up first, so the child links to the enclosing
+ * scopes rather than to a copy of the top level.
  * 
  * @param stmt The block statement to execute.
  * @return A `std::monostate` indicating that a statement does not return a value.
  */
 LiteralValue Interpreter::visitBlockStmt(const Stmt<LiteralValue>::Block& stmt)
 {
-  executeBlock(stmt.statements, Environment(std::make_shared<Environment>(environment)));  
+  executeBlock(stmt.statements, Environment(environment.enclosing()));
   return std::monostate();
 }
 
@@ -262,7 +395,7 @@ LiteralValue Interpreter::visitExpressionStmt(const Stmt<LiteralValue>::Expressi
 LiteralValue Interpreter::visitFunctionStmt(const Stmt<LiteralValue>::Function& stmt)
 {
   LoxFunction function(stmt, environment);
-  environment.define(stmt.name.lexeme, std::make_shared<LoxFunction>(function));
+  environment.define(stmt.name.lexeme(), std::make_shared<LoxFunction>(function));
 
   return std::monostate();
 }
@@ -292,7 +425,7 @@ LiteralValue Interpreter::visitIfStmt(const Stmt<LiteralValue>::If& stmt)
 LiteralValue Interpreter::visitPrintStmt(const Stmt<LiteralValue>::Print& stmt)
 {
   LiteralValue value = evaluate(stmt.expression);
-  std::cout << stringify(value) << std::endl;
+  _out << stringify(value) << std::endl;
   return std::monostate();
 }
 
@@ -325,7 +458,7 @@ LiteralValue Interpreter::visitVarStmt(const Stmt<LiteralValue>::Var& stmt)
   if (stmt.initializer != nullptr)
     value = evaluate(stmt.initializer);
 
-  environment.define(stmt.name.lexeme, value);
+  environment.define(stmt.name.lexeme(), value);
   return std::monostate();
 }
 
@@ -339,6 +472,7 @@ LiteralValue Interpreter::visitWhileStmt(const Stmt<LiteralValue>::While& stmt)
 {
   while (isTruthy(evaluate(stmt.condition)))
   {
+    tick();
     try
     {
       execute(stmt.body);  
@@ -355,6 +489,84 @@ LiteralValue Interpreter::visitWhileStmt(const Stmt<LiteralValue>::While& stmt)
   return std::monostate();
 }
 
+/**
+ * @brief Evaluates a range-based counted for loop, or a loop over a generator.
+ * 
+ * @param stmt The for statement to be evaluated.
+ * @return A `std::monostate` indicating that the for statement does not return a value.
+ * @throws RuntimeError If the bounds or step are not numbers, or the step is zero, or
+ *         the loop is over something that cannot be iterated.
+ */
+LiteralValue Interpreter::visitForStmt(const Stmt<LiteralValue>::For& stmt)
+{
+  if (stmt.stop == nullptr)
+  {
+    const LiteralValue iterable = evaluate(stmt.start);
+
+    Environment scope(environment.enclosing());
+    scope.define(stmt.name.lexeme(), std::monostate());
+    EnvironmentGuard guard(environment, scope);
+    // Taken from the loop's own scope, since a lookup would find a top-level variable of the same name first.
+    LiteralValue& variable = *environment.enclosing()->find(stmt.name.lexeme());
+
+    while (Generator::next(*this, iterable, stmt.name, variable))
+    {
+      tick();
+      try
+      {
+        execute(stmt.body);
+      }
+      catch (const Continue&)
+      {
+        continue;
+      }
+      catch (const Break&)
+      {
+        break;
+      }
+    }
+    return std::monostate();
+  }
+
+  const Range values = range(stmt);
+
+  Environment scope(environment.enclosing());
+  scope.define(stmt.name.lexeme(), values.first);
+  EnvironmentGuard guard(environment, scope);
+  LiteralValue& variable = *environment.enclosing()->find(stmt.name.lexeme());
+
+  for (double counter = values.first; values.contains(counter); counter += values.step)
+  {
+    variable = counter;
+    tick();
+    try
+    {
+      execute(stmt.body);
+    }
+    catch (const Continue&)
+    {
+      continue;
+    }
+    catch (const Break&)
+    {
+      break;
+    }
+  }
+  return std::monostate();
+}
+
+/**
+ * @brief Rejects a `yield` outside of a function.
+ * 
+ * @param stmt The yield statement.
+ * @return Never returns.
+ * @throws RuntimeError Always.
+ */
+LiteralValue Interpreter::visitYieldStmt(const Stmt<LiteralValue>::Yield& stmt)
+{
+  throw RuntimeError(stmt.keyword, "Can't yield outside of a function.");
+}
+
 /**
  * @brief Executes a jump statement, such as `break` or `continue`.
  *
@@ -378,15 +590,164 @@ LiteralValue Interpreter::visitJumpStmt(const Stmt<LiteralValue>::Jump& stmt)
  * Executes a sequence of statements within a new environment, which is a child of the current environment.
  * 
  * @param statements The statements to execute.
- * @param environment The environment to use for executing the block.
+ * @param environment The environment to use for executing the block, moved in rather than copied.
  */
-void Interpreter::executeBlock(const std::vector<std::shared_ptr<const Stmt<LiteralValue>>>& statements, const Environment& environment)
+void Interpreter::executeBlock(const std::vector<std::shared_ptr<const Stmt<LiteralValue>>>& statements, Environment environment)
 {
-  EnvironmentGuard guard(this->environment, environment);
+  EnvironmentGuard guard(this->environment, std::move(environment));
   for (const std::shared_ptr<const Stmt<LiteralValue>> statement : statements)
     execute(statement);
 }
 
+/**
+ * @brief Returns the statements of a function's body that contain a `yield`, finding
+ *        them on the first call.
+ * 
+ * @param declaration The function declaration.
+ * @return The statements, none if the function is not a generator.
+ */
+const std::unordered_set<const Stmt<LiteralValue>*>& Interpreter::yielding(const Stmt<LiteralValue>::Function& declaration)
+{
+  auto found = _yielding.find(&declaration);
+  if (found == _yielding.end())
+    found = _yielding.emplace(&declaration, Generator::analyze(declaration.body->statements(_reporter))).first;
+  return found->second;
+}
+
+/**
+ * @brief Locates a variable, in the environment first and then among the natives in
+ *        the globals, so that a script's own declarations shadow the natives.
+ * 
+ * @param name The token representing the variable name.
+ * @return A reference to the value of the variable.
+ * @throws RuntimeError if the variable is defined in neither.
+ */
+LiteralValue& Interpreter::variable(const Token& name)
+{
+  LiteralValue* value = environment.find(name.lexeme());
+  if (value == nullptr) value = globals.find(name.lexeme());
+  if (value != nullptr) return *value;
+
+  throw RuntimeError(name, "Undefined variable '" + std::string(name.lexeme()) + "'.");
+}
+
+/**
+ * @brief Evaluates the bounds and step of a range loop.
+ * 
+ * @param stmt The range loop.
+ * @return The values the loop takes.
+ * @throws RuntimeError If the bounds or step are not numbers, or the step is zero.
+ */
+Interpreter::Range Interpreter::range(const Stmt<LiteralValue>::For& stmt)
+{
+  LiteralValue start = evaluate(stmt.start);
+  LiteralValue stop = evaluate(stmt.stop);
+  LiteralValue step = 1.0;
+  if (stmt.step != nullptr)
+    step = evaluate(stmt.step);
+
+  if (!std::holds_alternative<double>(start) || !std::holds_alternative<double>(stop) ||
+      !std::holds_alternative<double>(step))
+    throw RuntimeError(stmt.name, "Range bounds and step must be numbers.");
+
+  if (std::get<double>(step) == 0)
+    throw RuntimeError(stmt.name, "Range step can't be zero.");
+
+  return { std::get<double>(start), std::get<double>(stop), std::get<double>(step) };
+}
+
+/**
+ * @brief Evaluates the callee and arguments of a call, and checks that they match.
+ * 
+ * @param expr The call expression.
+ * @param arguments Receives the evaluated arguments.
+ * @return The function to call.
+ * @throws RuntimeError If the callee is not a function or class, or if the argument count is incorrect.
+ */
+std::shared_ptr<LoxCallable> Interpreter::resolveCall(const Expr<LiteralValue>::Call& expr, std::vector<LiteralValue>& arguments)
+{
+  LiteralValue callee = evaluate(expr.callee);
+
+  for (auto argument : expr.arguments)
+    arguments.push_back(evaluate(argument));
+
+  if (!std::holds_alternative<std::shared_ptr<LoxCallable>>(callee))
+    throw RuntimeError(expr.paren, "Can only call functions and classes.");
+
+  std::shared_ptr<LoxCallable> function = std::get<std::shared_ptr<LoxCallable>>(callee);
+
+  try
+  {
+    function->checkArity(arguments.size());
+  }
+  catch (const NativeError& error)
+  {
+    throw RuntimeError(expr.paren, error.what());
+  }
+
+  return function;
+}
+
+/**
+ * @brief Evaluates the operands of a binary expression in parallel, if they are pure calls
+ *        and the fork depth allows it.
+ * 
+ * The right call is spawned as a task, with one less fork allowed within it, and the
+ * left one is evaluated meanwhile under the same limit. Being pure, the calls give
+ * the same values and errors as they would one after the other: if the callee or
+ * arguments of the right call fail, the left operand is evaluated before that error
+ * is thrown. The proof of purity is checked again whenever a callee has been rebound.
+ * 
+ * @param expr The binary expression.
+ * @param left Receives the value of the left operand.
+ * @param right Receives the value of the right operand.
+ * @return False if the operands are left to be evaluated in order.
+ */
+bool Interpreter::forkOperands(const Expr<LiteralValue>::Binary& expr, LiteralValue& left, LiteralValue& right)
+{
+  auto right_call = dynamic_cast<const Expr<LiteralValue>::Call*>(expr.right.get());
+  if (right_call == nullptr || dynamic_cast<const Expr<LiteralValue>::Call*>(expr.left.get()) == nullptr)
+    return false;
+
+  auto forkable = _forkable.find(&expr);
+  if (forkable == _forkable.end())
+    forkable = _forkable.emplace(&expr, Purity::prove(expr, *this)).first;
+  else if (!Purity::holds(forkable->second, *this))
+    forkable->second = Purity::prove(expr, *this);
+  if (!forkable->second.pure) return false;
+
+  std::vector<LiteralValue> arguments;
+  std::shared_ptr<LoxCallable> function;
+  try
+  {
+    function = resolveCall(*right_call, arguments);
+  }
+  catch (...)
+  {
+    // In order, the left operand runs first, and its error is the one reported.
+    left = evaluate(expr.left);
+    throw;
+  }
+
+  --_parallel_depth;
+  std::shared_ptr<Task> task;
+  try
+  {
+    task = Task::spawn(*this, function, std::move(arguments));
+    left = evaluate(expr.left);
+    right = task->await(*this);
+  }
+  catch (...)
+  {
+    ++_parallel_depth;
+    // In order, the right call would not have run after the left one failed.
+    if (task != nullptr) task->discard();
+    throw;
+  }
+  ++_parallel_depth;
+  return true;
+}
+
 /**
  * @brief Evaluates an expression.
  * 
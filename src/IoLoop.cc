@@ -0,0 +1,480 @@
+#include "IoLoop.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define CPPLOX_IO_URING 1
+#endif
+
+namespace
+{
+  constexpr size_t first_read = 4096; ///< The size of the buffer a file is first read into, doubled each time it fills.
+
+  /**
+   * @brief Runs an operation with blocking system calls.
+   */
+  void perform(IoLoop::Request& request)
+  {
+    const bool reading = request.kind == IoLoop::Request::Kind::READ;
+    request.fd = ::open(request.path.c_str(), reading ? O_RDONLY | O_CLOEXEC : O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (request.fd < 0)
+    {
+      request.error = errno;
+      return;
+    }
+
+    if (reading)
+    {
+      struct stat status;
+      request.data.resize(fstat(request.fd, &status) == 0 && status.st_size > 0 ? status.st_size + 1 : first_read);
+      for (;;)
+      {
+        if (request.done == request.data.size())
+          request.data.resize(request.data.size() * 2);
+        ssize_t count = ::read(request.fd, request.data.data() + request.done, request.data.size() - request.done);
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) request.error = errno;
+        if (count <= 0) break;
+        request.done += count;
+      }
+      request.data.resize(request.done);
+    }
+    else
+    {
+      while (request.done < request.data.size())
+      {
+        ssize_t count = ::write(request.fd, request.data.data() + request.done, request.data.size() - request.done);
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0)
+        {
+          request.error = errno;
+          break;
+        }
+        request.done += count;
+      }
+    }
+    ::close(request.fd);
+    request.fd = -1;
+  }
+
+  /**
+   * @brief Runs operations on a few threads of its own, with blocking system calls.
+   */
+  class Threads : public IoLoop
+  {
+  public:
+    static constexpr unsigned threads = 4; ///< The operations run at once.
+
+    /**
+     * @brief Starts the threads.
+     */
+    Threads()
+    {
+      for (unsigned i = 0; i < threads; ++i)
+        _threads.emplace_back(&Threads::work, this);
+    }
+
+    /**
+     * @brief Lets the threads finish the operations in flight, and joins them.
+     */
+    ~Threads() override
+    {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+      }
+      _queued.notify_all();
+      for (std::thread& thread : _threads)
+        thread.join();
+    }
+
+    const char* backend() const override { return "threads"; }
+
+    void submit(Request& request) override
+    {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _jobs.push_back(&request);
+      }
+      ++_in_flight;
+      _queued.notify_one();
+    }
+
+    void poll(std::vector<Request*>& completed) override
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      completed.insert(completed.end(), _done.begin(), _done.end());
+      _in_flight -= _done.size();
+      _done.clear();
+    }
+
+    void wait(const std::optional<Clock::time_point>& deadline) override
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      if (deadline)
+        _finished.wait_until(lock, *deadline, [this] { return !_done.empty(); });
+      else
+        _finished.wait(lock, [this] { return !_done.empty(); });
+    }
+
+  private:
+    std::vector<std::thread> _threads; ///< The threads running operations.
+    std::mutex _mutex; ///< Guards everything below.
+    std::condition_variable _queued; ///< Signalled when an operation is queued, or the loop is destroyed.
+    std::condition_variable _finished; ///< Signalled when an operation has completed.
+    std::deque<Request*> _jobs; ///< The operations not started yet.
+    std::vector<Request*> _done; ///< The operations completed and not handed back yet.
+    bool _stopping = false; ///< Set once the threads should exit, when no operations are left.
+
+    /**
+     * @brief Runs operations until the loop is destroyed.
+     */
+    void work()
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      for (;;)
+      {
+        _queued.wait(lock, [this] { return _stopping || !_jobs.empty(); });
+        if (_jobs.empty()) return;
+
+        Request* request = _jobs.front();
+        _jobs.pop_front();
+        lock.unlock();
+        perform(*request);
+        lock.lock();
+        _done.push_back(request);
+        _finished.notify_one();
+      }
+    }
+  };
+
+#ifdef CPPLOX_IO_URING
+  /**
+   * @brief Runs operations on an io_uring, set up and driven with raw system calls.
+   *
+   * Every operation is a chain of steps, each a submission of its own: open, then read
+   * until a read returns nothing, into a buffer twice as large each time it fills, or
+   * write until everything is written, then close. A read may come back short before
+   * the end of pipes, FIFOs and files like those in /proc, so only an empty one ends
+   * it. Closing is not waited for. Steps that do not fit on the rings wait in a
+   * backlog, so that completions never overflow.
+   */
+  class Uring : public IoLoop
+  {
+  public:
+    static constexpr unsigned entries = 256; ///< The size of the submission ring.
+
+    /**
+     * @brief Sets up a ring.
+     * @return The loop, or null if io_uring is unavailable or lacks what is needed.
+     */
+    static std::unique_ptr<Uring> open()
+    {
+      io_uring_params params;
+      std::memset(&params, 0, sizeof(params));
+      int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+      if (fd < 0) return nullptr;
+      if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_NODROP))
+      {
+        ::close(fd);
+        return nullptr;
+      }
+
+      std::unique_ptr<Uring> uring(new Uring(fd, params));
+      if (uring->_sqes == MAP_FAILED || uring->_sq_ring == MAP_FAILED || uring->_cq_ring == MAP_FAILED)
+        return nullptr;
+      return uring;
+    }
+
+    /**
+     * @brief Waits for the steps in flight, then tears the ring down.
+     */
+    ~Uring() override
+    {
+      if (_sq_ring != MAP_FAILED && _cq_ring != MAP_FAILED && _sqes != MAP_FAILED)
+      {
+        std::vector<Request*> completed;
+        while (_submitted != 0 || _queued != 0 || !_backlog.empty())
+        {
+          poll(completed);
+          if (_submitted != 0)
+            enter(1, nullptr);
+        }
+      }
+
+      if (_sqes != MAP_FAILED) munmap(_sqes, _sqes_size);
+      if (_cq_ring != MAP_FAILED && _cq_ring != _sq_ring) munmap(_cq_ring, _cq_ring_size);
+      if (_sq_ring != MAP_FAILED) munmap(_sq_ring, _sq_ring_size);
+      ::close(_fd);
+    }
+
+    const char* backend() const override { return "io_uring"; }
+
+    void submit(Request& request) override
+    {
+      ++_in_flight;
+      step(&request, -1);
+    }
+
+    void poll(std::vector<Request*>& completed) override
+    {
+      reap(completed);
+      while (!_backlog.empty() && room())
+      {
+        auto [request, fd] = _backlog.front();
+        _backlog.pop_front();
+        step(request, fd);
+      }
+      if (_queued != 0)
+        enter(0, nullptr);
+    }
+
+    void wait(const std::optional<Clock::time_point>& deadline) override
+    {
+      if (!deadline)
+      {
+        enter(1, nullptr);
+        return;
+      }
+
+      const auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(*deadline - Clock::now());
+      if (remaining.count() <= 0) return;
+      __kernel_timespec timeout;
+      timeout.tv_sec = remaining.count() / 1000000000;
+      timeout.tv_nsec = remaining.count() % 1000000000;
+      enter(1, &timeout);
+    }
+
+  private:
+    int _fd; ///< The ring.
+    void* _sq_ring; ///< The mapped submission ring.
+    size_t _sq_ring_size; ///< Its size.
+    void* _cq_ring; ///< The mapped completion ring, the same mapping as the submission ring if the kernel allows.
+    size_t _cq_ring_size; ///< Its size.
+    io_uring_sqe* _sqes; ///< The mapped submission entries.
+    size_t _sqes_size; ///< Their size.
+
+    unsigned* _sq_head; ///< Where the kernel consumes submissions.
+    unsigned* _sq_tail; ///< Where submissions are added.
+    unsigned _sq_mask; ///< Wraps submission indices.
+    unsigned _sq_entries; ///< The size of the submission ring.
+    unsigned* _sq_array; ///< The indices of the submitted entries.
+    unsigned* _cq_head; ///< Where completions are consumed.
+    unsigned* _cq_tail; ///< Where the kernel adds completions.
+    unsigned _cq_mask; ///< Wraps completion indices.
+    unsigned _cq_entries; ///< The size of the completion ring.
+    io_uring_cqe* _cqes; ///< The completions.
+
+    unsigned _queued = 0; ///< Steps on the submission ring not passed to the kernel yet.
+    unsigned _submitted = 0; ///< Steps on the ring or in the kernel, which will complete.
+    std::deque<std::pair<Request*, int>> _backlog; ///< Steps waiting for room: the next of a request, or closing a file.
+
+    /**
+     * @brief Maps the rings of a new io_uring.
+     */
+    Uring(const int& fd, const io_uring_params& params)
+      : _fd(fd)
+    {
+      _sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+      _cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+      if (params.features & IORING_FEAT_SINGLE_MMAP)
+        _sq_ring_size = _cq_ring_size = std::max(_sq_ring_size, _cq_ring_size);
+
+      _sq_ring = mmap(nullptr, _sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+      _cq_ring = params.features & IORING_FEAT_SINGLE_MMAP ? _sq_ring
+        : mmap(nullptr, _cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+      _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+      _sqes = static_cast<io_uring_sqe*>(
+        mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+      if (_sq_ring == MAP_FAILED || _cq_ring == MAP_FAILED || _sqes == MAP_FAILED) return;
+
+      char* sq = static_cast<char*>(_sq_ring);
+      _sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+      _sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+      _sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+      _sq_entries = params.sq_entries;
+      _sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+      char* cq = static_cast<char*>(_cq_ring);
+      _cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+      _cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+      _cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+      _cq_entries = params.cq_entries;
+      _cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    }
+
+    /**
+     * @brief Passes queued steps to the kernel, and waits for completions if asked to.
+     */
+    void enter(const unsigned& wait, __kernel_timespec* timeout)
+    {
+      io_uring_getevents_arg argument;
+      std::memset(&argument, 0, sizeof(argument));
+      argument.sigmask_sz = _NSIG / 8;
+      argument.ts = reinterpret_cast<uint64_t>(timeout);
+
+      unsigned flags = IORING_ENTER_EXT_ARG | (wait != 0 ? IORING_ENTER_GETEVENTS : 0);
+      long consumed = syscall(__NR_io_uring_enter, _fd, _queued, wait, flags, &argument, sizeof(argument));
+      // Interrupted and timed out waits consume nothing; the steps are passed on next time.
+      if (consumed > 0)
+        _queued -= std::min<unsigned>(_queued, static_cast<unsigned>(consumed));
+    }
+
+    /**
+     * @brief Checks whether another step fits on the rings.
+     */
+    bool room() const
+    {
+      const unsigned head = std::atomic_ref<unsigned>(*_sq_head).load(std::memory_order_acquire);
+      return *_sq_tail - head < _sq_entries && _submitted < _cq_entries;
+    }
+
+    /**
+     * @brief Queues the next step of a request, or closing a file if the request is null.
+     */
+    void step(Request* request, const int& fd)
+    {
+      if (!room())
+      {
+        _backlog.emplace_back(request, fd);
+        return;
+      }
+
+      const unsigned tail = *_sq_tail;
+      const unsigned index = tail & _sq_mask;
+      io_uring_sqe& sqe = _sqes[index];
+      std::memset(&sqe, 0, sizeof(sqe));
+      sqe.user_data = reinterpret_cast<uint64_t>(request);
+
+      if (request == nullptr)
+      {
+        sqe.opcode = IORING_OP_CLOSE;
+        sqe.fd = fd;
+      }
+      else if (request->fd < 0)
+      {
+        const bool reading = request->kind == Request::Kind::READ;
+        sqe.opcode = IORING_OP_OPENAT;
+        sqe.fd = AT_FDCWD;
+        sqe.addr = reinterpret_cast<uint64_t>(request->path.c_str());
+        sqe.open_flags = reading ? O_RDONLY | O_CLOEXEC : O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+        sqe.len = 0644;
+      }
+      else
+      {
+        sqe.opcode = request->kind == Request::Kind::READ ? IORING_OP_READ : IORING_OP_WRITE;
+        sqe.fd = request->fd;
+        sqe.addr = reinterpret_cast<uint64_t>(request->data.data() + request->done);
+        sqe.len = static_cast<unsigned>(std::min<size_t>(request->data.size() - request->done, 1u << 30));
+        // At the file position, since pipes and FIFOs have no offsets to read at.
+        sqe.off = static_cast<uint64_t>(-1);
+      }
+
+      _sq_array[index] = index;
+      std::atomic_ref<unsigned>(*_sq_tail).store(tail + 1, std::memory_order_release);
+      ++_queued;
+      ++_submitted;
+    }
+
+    /**
+     * @brief Hands a request back, and closes its file if it is open.
+     */
+    void complete(Request& request, std::vector<Request*>& completed)
+    {
+      if (request.fd >= 0)
+        step(nullptr, std::exchange(request.fd, -1));
+      --_in_flight;
+      completed.push_back(&request);
+    }
+
+    /**
+     * @brief Advances the requests whose steps have completed.
+     */
+    void reap(std::vector<Request*>& completed)
+    {
+      unsigned head = *_cq_head;
+      const unsigned tail = std::atomic_ref<unsigned>(*_cq_tail).load(std::memory_order_acquire);
+      for (; head != tail; ++head)
+      {
+        const io_uring_cqe& cqe = _cqes[head & _cq_mask];
+        Request* request = reinterpret_cast<Request*>(cqe.user_data);
+        const int result = cqe.res;
+        --_submitted;
+        if (request == nullptr) continue;
+
+        if (result < 0)
+        {
+          request->error = -result;
+          if (request->kind == Request::Kind::READ) request->data.clear();
+          complete(*request, completed);
+        }
+        else if (request->fd < 0)
+        {
+          request->fd = result;
+          if (request->kind == Request::Kind::READ)
+            request->data.resize(first_read);
+          if (request->kind == Request::Kind::WRITE && request->data.empty())
+            complete(*request, completed);
+          else
+            step(request, -1);
+        }
+        else if (request->kind == Request::Kind::READ)
+        {
+          request->done += result;
+          if (result == 0)
+          {
+            request->data.resize(request->done);
+            complete(*request, completed);
+          }
+          else
+          {
+            if (request->done == request->data.size())
+              request->data.resize(request->data.size() * 2);
+            step(request, -1);
+          }
+        }
+        else
+        {
+          request->done += result;
+          if (request->done < request->data.size())
+            step(request, -1);
+          else
+            complete(*request, completed);
+        }
+      }
+      std::atomic_ref<unsigned>(*_cq_head).store(head, std::memory_order_release);
+    }
+  };
+#endif
+}
+
+/**
+ * @brief Creates a loop backed by io_uring if possible, and by threads otherwise.
+ * @param uring Whether to try io_uring at all.
+ * @return The loop.
+ */
+std::unique_ptr<IoLoop> IoLoop::create(const bool& uring)
+{
+#ifdef CPPLOX_IO_URING
+  if (uring)
+    if (std::unique_ptr<IoLoop> loop = Uring::open())
+      return loop;
+#endif
+  return std::make_unique<Threads>();
+}
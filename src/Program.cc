@@ -0,0 +1,143 @@
+#include "Program.h"
+
+#include <sstream>
+
+#include "Parser.h"
+#include "Scanner.h"
+
+/**
+ * @brief Scans and parses a script.
+ * @param text The source code of the script.
+ * @return The compiled program.
+ * @throws CompileError if the script has syntax errors.
+ */
+std::shared_ptr<const Program> Program::compile(std::string text)
+{
+  return std::shared_ptr<const Program>(new Program(std::make_unique<const Source>(std::move(text))));
+}
+
+/**
+ * @brief Scans and parses a script file, mapping it into memory if possible.
+ * @param path The path of the script.
+ * @return The compiled program.
+ * @throws std::runtime_error if the file cannot be opened.
+ * @throws CompileError if the script has syntax errors.
+ */
+std::shared_ptr<const Program> Program::load(const std::string& path)
+{
+  std::unique_ptr<const Source> source = Source::load(path);
+  if (!source)
+    throw std::runtime_error("Error opening file: " + path);
+  return std::shared_ptr<const Program>(new Program(std::move(source)));
+}
+
+/**
+ * @brief Scans and parses a script.
+ * @param source The text of the script.
+ * @throws CompileError if the script has syntax errors.
+ */
+Program::Program(std::unique_ptr<const Source> source)
+  : _source(std::move(source))
+{
+  std::ostringstream errors;
+  Lox::Reporter reporter(errors);
+  Scanner scanner(*_source, reporter);
+  _statements = Parser<LiteralValue>(scanner, reporter).parse();
+
+  if (reporter.hadError())
+    throw CompileError(errors.str());
+}
+
+/**
+ * @brief Creates an interpreter and runs the program's top-level statements in it.
+ * @param program The program to run, retained by the context.
+ * @param out The stream `print` writes to.
+ * @param err The stream runtime errors of the top-level statements are reported to.
+ * @throws std::runtime_error if the top-level statements raise a runtime error.
+ */
+Context::Context(std::shared_ptr<const Program> program, std::ostream& out, std::ostream& err)
+  : _program(std::move(program)), _reporter(err), _interpreter(_reporter, out)
+{
+  _interpreter.interpret(_program->statements());
+  _interpreter.joinFibers();
+  if (_reporter.hadRuntimeError())
+    throw std::runtime_error("Runtime error while running the program.");
+}
+
+/**
+ * @brief Looks up a function among the globals.
+ * @param name The name of the function.
+ * @return The function, to be passed to `call`.
+ * @throws std::invalid_argument if there is no such global or it is not callable.
+ */
+Context::Function Context::function(std::string_view name) const
+{
+  const LiteralValue& value = global(name);
+  if (!std::holds_alternative<std::shared_ptr<LoxCallable>>(value))
+    throw std::invalid_argument("Global '" + std::string(name) + "' is not a function.");
+  return Function(std::get<std::shared_ptr<LoxCallable>>(value));
+}
+
+/**
+ * @brief Returns the value of a global.
+ * @param name The name of the global.
+ * @return The value.
+ * @throws std::invalid_argument if there is no such global.
+ */
+const LiteralValue& Context::global(std::string_view name) const
+{
+  // Top-level declarations are defined in the interpreter's environment, natives in its globals.
+  for (const Environment* environment : { &_interpreter.environment, &_interpreter.globals })
+  {
+    auto value = environment->values().find(name);
+    if (value != environment->values().end())
+      return value->second;
+  }
+  throw std::invalid_argument("Undefined global '" + std::string(name) + "'.");
+}
+
+/**
+ * @brief Checks the number of arguments a host passes to a function.
+ * @param function The function.
+ * @param count The number of arguments.
+ * @throws std::invalid_argument if the number does not match the function's arity.
+ */
+void Context::checkArity(const Function& function, const size_t& count)
+{
+  try
+  {
+    function._callable->checkArity(count);
+  }
+  catch (const NativeError& error)
+  {
+    throw std::invalid_argument(error.what());
+  }
+}
+
+/**
+ * @brief Calls a function with host values.
+ * @param function The function, looked up in this context.
+ * @param arguments The arguments, one per parameter.
+ * @return The value the function returned.
+ * @throws std::invalid_argument if the number of arguments does not match the function's arity.
+ * @throws RuntimeError if the function raises a runtime error.
+ */
+LiteralValue Context::call(const Function& function, const std::vector<LiteralValue>& arguments)
+{
+  checkArity(function, arguments.size());
+  return function._callable->call(_interpreter, arguments);
+}
+
+/**
+ * @brief Calls a function with host values, moving them into its parameters.
+ * @param function The function, looked up in this context.
+ * @param arguments The arguments, one per parameter, moved from.
+ * @return The value the function returned.
+ * @throws std::invalid_argument if the number of arguments does not match the function's arity.
+ * @throws RuntimeError if the function raises a runtime error.
+ */
+LiteralValue Context::call(const Function& function, std::vector<LiteralValue>&& arguments)
+{
+  checkArity(function, arguments.size());
+  return function._callable->callOwned(_interpreter, std::move(arguments));
+}
@@ -0,0 +1,171 @@
+#include "Purity.h"
+
+#include <unordered_set>
+
+#include "Interpreter.h"
+#include "LoxFunction.h"
+#include "Stmt.h"
+
+namespace Purity
+{
+  namespace
+  {
+    /**
+     * @brief Returns the function a top-level variable holds.
+     * @return The function, or null if the variable is undefined or holds anything else.
+     */
+    std::shared_ptr<LoxCallable> callee(const Interpreter& interpreter, std::string_view name)
+    {
+      const auto& top_level = interpreter.environment.values();
+      auto value = top_level.find(name);
+      if (value == top_level.end() || !std::holds_alternative<std::shared_ptr<LoxCallable>>(value->second))
+        return nullptr;
+      return std::get<std::shared_ptr<LoxCallable>>(value->second);
+    }
+
+    /**
+     * @class Analyzer
+     * @brief Visits an expression, and the bodies of the functions it calls, looking
+     *        for anything with an effect. Every visit returns whether the node is pure.
+     */
+    class Analyzer : public Expr<LiteralValue>::Visitor, public Stmt<LiteralValue>::Visitor
+    {
+    public:
+      Analyzer(const Interpreter& interpreter, Proof& proof)
+        : _interpreter(interpreter), _proof(proof) {}
+
+      bool expr(const std::shared_ptr<const Expr<LiteralValue>>& expr)
+      {
+        return expr == nullptr || std::get<bool>(expr->accept(*this));
+      }
+
+      bool stmt(const std::shared_ptr<const Stmt<LiteralValue>>& stmt)
+      {
+        return stmt == nullptr || std::get<bool>(stmt->accept(*this));
+      }
+
+      bool stmts(const std::vector<std::shared_ptr<const Stmt<LiteralValue>>>& statements)
+      {
+        for (const auto& statement : statements)
+          if (!stmt(statement)) return false;
+        return true;
+      }
+
+      LiteralValue visitAssignExpr(const Expr<LiteralValue>::Assign&) override { return false; }
+      LiteralValue visitUpdateExpr(const Expr<LiteralValue>::Update&) override { return false; }
+      LiteralValue visitLiteralExpr(const Expr<LiteralValue>::Literal&) override { return true; }
+      LiteralValue visitVariableExpr(const Expr<LiteralValue>::Variable&) override { return true; }
+
+      LiteralValue visitBinaryExpr(const Expr<LiteralValue>::Binary& expr) override
+      {
+        return this->expr(expr.left) && this->expr(expr.right);
+      }
+
+      LiteralValue visitGroupingExpr(const Expr<LiteralValue>::Grouping& expr) override
+      {
+        return this->expr(expr.expression);
+      }
+
+      LiteralValue visitLogicalExpr(const Expr<LiteralValue>::Logical& expr) override
+      {
+        return this->expr(expr.left) && this->expr(expr.right);
+      }
+
+      LiteralValue visitUnaryExpr(const Expr<LiteralValue>::Unary& expr) override
+      {
+        return this->expr(expr.right);
+      }
+
+      LiteralValue visitTernaryExpr(const Expr<LiteralValue>::Ternary& expr) override
+      {
+        return this->expr(expr.condition) && this->expr(expr.then_branch) && this->expr(expr.else_branch);
+      }
+
+      LiteralValue visitCallExpr(const Expr<LiteralValue>::Call& expr) override
+      {
+        for (const auto& argument : expr.arguments)
+          if (!this->expr(argument)) return false;
+
+        auto callee = std::dynamic_pointer_cast<const Expr<LiteralValue>::Variable>(expr.callee);
+        if (callee == nullptr) return false;
+
+        std::shared_ptr<LoxCallable> found = Purity::callee(_interpreter, callee->name.lexeme());
+        _proof.callees.emplace_back(std::string(callee->name.lexeme()), found);
+
+        auto function = std::dynamic_pointer_cast<LoxFunction>(found);
+        if (function == nullptr) return false;
+
+        // Recursive calls are assumed pure while the body they are in is being checked.
+        const Stmt<LiteralValue>::Function& declaration = function->declaration();
+        if (!_visiting.insert(&declaration).second) return true;
+        bool pure = declaration.body->parsed() && stmts(declaration.body->statements());
+        _visiting.erase(&declaration);
+        return pure;
+      }
+
+      LiteralValue visitBlockStmt(const Stmt<LiteralValue>::Block& stmt) override
+      {
+        return stmts(stmt.statements);
+      }
+
+      LiteralValue visitExpressionStmt(const Stmt<LiteralValue>::Expression& stmt) override
+      {
+        return expr(stmt.expression);
+      }
+
+      LiteralValue visitIfStmt(const Stmt<LiteralValue>::If& stmt) override
+      {
+        return expr(stmt.condition) && this->stmt(stmt.then_branch) && this->stmt(stmt.else_branch);
+      }
+
+      LiteralValue visitReturnStmt(const Stmt<LiteralValue>::Return& stmt) override
+      {
+        return expr(stmt.value);
+      }
+
+      LiteralValue visitWhileStmt(const Stmt<LiteralValue>::While& stmt) override
+      {
+        return expr(stmt.condition) && this->stmt(stmt.body);
+      }
+
+      LiteralValue visitJumpStmt(const Stmt<LiteralValue>::Jump&) override { return true; }
+      LiteralValue visitFunctionStmt(const Stmt<LiteralValue>::Function&) override { return false; }
+      LiteralValue visitPrintStmt(const Stmt<LiteralValue>::Print&) override { return false; }
+      LiteralValue visitVarStmt(const Stmt<LiteralValue>::Var&) override { return false; }
+      LiteralValue visitForStmt(const Stmt<LiteralValue>::For&) override { return false; }
+      LiteralValue visitYieldStmt(const Stmt<LiteralValue>::Yield&) override { return false; }
+
+    private:
+      const Interpreter& _interpreter; ///< Whose top-level variables callees are looked up in.
+      Proof& _proof; ///< Records the callees looked up.
+      std::unordered_set<const Stmt<LiteralValue>::Function*> _visiting; ///< The functions being checked.
+    };
+  }
+
+  /**
+   * @brief Checks whether an expression is pure.
+   * @param expr The expression.
+   * @param interpreter The interpreter that would evaluate it.
+   * @return The proof.
+   */
+  Proof prove(const Expr<LiteralValue>& expr, const Interpreter& interpreter)
+  {
+    Proof proof;
+    Analyzer analyzer(interpreter, proof);
+    proof.pure = std::get<bool>(expr.accept(analyzer));
+    return proof;
+  }
+
+  /**
+   * @brief Checks whether a proof still holds.
+   * @param proof The proof.
+   * @param interpreter The interpreter the proof was made for.
+   * @return True if every callee is unchanged.
+   */
+  bool holds(const Proof& proof, const Interpreter& interpreter)
+  {
+    for (const auto& [name, function] : proof.callees)
+      if (callee(interpreter, name) != function) return false;
+    return true;
+  }
+}
@@ -0,0 +1,295 @@
+#include "RecordCallables.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ScanKernels.h"
+
+/**
+ * @brief A file mapped read-only into memory, unmapped when destroyed.
+ */
+class MappedFile
+{
+public:
+  /**
+   * @brief Maps a whole file.
+   * @param path The file.
+   * @throws NativeError if the file cannot be opened or mapped.
+   */
+  MappedFile(const std::string& path)
+  {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat status;
+    if (fd < 0 || fstat(fd, &status) != 0)
+      fail(path, fd);
+
+    // Mapping nothing fails, and there is nothing to scan in an empty file anyway.
+    _size = static_cast<size_t>(status.st_size);
+    if (_size != 0)
+    {
+      void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED)
+        fail(path, fd);
+      _data = static_cast<const char*>(data);
+      // Doubles the kernel's read-ahead, and lets it drop pages once they are behind.
+      madvise(data, _size, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+  }
+
+  /**
+   * @brief Unmaps the file.
+   */
+  ~MappedFile()
+  {
+    if (_data != nullptr)
+      munmap(const_cast<char*>(_data), _size);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  /**
+   * @brief Returns the contents of the file.
+   * @return A view of the mapping.
+   */
+  std::string_view text() const { return { _data, _size }; }
+
+private:
+  const char* _data = nullptr; ///< The mapping, null for an empty file.
+  size_t _size = 0; ///< The size of the file.
+
+  /**
+   * @brief Closes the file, and throws the error the last system call failed with.
+   */
+  [[noreturn]] static void fail(const std::string& path, const int& fd)
+  {
+    const int error = errno;
+    if (fd >= 0) ::close(fd);
+    throw NativeError("Could not map file '" + path + "': " + std::strerror(error) + ".");
+  }
+};
+
+namespace
+{
+  /**
+   * @brief Returns the record an argument holds.
+   * @throws NativeError if it holds anything else.
+   */
+  const LoxRecord& record(const LiteralValue& argument)
+  {
+    const LoxRecord* record = nullptr;
+    if (std::holds_alternative<std::shared_ptr<LoxCallable>>(argument))
+      record = dynamic_cast<const LoxRecord*>(std::get<std::shared_ptr<LoxCallable>>(argument).get());
+    if (record == nullptr)
+      throw NativeError("Expected a record.");
+    return *record;
+  }
+
+  /**
+   * @brief Splits off the line starting at an offset, as a record of one field.
+   * @return The offset of the next line.
+   */
+  size_t splitLine(std::string_view text, const size_t& from, std::vector<LoxRecord::Field>& fields)
+  {
+    const size_t end = ScanKernels::find(text, from, '\n');
+    const size_t stop = end > from && text[end - 1] == '\r' ? end - 1 : end;
+    fields.clear();
+    fields.push_back({ text.substr(from, stop - from) });
+    return end + 1;
+  }
+
+  /**
+   * @brief Splits off the CSV record starting at an offset into its fields.
+   *
+   * Each field takes one vectorized search for the comma, quote or newline ending it.
+   * Quotes inside a field that does not start with one are kept, characters between
+   * the closing quote of a field and the next comma are dropped, and a quote left open
+   * runs to the end of the file.
+   * @return The offset of the next record.
+   */
+  size_t splitCsv(std::string_view text, const size_t& from, std::vector<LoxRecord::Field>& fields)
+  {
+    fields.clear();
+    for (size_t start = from;; )
+    {
+      size_t position;
+      if (start < text.size() && text[start] == '"')
+      {
+        bool escaped = false;
+        size_t close = ScanKernels::find(text, start + 1, '"');
+        while (close + 1 < text.size() && text[close + 1] == '"')
+        {
+          escaped = true;
+          close = ScanKernels::find(text, close + 2, '"');
+        }
+        fields.push_back({ text.substr(start + 1, close - start - 1), escaped });
+        position = ScanKernels::findDelimiter(text, close + 1, ',');
+        while (position < text.size() && text[position] == '"')
+          position = ScanKernels::findDelimiter(text, position + 1, ',');
+      }
+      else
+      {
+        position = ScanKernels::findDelimiter(text, start, ',');
+        while (position < text.size() && text[position] == '"')
+          position = ScanKernels::findDelimiter(text, position + 1, ',');
+        const size_t stop = position > start && text[position - 1] == '\r' &&
+          (position == text.size() || text[position] == '\n') ? position - 1 : position;
+        fields.push_back({ text.substr(start, stop - start) });
+      }
+
+      if (position >= text.size() || text[position] == '\n') return position + 1;
+      start = position + 1;
+    }
+  }
+
+  /**
+   * @brief Maps a file and calls a function with each of its records, until it returns false.
+   * @param split Splits off the record at an offset into its fields, and returns the
+   *        offset of the next one.
+   * @return The number of records passed.
+   */
+  template <typename Split>
+  LiteralValue stream(Interpreter& interpreter, const std::vector<LiteralValue>& arguments, Split split)
+  {
+    if (!std::holds_alternative<std::string>(arguments[0]))
+      throw NativeError("Path must be a string.");
+    std::shared_ptr<LoxCallable> function;
+    if (std::holds_alternative<std::shared_ptr<LoxCallable>>(arguments[1]))
+      function = std::get<std::shared_ptr<LoxCallable>>(arguments[1]);
+    if (function == nullptr || (function->variadic() ? function->arity() > 1 : function->arity() != 1))
+      throw NativeError("Expected a function of one argument.");
+
+    const std::shared_ptr<const MappedFile> file = std::make_shared<const MappedFile>(std::get<std::string>(arguments[0]));
+    const std::string_view text = file->text();
+    std::shared_ptr<LoxRecord> record = std::make_shared<LoxRecord>(file);
+    std::vector<LiteralValue> argument{ std::shared_ptr<LoxCallable>(record) };
+
+    size_t count = 0;
+    for (size_t position = 0; position < text.size();)
+    {
+      position = split(text, position, record->fields());
+      ++count;
+      const LiteralValue result = function->call(interpreter, argument);
+
+      // Besides `record` and `argument`, something the function left behind holds the
+      // record, so it keeps its fields and the next records get a new one.
+      if (record.use_count() > 2)
+      {
+        record = std::make_shared<LoxRecord>(file);
+        argument[0] = std::shared_ptr<LoxCallable>(record);
+      }
+      if (std::holds_alternative<bool>(result) && !std::get<bool>(result)) break;
+    }
+    return static_cast<double>(count);
+  }
+}
+
+/**
+ * @brief Returns the field at an index argument.
+ * @param index The index, from 0.
+ * @return The field, or null if the record has no field at that index.
+ * @throws NativeError if the index is not a number.
+ */
+const LoxRecord::Field* LoxRecord::field(const LiteralValue& index) const
+{
+  if (!std::holds_alternative<double>(index))
+    throw NativeError("Field index must be a number.");
+
+  const double i = std::get<double>(index);
+  if (!(i >= 0) || i >= static_cast<double>(_fields.size()) || i != std::floor(i)) return nullptr;
+  return &_fields[static_cast<size_t>(i)];
+}
+
+/**
+ * @brief Copies a field out of the file.
+ *
+ * @param interpreter The interpreter reading the field (unused).
+ * @param arguments The index of the field, from 0.
+ * @return The field as a string, or nil if the record has no field at that index.
+ * @throws NativeError if the index is not a number.
+ */
+LiteralValue LoxRecord::call(Interpreter&, const std::vector<LiteralValue>& arguments)
+{
+  const Field* found = field(arguments[0]);
+  if (found == nullptr) return std::monostate();
+  if (!found->escaped) return std::string(found->text);
+
+  std::string text;
+  text.reserve(found->text.size());
+  for (size_t i = 0; i < found->text.size(); ++i)
+  {
+    text += found->text[i];
+    if (found->text[i] == '"') ++i;
+  }
+  return text;
+}
+
+/**
+ * @brief Calls the function with every line, until it returns false.
+ *
+ * @param interpreter The interpreter calling the function.
+ * @param arguments The path of the file and the function.
+ * @return The number of lines passed.
+ * @throws NativeError if the arguments are not a path and a function of one
+ *         argument, or the file cannot be mapped.
+ */
+LiteralValue EachLineCallable::call(Interpreter& interpreter, const std::vector<LiteralValue>& arguments)
+{
+  return stream(interpreter, arguments, &splitLine);
+}
+
+/**
+ * @brief Calls the function with every record, until it returns false.
+ *
+ * @param interpreter The interpreter calling the function.
+ * @param arguments The path of the file and the function.
+ * @return The number of records passed.
+ * @throws NativeError if the arguments are not a path and a function of one
+ *         argument, or the file cannot be mapped.
+ */
+LiteralValue EachCsvCallable::call(Interpreter& interpreter, const std::vector<LiteralValue>& arguments)
+{
+  return stream(interpreter, arguments, &splitCsv);
+}
+
+/**
+ * @brief Counts the fields of a record.
+ *
+ * @param interpreter The interpreter counting (unused).
+ * @param arguments The record.
+ * @return The number of fields.
+ * @throws NativeError if the argument is not a record.
+ */
+LiteralValue FieldCountCallable::call(Interpreter&, const std::vector<LiteralValue>& arguments)
+{
+  return static_cast<double>(record(arguments[0]).size());
+}
+
+/**
+ * @brief Parses a field as a number.
+ *
+ * @param interpreter The interpreter parsing (unused).
+ * @param arguments The record and the index of the field, from 0.
+ * @return The number, or nil if there is no such field or it is not a number.
+ * @throws NativeError if the arguments are not a record and a number.
+ */
+LiteralValue FieldNumberCallable::call(Interpreter&, const std::vector<LiteralValue>& arguments)
+{
+  const LoxRecord::Field* field = record(arguments[0]).field(arguments[1]);
+  if (field == nullptr) return std::monostate();
+
+  const std::string_view text = field->text;
+  double value;
+  const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+  if (error != std::errc() || end != text.data() + text.size() || text.empty()) return std::monostate();
+  return value;
+}
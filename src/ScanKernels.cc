@@ -0,0 +1,304 @@
+#include "ScanKernels.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace ScanKernels
+{
+  namespace
+  {
+    /// Signature shared by the implementations of every helper.
+    using Kernel = const char* (*)(const char* begin, const char* end, char c);
+
+    /**
+     * @brief The implementations the helpers currently dispatch to.
+     */
+    struct Dispatch
+    {
+      Level level;
+      Kernel skip_whitespace;
+      Kernel skip_identifier;
+      Kernel find;
+      Kernel find_delimiter;
+    };
+
+    bool isWhitespace(const char& c)
+    {
+      return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    bool isIdentifier(const char& c)
+    {
+      return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+    }
+
+    const char* scalarSkipWhitespace(const char* begin, const char* end, char)
+    {
+      while (begin < end && isWhitespace(*begin)) ++begin;
+      return begin;
+    }
+
+    const char* scalarSkipIdentifier(const char* begin, const char* end, char)
+    {
+      while (begin < end && isIdentifier(*begin)) ++begin;
+      return begin;
+    }
+
+    const char* scalarFind(const char* begin, const char* end, char c)
+    {
+      while (begin < end && *begin != c) ++begin;
+      return begin;
+    }
+
+    const char* scalarFindDelimiter(const char* begin, const char* end, char separator)
+    {
+      while (begin < end && *begin != separator && *begin != '"' && *begin != '\n') ++begin;
+      return begin;
+    }
+
+#if defined(__x86_64__)
+    // Each vector kernel builds a mask with one bit per byte that is set where the run
+    // ends, returns at the lowest set bit, and leaves the tail shorter than a vector
+    // to the scalar kernel.
+
+    const char* sse2SkipWhitespace(const char* begin, const char* end, char)
+    {
+      for (; end - begin >= 16; begin += 16)
+      {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        __m128i space = _mm_or_si128(
+          _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t'))),
+          _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'))));
+
+        unsigned mask = ~_mm_movemask_epi8(space) & 0xFFFF;
+        if (mask != 0) return begin + __builtin_ctz(mask);
+      }
+      return scalarSkipWhitespace(begin, end, '\0');
+    }
+
+    const char* sse2SkipIdentifier(const char* begin, const char* end, char)
+    {
+      for (; end - begin >= 16; begin += 16)
+      {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        // Setting bit 5 folds upper case letters onto lower case ones.
+        __m128i lower = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+        __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                      _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('0' - 1)),
+                                      _mm_cmplt_epi8(chunk, _mm_set1_epi8('9' + 1)));
+        __m128i identifier = _mm_or_si128(_mm_or_si128(alpha, digit), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_')));
+
+        unsigned mask = ~_mm_movemask_epi8(identifier) & 0xFFFF;
+        if (mask != 0) return begin + __builtin_ctz(mask);
+      }
+      return scalarSkipIdentifier(begin, end, '\0');
+    }
+
+    const char* sse2Find(const char* begin, const char* end, char c)
+    {
+      __m128i target = _mm_set1_epi8(c);
+      for (; end - begin >= 16; begin += 16)
+      {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, target));
+        if (mask != 0) return begin + __builtin_ctz(mask);
+      }
+      return scalarFind(begin, end, c);
+    }
+
+    const char* sse2FindDelimiter(const char* begin, const char* end, char separator)
+    {
+      __m128i target = _mm_set1_epi8(separator);
+      for (; end - begin >= 16; begin += 16)
+      {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        __m128i delimiter = _mm_or_si128(
+          _mm_cmpeq_epi8(chunk, target),
+          _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'))));
+
+        unsigned mask = _mm_movemask_epi8(delimiter);
+        if (mask != 0) return begin + __builtin_ctz(mask);
+      }
+      return scalarFindDelimiter(begin, end, separator);
+    }
+
+    __attribute__((target("avx2")))
+    const char* avx2SkipWhitespace(const char* begin, const char* end, char)
+    {
+      for (; end - begin >= 32; begin += 32)
+      {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+        __m256i space = _mm256_or_si256(
+          _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t'))),
+          _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n'))));
+
+        unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(space));
+        if (mask != 0) return begin + __builtin_ctz(mask);
+      }
+      return sse2SkipWhitespace(begin, end, '\0');
+    }
+
+    __attribute__((target("avx2")))
+    const char* avx2SkipIdentifier(const char* begin, const char* end, char)
+    {
+      for (; end - begin >= 32; begin += 32)
+      {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+        // Setting bit 5 folds upper case letters onto lower case ones.
+        __m256i lower = _mm256_or_si256(chunk, _mm256_set1_epi8(0x20));
+        __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+        __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(chunk, _mm256_set1_epi8('0' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), chunk));
+        __m256i identifier = _mm256_or_si256(_mm256_or_si256(alpha, digit),
+                                             _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('_')));
+
+        unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(identifier));
+        if (mask != 0) return begin + __builtin_ctz(mask);
+      }
+      return sse2SkipIdentifier(begin, end, '\0');
+    }
+
+    __attribute__((target("avx2")))
+    const char* avx2Find(const char* begin, const char* end, char c)
+    {
+      __m256i target = _mm256_set1_epi8(c);
+      for (; end - begin >= 32; begin += 32)
+      {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+        unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, target));
+        if (mask != 0) return begin + __builtin_ctz(mask);
+      }
+      return sse2Find(begin, end, c);
+    }
+
+    __attribute__((target("avx2")))
+    const char* avx2FindDelimiter(const char* begin, const char* end, char separator)
+    {
+      __m256i target = _mm256_set1_epi8(separator);
+      for (; end - begin >= 32; begin += 32)
+      {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+        __m256i delimiter = _mm256_or_si256(
+          _mm256_cmpeq_epi8(chunk, target),
+          _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n'))));
+
+        unsigned mask = _mm256_movemask_epi8(delimiter);
+        if (mask != 0) return begin + __builtin_ctz(mask);
+      }
+      return sse2FindDelimiter(begin, end, separator);
+    }
+#endif
+
+    /**
+     * @brief Returns the implementations for the given level.
+     */
+    Dispatch dispatchFor(const Level& level)
+    {
+#if defined(__x86_64__)
+      if (level == AVX2) return { AVX2, avx2SkipWhitespace, avx2SkipIdentifier, avx2Find, avx2FindDelimiter };
+      if (level == SSE2) return { SSE2, sse2SkipWhitespace, sse2SkipIdentifier, sse2Find, sse2FindDelimiter };
+#endif
+      return { SCALAR, scalarSkipWhitespace, scalarSkipIdentifier, scalarFind, scalarFindDelimiter };
+    }
+
+    /**
+     * @brief Returns the current dispatch table, selecting the best level on first use.
+     */
+    Dispatch& dispatch()
+    {
+      static Dispatch table = dispatchFor(supported());
+      return table;
+    }
+
+    /**
+     * @brief Runs a kernel over the text starting at the given offset.
+     */
+    size_t run(const Kernel& kernel, std::string_view text, const size_t& from, const char& c)
+    {
+      if (from >= text.size()) return text.size();
+      return kernel(text.data() + from, text.data() + text.size(), c) - text.data();
+    }
+  }
+
+  /**
+   * @brief Returns the fastest level supported by the CPU.
+   * @return The best supported level.
+   */
+  Level supported()
+  {
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx2")) return AVX2;
+    return SSE2; // Always available on x86-64.
+#else
+    return SCALAR;
+#endif
+  }
+
+  /**
+   * @brief Returns the level the helpers currently dispatch to.
+   * @return The selected level.
+   */
+  Level selected()
+  {
+    return dispatch().level;
+  }
+
+  /**
+   * @brief Overrides the level the helpers dispatch to.
+   * @param level The level to use, which must not be above `supported()`.
+   */
+  void select(const Level& level)
+  {
+    dispatch() = dispatchFor(level);
+  }
+
+  /**
+   * @brief Skips a run of spaces, tabs, carriage returns and newlines.
+   * @param text The text to search.
+   * @param from The offset to start at.
+   * @return The offset of the first non-whitespace character, or the size of the text.
+   */
+  size_t skipWhitespace(std::string_view text, const size_t& from)
+  {
+    return run(dispatch().skip_whitespace, text, from, '\0');
+  }
+
+  /**
+   * @brief Skips a run of identifier characters (letters, digits and underscores).
+   * @param text The text to search.
+   * @param from The offset to start at.
+   * @return The offset of the first non-identifier character, or the size of the text.
+   */
+  size_t skipIdentifier(std::string_view text, const size_t& from)
+  {
+    return run(dispatch().skip_identifier, text, from, '\0');
+  }
+
+  /**
+   * @brief Finds the next occurrence of a character.
+   * @param text The text to search.
+   * @param from The offset to start at.
+   * @param c The character to find.
+   * @return The offset of the character, or the size of the text if it does not occur.
+   */
+  size_t find(std::string_view text, const size_t& from, const char& c)
+  {
+    return run(dispatch().find, text, from, c);
+  }
+
+  /**
+   * @brief Finds the next separator, double quote or newline, which end a field of
+   *        delimited records such as CSV.
+   * @param text The text to search.
+   * @param from The offset to start at.
+   * @param separator The character separating fields.
+   * @return The offset of the delimiter, or the size of the text if there is none.
+   */
+  size_t findDelimiter(std::string_view text, const size_t& from, const char& separator)
+  {
+    return run(dispatch().find_delimiter, text, from, separator);
+  }
+}
@@ -1,125 +1,394 @@
 #include "Scanner.h"
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <thread>
+
+#include "ScanKernels.h"
+
+namespace
+{
+  /**
+   * @enum CharClass
+   * @brief The kind of lexeme a character starts, i.e. the state the lexer moves to after reading it.
+   */
+  enum class CharClass : uint8_t
+  {
+    INVALID, /**< Cannot start a lexeme */
+    OPERATOR, /**< Punctuation, possibly extended by a second character */
+    SLASH, /**< A comment or a slash operator */
+    WHITESPACE, /**< Space, tab, carriage return or newline */
+    QUOTE, /**< The start of a string */
+    DIGIT, /**< The start of a number */
+    ALPHA /**< The start of an identifier or keyword */
+  };
+
+  /**
+   * @struct CharRule
+   * @brief Transitions out of the lexer's start state on a given character.
+   *
+   * An operator character produces `single`, unless it is followed by one of the
+   * `next` characters, in which case it produces the corresponding `doubled` type.
+   */
+  struct CharRule
+  {
+    CharClass kind = CharClass::INVALID;
+    TokenType single = END;
+    char next[2] = { '\0', '\0' };
+    TokenType doubled[2] = { END, END };
+  };
+
+  /**
+   * @brief Builds the transition table of the lexer's start state at compile time.
+   * @return The rule for each of the 256 byte values.
+   */
+  constexpr std::array<CharRule, 256> makeCharRules()
+  {
+    std::array<CharRule, 256> rules{};
+    auto set = [&rules](const char& c, const CharRule& rule) { rules[static_cast<unsigned char>(c)] = rule; };
+    using enum CharClass;
+
+    set('(', { OPERATOR, LEFT_PAREN });
+    set(')', { OPERATOR, RIGHT_PAREN });
+    set('{', { OPERATOR, LEFT_BRACE });
+    set('}', { OPERATOR, RIGHT_BRACE });
+    set(',', { OPERATOR, COMMA });
+    set(';', { OPERATOR, SEMICOLON });
+    set(':', { OPERATOR, COLON });
+    set('?', { OPERATOR, QUESTION_MARK });
+    set('.', { OPERATOR, DOT, { '.' }, { DOT_DOT } });
+    set('-', { OPERATOR, MINUS, { '-', '=' }, { MINUS_MINUS, MINUS_EQUAL } });
+    set('+', { OPERATOR, PLUS, { '+', '=' }, { PLUS_PLUS, PLUS_EQUAL } });
+    set('*', { OPERATOR, STAR, { '=' }, { STAR_EQUAL } });
+    set('!', { OPERATOR, BANG, { '=' }, { BANG_EQUAL } });
+    set('=', { OPERATOR, EQUAL, { '=' }, { EQUAL_EQUAL } });
+    set('<', { OPERATOR, LESS, { '=' }, { LESS_EQUAL } });
+    set('>', { OPERATOR, GREATER, { '=' }, { GREATER_EQUAL } });
+    set('/', { CharClass::SLASH, TokenType::SLASH, { '=' }, { SLASH_EQUAL } });
+
+    for (char c : { ' ', '\r', '\t', '\n' }) set(c, { WHITESPACE });
+    set('"', { QUOTE });
+    for (char c = '0'; c <= '9'; ++c) set(c, { DIGIT });
+    for (char c = 'a'; c <= 'z'; ++c) set(c, { ALPHA });
+    for (char c = 'A'; c <= 'Z'; ++c) set(c, { ALPHA });
+    set('_', { ALPHA });
+
+    return rules;
+  }
+
+  /// Transition table of the lexer's start state, indexed by byte value.
+  constexpr std::array<CharRule, 256> CHAR_RULES = makeCharRules();
+
+  /**
+   * @brief Classifies an identifier as a keyword or a plain identifier.
+   *
+   * Switches on the length and first character, so a lexeme is compared against
+   * at most one keyword and nothing is hashed or allocated.
+   *
+   * @param text The identifier lexeme.
+   * @return The keyword's token type, or IDENTIFIER.
+   */
+  constexpr TokenType keywordType(std::string_view text)
+  {
+    auto keyword = [&text](std::string_view word, const TokenType& type) { return text == word ? type : IDENTIFIER; };
+
+    switch (text.size())
+    {
+      case 2:
+        switch (text[0])
+        {
+          case 'i': return text[1] == 'f' ? IF : keyword("in", IN);
+          case 'o': return keyword("or", OR);
+        }
+        break;
+      case 3:
+        switch (text[0])
+        {
+          case 'a': return keyword("and", AND);
+          case 'f': return text[1] == 'o' ? keyword("for", FOR) : keyword("fun", FUN);
+          case 'n': return keyword("nil", NIL);
+          case 'v': return keyword("var", VAR);
+        }
+        break;
+      case 4:
+        switch (text[0])
+        {
+          case 'e': return keyword("else", ELSE);
+          case 't': return text[1] == 'h' ? keyword("this", THIS) : keyword("true", TRUE);
+        }
+        break;
+      case 5:
+        switch (text[0])
+        {
+          case 'b': return keyword("break", BREAK);
+          case 'c': return keyword("class", CLASS);
+          case 'f': return keyword("false", FALSE);
+          case 'p': return keyword("print", PRINT);
+          case 's': return keyword("super", SUPER);
+          case 'w': return keyword("while", WHILE);
+          case 'y': return keyword("yield", YIELD);
+        }
+        break;
+      case 6:
+        return keyword("return", RETURN);
+      case 8:
+        return keyword("continue", CONTINUE);
+    }
+    return IDENTIFIER;
+  }
+
+  static_assert(keywordType("if") == IF && keywordType("in") == IN && keywordType("it") == IDENTIFIER);
+  static_assert(keywordType("for") == FOR && keywordType("fun") == FUN && keywordType("fan") == IDENTIFIER);
+  static_assert(keywordType("this") == THIS && keywordType("true") == TRUE && keywordType("tree") == IDENTIFIER);
+  static_assert(keywordType("continue") == CONTINUE && keywordType("continues") == IDENTIFIER);
+}
+
 /**
  * @brief Constructor for Scanner class.
- * @param source The source code to be scanned.
+ * @param source The source code to be scanned, which must outlive the scanned tokens.
+ * @param reporter Where to report the errors found.
+ * @param from The offset to start scanning at.
+ */
+Scanner::Scanner(const Source& source, Lox::Reporter& reporter, const size_t& from):
+  _source(source),
+  _text(source.text()),
+  _current(from),
+  _reporter(&reporter) {}
+
+/**
+ * @brief Constructs a Scanner starting part way into the source, collecting its errors
+ *        instead of reporting them.
+ * @param source The source code to scan.
+ * @param from The offset to start scanning at.
+ * @param errors Where to collect the errors found.
  */
-Scanner::Scanner(const std::string& source):
+Scanner::Scanner(const Source& source, const size_t& from, std::vector<ScanError>& errors):
   _source(source),
-  _keywords({
-    {"and", AND},
-    {"class", CLASS},
-    {"else", ELSE},
-    {"false", FALSE},
-    {"for", FOR},
-    {"fun", FUN},
-    {"if", IF},
-    {"nil", NIL},
-    {"or", OR},
-    {"print", PRINT},
-    {"return", RETURN},
-    {"super", SUPER},
-    {"this", THIS},
-    {"true", TRUE},
-    {"var", VAR},
-    {"while", WHILE},
-    {"break", BREAK},
-    {"continue", CONTINUE}
-  }) {}
+  _text(source.text()),
+  _current(from),
+  _errors(&errors) {}
 
 /**
  * @brief Scans the source code and returns a vector of tokens.
  * @return A vector containing all the tokens found in the source code.
  */
 std::vector<Token> Scanner::scanTokens()
+{
+  std::vector<Token> tokens;
+  do
+    tokens.push_back(nextToken());
+  while (tokens.back().type != END);
+
+  return tokens;
+}
+
+/**
+ * @brief Scans the source code on several threads and returns a vector of tokens.
+ * @param jobs The maximum number of threads to scan with.
+ * @return A vector containing all the tokens found in the source code.
+ */
+std::vector<Token> Scanner::scanTokens(const unsigned& jobs)
+{
+  const size_t chunk_count = std::min<size_t>(jobs, (_text.size() - _current) / MIN_CHUNK_SIZE);
+  if (chunk_count <= 1) return scanTokens();
+
+  // Split the rest of the source into chunks starting at line starts.
+  std::vector<size_t> bounds = { _current };
+  for (size_t i = 1; i < chunk_count; ++i)
+  {
+    size_t bound = ScanKernels::find(_text, _current + (_text.size() - _current) * i / chunk_count, '\n') + 1;
+    if (bound > bounds.back() && bound < _text.size()) bounds.push_back(bound);
+  }
+  bounds.push_back(_text.size());
+
+  // Scan every chunk speculatively, the first one on this thread.
+  std::vector<Chunk> chunks(bounds.size() - 1);
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < chunks.size(); ++i)
+    workers.emplace_back([this, &bounds, &chunks, i] { scanChunk(bounds[i], bounds[i + 1], chunks[i]); });
+  scanChunk(bounds[0], bounds[1], chunks[0]);
+  for (std::thread& worker : workers)
+    worker.join();
+
+  std::vector<Token> tokens = std::move(chunks[0].tokens);
+  std::vector<ScanError> errors = std::move(chunks[0].errors);
+  size_t position = chunks[0].exit;
+  for (size_t i = 1; i < chunks.size(); ++i)
+  {
+    Chunk& chunk = chunks[i];
+
+    // A lexeme from an earlier chunk may cover this one entirely.
+    if (position >= bounds[i + 1]) continue;
+
+    // Tokens are only valid from the first one the true scan also starts a lexeme at.
+    size_t first = 0;
+    size_t synced = bounds[i];
+    if (position != bounds[i])
+    {
+      Scanner repair(_source, position, errors);
+      first = chunk.tokens.size();
+      while (repair._current < bounds[i + 1] && !repair.isAtEnd())
+      {
+        std::optional<Token> token = repair.scanLexeme();
+        if (!token.has_value()) continue;
+
+        auto match = std::lower_bound(chunk.tokens.begin(), chunk.tokens.end(), token->offset,
+                                      [](const Token& speculative, const uint32_t& offset) { return speculative.offset < offset; });
+        if (match != chunk.tokens.end() && match->offset == token->offset)
+        {
+          first = match - chunk.tokens.begin();
+          synced = match->offset;
+          break;
+        }
+        tokens.push_back(*token);
+      }
+
+      // The scans never lined up: the repair scanned the whole chunk.
+      if (first == chunk.tokens.size())
+      {
+        position = repair._current;
+        continue;
+      }
+    }
+
+    tokens.insert(tokens.end(), chunk.tokens.begin() + first, chunk.tokens.end());
+    for (ScanError& error : chunk.errors)
+      if (error.start >= synced) errors.push_back(std::move(error));
+    position = chunk.exit;
+  }
+
+  for (ScanError& error : errors)
+  {
+    if (_errors != nullptr)
+      _errors->push_back(std::move(error));
+    else
+      _reporter->error(_source.line(error.offset), error.message);
+  }
+
+  _current = _text.size();
+  tokens.emplace_back(END, _current, 0, _source);
+  return tokens;
+}
+
+/**
+ * @brief Scans the lexemes starting in the given range as if the range began outside
+ *        of any lexeme.
+ *
+ * The last lexeme may run past the end of the range.
+ *
+ * @param from The offset the range starts at.
+ * @param to The offset the range ends at.
+ * @param chunk The chunk to record the tokens and errors in.
+ */
+void Scanner::scanChunk(const size_t& from, const size_t& to, Chunk& chunk) const
+{
+  Scanner scanner(_source, from, chunk.errors);
+  while (scanner._current < to && !scanner.isAtEnd())
+    if (std::optional<Token> token = scanner.scanLexeme())
+      chunk.tokens.push_back(*token);
+
+  chunk.exit = scanner._current;
+}
+
+/**
+ * @brief Scans and returns the next token.
+ * @return The next token, or an END token once the source is exhausted.
+ */
+Token Scanner::nextToken()
 {
   while (!isAtEnd())
   {
-    // We are at the beginning of the next lexeme.
-    _start = _current;
-    scanToken();
+    // Whitespace, comments and errors do not produce a token.
+    if (std::optional<Token> token = scanLexeme())
+      return *token;
   }
 
-  _tokens.emplace_back(END, "", std::monostate(), _line);
-  return _tokens;
+  return Token(END, _current, 0, _source);
 }
 
 /**
- * @brief Scans the next token from the source code.
+ * @brief Scans the next lexeme from the source code.
+ * @return The token it produced, if any.
+ */
+std::optional<Token> Scanner::scanLexeme()
+{
+  // We are at the beginning of the next lexeme.
+  _start = _current;
+  scanToken();
+
+  std::optional<Token> token = _token;
+  _token.reset();
+  return token;
+}
+
+/**
+ * @brief Scans the next lexeme from the source code, producing at most one token.
+ *
+ * The first character selects a transition from the `CHAR_RULES` table; operators
+ * are resolved entirely from the table, other lexemes by their dedicated scanners.
  */
 void Scanner::scanToken()
 {
-  char c = advance();
-  switch(c)
+  const CharRule& rule = CHAR_RULES[static_cast<unsigned char>(advance())];
+  switch (rule.kind)
   {
-    case '(': addToken(LEFT_PAREN); break;
-    case ')': addToken(RIGHT_PAREN); break;
-    case '{': addToken(LEFT_BRACE); break;
-    case '}': addToken(RIGHT_BRACE); break;
-    case ',': addToken(COMMA); break;
-    case '.': addToken(DOT); break;
-    case '-': addToken(MINUS); break;
-    case '+': addToken(PLUS); break;
-    case ';': addToken(SEMICOLON); break;
-    case '*': addToken(STAR); break;
-    case ':': addToken(COLON); break;
-    case '?': addToken(QUESTION_MARK); break;
-    case '!':
-      addToken(match('=') ? BANG_EQUAL : BANG);
-      break;
-    case '=':
-      addToken(match('=') ? EQUAL_EQUAL : EQUAL);
-      break;
-    case '<':
-      addToken(match('=') ? LESS_EQUAL : LESS);
-      break;
-    case '>':
-      addToken(match('=') ? GREATER_EQUAL : GREATER);
-      break;
-    case '/':
+    case CharClass::SLASH:
       if (match('/'))
-        while (peek() != '\n' && !isAtEnd()) advance();
-      else if (match('*'))
+      {
+        _current = ScanKernels::find(_text, _current, '\n');
+        break;
+      }
+      if (match('*'))
+      {
         blockComment();
-      else
-        addToken(SLASH);
-      break;
-    case ' ':
-    case '\r':
-    case '\t':
-      // Ignore whitespace.
+        break;
+      }
+      [[fallthrough]];
+    case CharClass::OPERATOR:
+    {
+      TokenType type = rule.single;
+      for (int i = 0; i < 2 && rule.next[i] != '\0'; ++i)
+        if (match(rule.next[i]))
+        {
+          type = rule.doubled[i];
+          break;
+        }
+      addToken(type);
       break;
-    case '\n':
-      ++_line;
+    }
+    case CharClass::WHITESPACE:
+      // Ignore whitespace, skipping the rest of the run at once.
+      _current = ScanKernels::skipWhitespace(_text, _current);
       break;
-    case '"': string(); break;
+    case CharClass::QUOTE: string(); break;
+    case CharClass::DIGIT: number(); break;
+    case CharClass::ALPHA: identifier(); break;
     default:
-      if (isDigit(c)) number();
-      else if (isAlpha(c)) identifier();
-      else Lox::error(_line, "Unexpected character.");
-    
+      error("Unexpected character.");
       break;
   }
 }
 
 /**
- * @brief Adds a token of the given type to the tokens vector.
+ * @brief Records a token of the given type as the one produced by the current lexeme.
  * @param type The type of the token to be added.
  */
 void Scanner::addToken(const TokenType& type)
 {
-  addToken(type, std::monostate());
+  _token.emplace(type, _start, _current - _start, _source);
 }
 
 /**
- * @brief Adds a token of the given type and literal value to the tokens vector.
- * @param type The type of the token to be added.
- * @param literal The literal value of the token.
+ * @brief Reports an error at the current position, or collects it when scanning speculatively.
+ * @param message The error message.
  */
-void Scanner::addToken(const TokenType& type, const LiteralValue& literal)
+void Scanner::error(const std::string& message)
 {
-  std::string text = _source.substr(_start, _current - _start);
-  _tokens.emplace_back(type, text, literal, _line);
+  if (_errors != nullptr)
+    _errors->push_back({ _start, _current, message });
+  else
+    _reporter->error(_source.line(_current), message);
 }
 
 /**
@@ -128,7 +397,7 @@ void Scanner::addToken(const TokenType& type, const LiteralValue& literal)
  */
 bool Scanner::isAtEnd()
 {
-  return _current >= _source.length();
+  return _current >= _text.length();
 }
 
 /**
@@ -138,29 +407,7 @@ bool Scanner::isAtEnd()
  */
 bool Scanner::isDigit(const char& c)
 {
-  return (c >= '0' && c <= '9');
-}
-
-/**
- * @brief Checks if the given character is an alphabetic character.
- * @param c The character to check.
- * @return True if the character is alphabetic, false otherwise.
- */
-bool Scanner::isAlpha(const char& c)
-{
-  return (c >= 'a' && c <= 'z') ||
-         (c >= 'A' && c <= 'Z') ||
-          c == '_';
-}
-
-/**
- * @brief Checks if the given character is an alphanumeric character.
- * @param c The character to check.
- * @return True if the character is alphanumeric, false otherwise.
- */
-bool Scanner::isAlphaNumeric(const char& c)
-{
-  return isAlpha(c) || isDigit(c);
+  return CHAR_RULES[static_cast<unsigned char>(c)].kind == CharClass::DIGIT;
 }
 
 /**
@@ -178,7 +425,7 @@ void Scanner::number()
     while (isDigit(peek())) advance();
   }
 
-  addToken(NUMBER, std::stod(_source.substr(_start, _current - _start)));
+  addToken(NUMBER);
 }
 
 /**
@@ -186,22 +433,16 @@ void Scanner::number()
  */
 void Scanner::string()
 {
-  while (peek() != '"' && !isAtEnd())
-  {
-    if (peek() == '\n') _line++;
-    advance();
-  }
+  _current = ScanKernels::find(_text, _current, '"');
 
   if (isAtEnd())
   {
-    Lox::error(_line, "Unterminated string.");
+    error("Unterminated string.");
     return;
   }
 
   advance();
-
-  std::string value = _source.substr(_start + 1, _current - _start - 2);
-  addToken(STRING, value);
+  addToken(STRING);
 }
 
 /**
@@ -209,19 +450,9 @@ void Scanner::string()
  */
 void Scanner::identifier()
 {
-  while (isAlphaNumeric(peek()))
-    advance();
- 
-  std::string text = _source.substr(_start, _current - _start);
+  _current = ScanKernels::skipIdentifier(_text, _current);
 
-  TokenType type;
-  auto it = _keywords.find(text);
-  if (it == _keywords.end())
-    type = IDENTIFIER;
-  else
-    type = it->second;
-  
-  addToken(type);
+  addToken(keywordType(_text.substr(_start, _current - _start)));
 }
 
 /**
@@ -231,23 +462,16 @@ void Scanner::blockComment()
 {
   while (true)
   {
+    _current = ScanKernels::find(_text, _current, '*');
     if (isAtEnd())
     {
-      Lox::error(_line, "Undetermined block comment.");
+      error("Undetermined block comment.");
       return;
     }
 
-    if (peek() == '*' && peekNext() == '/')
-    {
-      advance(); // consume the '*'
-      advance(); // consume the '/'
+    advance(); // consume the '*'
+    if (match('/'))
       break;
-    }
-
-    if (peek() == '\n')
-      ++_line;
-
-    advance();
   }
 }
 
@@ -257,7 +481,7 @@ void Scanner::blockComment()
  */
 char Scanner::advance()
 {
-  return _source.at(_current++);
+  return _text[_current++];
 }
 
 /**
@@ -267,7 +491,7 @@ char Scanner::advance()
  */
 bool Scanner::match(const char& expected)
 {
-  if (isAtEnd() || _source.at(_current) != expected) return false; 
+  if (isAtEnd() || _text[_current] != expected) return false; 
 
   _current++;
   return true;
@@ -280,7 +504,7 @@ bool Scanner::match(const char& expected)
 char Scanner::peek()
 {
   if (isAtEnd()) return '\0';
-  return _source.at(_current);
+  return _text[_current];
 }
 
 /**
@@ -289,6 +513,6 @@ char Scanner::peek()
  */
 char Scanner::peekNext()
 {
-  if (_current + 1 >= _source.length()) return '\0';
-  return _source.at(_current + 1);
+  if (_current + 1 >= _text.length()) return '\0';
+  return _text[_current + 1];
 }
\ No newline at end of file
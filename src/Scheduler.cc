@@ -0,0 +1,527 @@
+#include "Scheduler.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <utility>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if !defined(__x86_64__) || defined(CPPLOX_UCONTEXT_FIBERS)
+#include <ucontext.h>
+#endif
+
+#if defined(__SANITIZE_ADDRESS__)
+#define CPPLOX_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define CPPLOX_ASAN 1
+#endif
+#endif
+
+#ifdef CPPLOX_ASAN
+#include <sanitizer/asan_interface.h>
+#include <sanitizer/common_interface_defs.h>
+#endif
+
+namespace
+{
+#if defined(__x86_64__) && !defined(CPPLOX_UCONTEXT_FIBERS)
+  extern "C" void cpplox_fiber_switch(void** from, void* to);
+  extern "C" void cpplox_fiber_enter();
+
+  // Saves the callee-saved registers and the SSE and x87 control words on the stack,
+  // stores the stack pointer in `*from`, and loads the same from the stack at `to`.
+  // `cpplox_fiber_enter` is where new stacks return to, and calls the entry in r13
+  // with the argument in r12; it is marked as the outermost frame for debuggers.
+  asm(R"(
+    .pushsection .text
+    .globl cpplox_fiber_switch
+    .hidden cpplox_fiber_switch
+    .type cpplox_fiber_switch, @function
+  cpplox_fiber_switch:
+    pushq %rbp
+    pushq %rbx
+    pushq %r12
+    pushq %r13
+    pushq %r14
+    pushq %r15
+    subq $8, %rsp
+    stmxcsr (%rsp)
+    fnstcw 4(%rsp)
+    movq %rsp, (%rdi)
+    movq %rsi, %rsp
+    ldmxcsr (%rsp)
+    fldcw 4(%rsp)
+    addq $8, %rsp
+    popq %r15
+    popq %r14
+    popq %r13
+    popq %r12
+    popq %rbx
+    popq %rbp
+    ret
+    .size cpplox_fiber_switch, .-cpplox_fiber_switch
+
+    .globl cpplox_fiber_enter
+    .hidden cpplox_fiber_enter
+    .type cpplox_fiber_enter, @function
+  cpplox_fiber_enter:
+    .cfi_startproc
+    .cfi_undefined rip
+    movq %r12, %rdi
+    callq *%r13
+    ud2
+    .cfi_endproc
+    .size cpplox_fiber_enter, .-cpplox_fiber_enter
+    .popsection
+  )");
+
+  /**
+   * @brief Returns the context of the thread's own stack, which needs no storage.
+   */
+  void* threadContext() { return nullptr; }
+
+  /**
+   * @brief Releases the context `threadContext` returned.
+   */
+  void releaseThreadContext(void*) {}
+
+  /**
+   * @brief Lays out a stack so that switching to it calls `entry(argument)`.
+   * @return The context to switch to.
+   */
+  void* prepare(void* stack, void (*entry)(void*), void* argument)
+  {
+    const uintptr_t top = (reinterpret_cast<uintptr_t>(stack) + Scheduler::stack_size) & ~uintptr_t(15);
+    // What `cpplox_fiber_switch` pops, leaving the stack 16-byte aligned for the call.
+    void** frame = reinterpret_cast<void**>(top - 80);
+    const uint32_t mxcsr = 0x1F80;
+    const uint16_t fpucw = 0x037F;
+    std::memcpy(frame, &mxcsr, sizeof(mxcsr));
+    std::memcpy(reinterpret_cast<char*>(frame) + 4, &fpucw, sizeof(fpucw));
+    frame[1] = frame[2] = frame[5] = frame[6] = nullptr; // r15, r14, rbx, rbp
+    frame[3] = reinterpret_cast<void*>(entry); // r13
+    frame[4] = argument; // r12
+    frame[7] = reinterpret_cast<void*>(&cpplox_fiber_enter);
+    return frame;
+  }
+
+  /**
+   * @brief Saves the running context in `from`, and switches to `to`.
+   */
+  void jump(void*& from, void* to)
+  {
+    cpplox_fiber_switch(&from, to);
+  }
+#else
+  /**
+   * @brief Returns storage for the context of the thread's own stack.
+   */
+  void* threadContext() { return new ucontext_t(); }
+
+  /**
+   * @brief Releases the context `threadContext` returned.
+   */
+  void releaseThreadContext(void* context) { delete static_cast<ucontext_t*>(context); }
+
+  /**
+   * @brief Calls the entry of a new context, passed as halves of pointers.
+   */
+  void enter(unsigned entry_high, unsigned entry_low, unsigned argument_high, unsigned argument_low)
+  {
+    auto pointer = [](unsigned high, unsigned low) {
+      return (static_cast<uintptr_t>(high) << 16 << 16) | low;
+    };
+    reinterpret_cast<void (*)(void*)>(pointer(entry_high, entry_low))(reinterpret_cast<void*>(pointer(argument_high, argument_low)));
+  }
+
+  /**
+   * @brief Prepares a context at the top of a stack that calls `entry(argument)`.
+   * @return The context to switch to.
+   */
+  void* prepare(void* stack, void (*entry)(void*), void* argument)
+  {
+    const uintptr_t top = (reinterpret_cast<uintptr_t>(stack) + Scheduler::stack_size - sizeof(ucontext_t)) & ~uintptr_t(63);
+    ucontext_t* context = new (reinterpret_cast<void*>(top)) ucontext_t();
+    getcontext(context);
+    context->uc_stack.ss_sp = stack;
+    context->uc_stack.ss_size = top - reinterpret_cast<uintptr_t>(stack);
+    context->uc_link = nullptr;
+
+    const uintptr_t entry_bits = reinterpret_cast<uintptr_t>(entry);
+    const uintptr_t argument_bits = reinterpret_cast<uintptr_t>(argument);
+    makecontext(context, reinterpret_cast<void (*)()>(&enter), 4,
+                static_cast<unsigned>(entry_bits >> 16 >> 16), static_cast<unsigned>(entry_bits),
+                static_cast<unsigned>(argument_bits >> 16 >> 16), static_cast<unsigned>(argument_bits));
+    return context;
+  }
+
+  /**
+   * @brief Saves the running context in `from`, and switches to `to`.
+   */
+  void jump(void*& from, void* to)
+  {
+    swapcontext(static_cast<ucontext_t*>(from), static_cast<ucontext_t*>(to));
+  }
+#endif
+
+  /**
+   * @brief Reserves a stack with a guard page at its bottom.
+   * @throws NativeError if the address space is exhausted.
+   */
+  void* reserveStack()
+  {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+    flags |= MAP_NORESERVE;
+#endif
+#ifdef MAP_STACK
+    flags |= MAP_STACK;
+#endif
+    void* stack = mmap(nullptr, Scheduler::stack_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (stack == MAP_FAILED)
+      throw NativeError("Out of memory for fiber stacks.");
+    mprotect(stack, static_cast<size_t>(sysconf(_SC_PAGESIZE)), PROT_NONE);
+    return stack;
+  }
+}
+
+/**
+ * @brief Waits for the fiber to finish, running the other fibers meanwhile.
+ *
+ * @param interpreter The interpreter joining the fiber.
+ * @param arguments No arguments.
+ * @return The value the function returned, or nil if it stopped with a runtime error.
+ * @throws NativeError if the fiber belongs to another interpreter, or if joining it
+ *         would wait forever.
+ */
+LiteralValue Fiber::call(Interpreter& interpreter, const std::vector<LiteralValue>&)
+{
+  if (&interpreter.scheduler() != _scheduler)
+    throw NativeError("Fibers can only be joined by the interpreter that started them.");
+
+  _scheduler->join(*this);
+  if (_error)
+    std::rethrow_exception(_error);
+  return _result;
+}
+
+/**
+ * @brief Constructs a scheduler with the main fiber only.
+ * @param interpreter The interpreter whose fibers it runs.
+ */
+Scheduler::Scheduler(Interpreter& interpreter)
+  : _interpreter(interpreter), _main(*this, nullptr, {}), _running(&_main)
+{
+  _main._context.pointer = threadContext();
+}
+
+/**
+ * @brief Releases the stacks kept for reuse. Fibers that never finished are abandoned.
+ */
+Scheduler::~Scheduler()
+{
+  // Operations in flight write to requests on the stacks of unfinished fibers.
+  _io = nullptr;
+  releaseFinished();
+  for (const std::shared_ptr<Fiber>& fiber : _fibers)
+    _stacks.push_back(fiber->_context.stack);
+  for (void* stack : _stacks)
+    munmap(stack, stack_size);
+  releaseThreadContext(_main._context.pointer);
+}
+
+/**
+ * @brief Starts a fiber, which first runs once the running fiber gives way.
+ *
+ * @param function The function to call.
+ * @param arguments The arguments to pass to it.
+ * @return The fiber.
+ */
+std::shared_ptr<Fiber> Scheduler::start(std::shared_ptr<LoxCallable> function, std::vector<LiteralValue> arguments)
+{
+  void* stack;
+  if (!_stacks.empty())
+  {
+    stack = _stacks.back();
+    _stacks.pop_back();
+  }
+  else
+    stack = reserveStack();
+#ifdef CPPLOX_ASAN
+  // The frames of the last fiber that ran there, if any, were never popped.
+  __asan_unpoison_memory_region(stack, stack_size);
+#endif
+
+  std::shared_ptr<Fiber> fiber(new Fiber(*this, std::move(function), std::move(arguments)));
+  fiber->_context = { stack, prepare(stack, &Scheduler::run, this) };
+  fiber->_position = _fibers.insert(_fibers.end(), fiber);
+  _ready.push_back(fiber.get());
+  return fiber;
+}
+
+/**
+ * @brief Switches to the next fiber ready to run, if any, leaving the running one
+ *        ready to run again after it.
+ */
+void Scheduler::yield()
+{
+  collect();
+  if (!wake()) return;
+  _ready.push_back(_running);
+  block();
+}
+
+/**
+ * @brief Suspends the running fiber for the given time, running the others meanwhile.
+ * @param duration How long to sleep.
+ */
+void Scheduler::sleep(const Clock::duration& duration)
+{
+  if (_fibers.empty())
+  {
+    std::this_thread::sleep_for(duration);
+    return;
+  }
+  _sleepers.push({ Clock::now() + duration, _running });
+  block();
+}
+
+/**
+ * @brief Waits for a fiber to finish, running the others meanwhile.
+ *
+ * @param fiber The fiber.
+ * @throws NativeError if the fiber is the running one, or if every unfinished fiber
+ *         would be left waiting for another.
+ */
+void Scheduler::join(Fiber& fiber)
+{
+  if (&fiber == _running)
+    throw NativeError("A fiber can't join itself.");
+  if (fiber._finished) return;
+
+  Fiber& running = *_running;
+  fiber._joiners.push_back(&running);
+  running._joining = &fiber;
+  block();
+  running._joining = nullptr;
+
+  if (std::exchange(running._deadlocked, false))
+    throw NativeError("Every fiber is waiting for another.");
+}
+
+/**
+ * @brief Waits for every fiber started so far, and those they start, to finish.
+ *
+ * Must be called from the main fiber.
+ */
+void Scheduler::joinAll()
+{
+  // The main fiber is never the one failed on a deadlock, so this always finishes.
+  while (!_fibers.empty())
+    join(*_fibers.front());
+}
+
+/**
+ * @brief Runs a file operation, running the other fibers until it completes.
+ * @param request The operation, whose outcome it holds on return.
+ */
+void Scheduler::perform(IoLoop::Request& request)
+{
+  request.fiber = _running;
+  io().submit(request);
+  block();
+}
+
+/**
+ * @brief Returns the loop running file operations, creating it on first use, and
+ *        again in a process forked after it was created.
+ * @return The loop.
+ */
+IoLoop& Scheduler::io()
+{
+  // A forked child would share the parent's ring, or wait on threads it does not
+  // have. The loop is left to the parent rather than torn down, and never freed here.
+  if (_io != nullptr && _io_owner != getpid())
+    static_cast<void>(_io.release());
+  if (_io == nullptr)
+    io(IoLoop::create());
+  return *_io;
+}
+
+/**
+ * @brief Marks the fibers whose file operations have completed as ready to run.
+ */
+void Scheduler::collect()
+{
+  if (_io == nullptr || !_io->busy()) return;
+
+  _io->poll(_completed);
+  for (IoLoop::Request* request : _completed)
+    _ready.push_back(request->fiber);
+  _completed.clear();
+}
+
+/**
+ * @brief Marks the sleepers whose time has come as ready to run.
+ * @return True if any fiber is ready to run.
+ */
+bool Scheduler::wake()
+{
+  if (!_sleepers.empty())
+  {
+    const Clock::time_point now = Clock::now();
+    while (!_sleepers.empty() && _sleepers.top().deadline <= now)
+    {
+      _ready.push_back(_sleepers.top().fiber);
+      _sleepers.pop();
+    }
+  }
+  return !_ready.empty();
+}
+
+/**
+ * @brief Switches to the next fiber ready to run, waiting for a sleeper or a file
+ *        operation if there is none, and returns once the running fiber is switched
+ *        back to.
+ *
+ * The running fiber must have been queued or made to wait for something first. If no
+ * fiber can ever run again, the fiber the main one waits for is woken up instead, and
+ * marked as deadlocked.
+ */
+void Scheduler::block()
+{
+  for (;;)
+  {
+    // Polling only once nothing is ready lets the operations of the fibers run
+    // meanwhile pile up, to be passed on together.
+    if (_ready.empty())
+      collect();
+    if (wake())
+    {
+      Fiber* next = _ready.front();
+      _ready.pop_front();
+      if (next != _running)
+        switchTo(*next);
+      return;
+    }
+
+    if (_io != nullptr && _io->busy())
+    {
+      _io->wait(_sleepers.empty() ? std::nullopt : std::optional(_sleepers.top().deadline));
+      continue;
+    }
+
+    if (!_sleepers.empty())
+    {
+      std::this_thread::sleep_until(_sleepers.top().deadline);
+      continue;
+    }
+
+    // Nothing is ready, sleeping or waiting for a file, so the main fiber waits for a
+    // fiber that waits for another, and so on in a cycle. Failing the first of them breaks the cycle.
+    Fiber* stuck = _main._joining;
+    std::erase(stuck->_joining->_joiners, stuck);
+    stuck->_deadlocked = true;
+    _ready.push_back(stuck);
+  }
+}
+
+/**
+ * @brief Switches from the running fiber to another.
+ */
+void Scheduler::switchTo(Fiber& next)
+{
+  Fiber& previous = *_running;
+  previous._scope = std::move(_interpreter.environment._enclosing);
+  _interpreter.environment._enclosing = std::move(next._scope);
+  _running = &next;
+
+#ifdef CPPLOX_ASAN
+  void* fake_stack = nullptr;
+  const bool main = next._context.stack == nullptr;
+  __sanitizer_start_switch_fiber(previous._finished ? nullptr : &fake_stack,
+                                 main ? _main_stack : next._context.stack, main ? _main_stack_size : stack_size);
+  jump(previous._context.pointer, next._context.pointer);
+  finishSwitch(fake_stack);
+#else
+  jump(previous._context.pointer, next._context.pointer);
+#endif
+  releaseFinished();
+}
+
+/**
+ * @brief Tells AddressSanitizer, if enabled, that a switch to a fiber's stack is over.
+ * @param fake_stack What the sanitizer saved when the fiber was switched off, if anything.
+ */
+void Scheduler::finishSwitch([[maybe_unused]] void* fake_stack)
+{
+#ifdef CPPLOX_ASAN
+  // The first switch of all is off the thread's own stack, whose bounds are only known here.
+  const void* bottom;
+  size_t size;
+  __sanitizer_finish_switch_fiber(fake_stack, &bottom, &size);
+  if (_main_stack == nullptr)
+  {
+    _main_stack = bottom;
+    _main_stack_size = size;
+  }
+#endif
+}
+
+/**
+ * @brief Releases the stack of the fiber that finished last, now that it is not in use.
+ */
+void Scheduler::releaseFinished()
+{
+  if (_finished == nullptr) return;
+
+  void* stack = std::exchange(_finished->_context, {}).stack;
+  if (_stacks.size() < pooled_stacks)
+    _stacks.push_back(stack);
+  else
+    munmap(stack, stack_size);
+  _finished = nullptr;
+}
+
+/**
+ * @brief Runs a fiber's function on its own stack, and switches off it for good.
+ * @param argument The scheduler, whose running fiber is the one starting.
+ */
+void Scheduler::run(void* argument)
+{
+  Scheduler& scheduler = *static_cast<Scheduler*>(argument);
+  scheduler.finishSwitch(nullptr);
+  scheduler.releaseFinished();
+  Fiber& fiber = *scheduler._running;
+
+  // Nothing on this stack is ever unwound past here, so the call leaves no locals behind.
+  try
+  {
+    fiber._result = fiber._function->call(scheduler._interpreter, fiber._arguments);
+  }
+  catch (const RuntimeError& error)
+  {
+    scheduler._interpreter.reporter().runtimeError(error);
+  }
+  catch (...)
+  {
+    fiber._error = std::current_exception();
+  }
+
+  fiber._finished = true;
+  fiber._function = nullptr;
+  fiber._arguments.clear();
+  scheduler._ready.insert(scheduler._ready.end(), fiber._joiners.begin(), fiber._joiners.end());
+  fiber._joiners.clear();
+
+  // The fiber is kept alive, and its stack reserved, until the next fiber has switched off it.
+  scheduler._finished = std::move(*fiber._position);
+  scheduler._fibers.erase(fiber._position);
+  scheduler.block();
+  std::terminate();
+}
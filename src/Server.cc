@@ -0,0 +1,362 @@
+#include "Server.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "AstCache.h"
+#include "BinaryIO.h"
+#include "Interpreter.h"
+#include "Parser.h"
+#include "Scanner.h"
+#include "Source.h"
+#include "Stmt.h"
+#include "utils.h"
+
+namespace Server
+{
+  namespace
+  {
+    /**
+     * @brief A script the server has parsed, kept until its file changes.
+     */
+    struct Module
+    {
+      std::shared_ptr<const Source> source; /**< The text of the script, which its syntax tree points into */
+      std::vector<std::shared_ptr<Stmt<LiteralValue>>> statements; /**< Its top-level statements */
+      struct stat identity; /**< The status of its file when it was loaded */
+    };
+
+    /// Set by SIGINT and SIGTERM to stop serving.
+    volatile std::sig_atomic_t stopping = 0;
+
+    /// The largest request the server accepts, in bytes.
+    constexpr uint64_t max_request = 64 << 20;
+
+    /// The largest response the client accepts, in bytes.
+    constexpr uint64_t max_response = uint64_t(1) << 32;
+
+    /// How long the server waits for the rest of a request before dropping the client.
+    constexpr time_t receive_timeout = 10;
+
+    /**
+     * @brief Writes a whole buffer to a socket.
+     * @return False if the peer went away.
+     */
+    bool writeAll(const int& fd, std::string_view data)
+    {
+      while (!data.empty())
+      {
+        ssize_t count = write(fd, data.data(), data.size());
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        data.remove_prefix(count);
+      }
+      return true;
+    }
+
+    /**
+     * @brief Reads exactly the given number of bytes from a socket.
+     * @return False if the peer went away first.
+     */
+    bool readAll(const int& fd, char* data, size_t size)
+    {
+      while (size > 0)
+      {
+        ssize_t count = read(fd, data, size);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        data += count;
+        size -= count;
+      }
+      return true;
+    }
+
+    /**
+     * @brief Sends a message, prefixed with its length.
+     * @return False if the peer went away.
+     */
+    bool sendMessage(const int& fd, const std::string& message)
+    {
+      BinaryWriter writer;
+      writer.size(message.size());
+      return writeAll(fd, writer.buffer) && writeAll(fd, message);
+    }
+
+    /**
+     * @brief Receives a message sent with `sendMessage`.
+     * @param limit The largest message accepted, in bytes.
+     * @return False if the peer went away first, or announced a larger message.
+     */
+    bool receiveMessage(const int& fd, std::string& message, const uint64_t& limit)
+    {
+      uint64_t size;
+      if (!readAll(fd, reinterpret_cast<char*>(&size), sizeof(size)) || size > limit) return false;
+      message.resize(size);
+      return readAll(fd, message.data(), size);
+    }
+
+    /**
+     * @brief Fills in the address of a socket path.
+     * @return False if the path is too long for a socket address.
+     */
+    bool socketAddress(const std::string& socket_path, sockaddr_un& address)
+    {
+      std::memset(&address, 0, sizeof(address));
+      address.sun_family = AF_UNIX;
+      if (socket_path.size() >= sizeof(address.sun_path)) return false;
+      std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+      return true;
+    }
+
+    /**
+     * @class Worker
+     * @brief Runs requests, keeping the scripts it has parsed.
+     */
+    class Worker
+    {
+    public:
+      Worker(const std::string& cache_dir, const bool& lazy)
+        : _cache_dir(cache_dir), _lazy(lazy) {}
+
+      /**
+       * @brief Runs a request in a fresh interpreter, capturing what it reports.
+       * @param request The serialized request.
+       * @return The serialized response: the exit status, then the standard output and error.
+       */
+      std::string run(std::string_view request)
+      {
+        std::ostringstream out;
+        std::ostringstream err;
+        Lox::Reporter reporter(err);
+
+        int status = EXIT_SUCCESS;
+        try
+        {
+          BinaryReader reader(request);
+          auto kind = reader.raw<RequestKind>();
+          if (kind != RUN_FILE && kind != RUN_SOURCE)
+            throw std::runtime_error("Unknown request kind.");
+          std::string_view payload = reader.string();
+
+          std::shared_ptr<const Source> source;
+          std::vector<std::shared_ptr<Stmt<LiteralValue>>> statements;
+          if (kind == RUN_FILE)
+            source = load(std::string(payload), statements, reporter);
+          else
+          {
+            source = std::make_shared<const Source>(std::string(payload));
+            statements = parse(*source, reporter);
+          }
+
+          if (kind == RUN_FILE && source == nullptr && !reporter.hadError())
+          {
+            err << "Error opening file: " << payload << std::endl;
+            status = EXIT_FAILURE;
+          }
+          else if (!reporter.hadError())
+          {
+            Interpreter interpreter(reporter, out);
+            interpreter.interpret(statements);
+            interpreter.joinFibers();
+          }
+        }
+        catch (const std::exception& e)
+        {
+          err << "Exception: " << e.what() << std::endl;
+          status = EXIT_FAILURE;
+        }
+
+        if (reporter.hadError() || reporter.hadRuntimeError())
+          status = EXIT_FAILURE;
+
+        BinaryWriter response;
+        response.raw(static_cast<int32_t>(status));
+        response.string(out.str());
+        response.string(err.str());
+        return std::move(response.buffer);
+      }
+
+    private:
+      /**
+       * @brief Returns the parsed script at a path, parsing it again if its file has
+       *        changed since it was last parsed.
+       * @param statements Receives the top-level statements of the script.
+       * @return The text of the script, which must be kept as long as the statements
+       *         are used, or nullptr if it cannot be opened or has syntax errors.
+       */
+      std::shared_ptr<const Source> load(const std::string& path, std::vector<std::shared_ptr<Stmt<LiteralValue>>>& statements,
+                                         Lox::Reporter& reporter)
+      {
+        struct stat identity;
+        if (stat(path.c_str(), &identity) != 0) return nullptr;
+
+        std::lock_guard<std::mutex> lock(_loading);
+        auto cached = _modules.find(path);
+        if (cached != _modules.end())
+        {
+          const struct stat& known = cached->second.identity;
+          if (known.st_ino == identity.st_ino && known.st_dev == identity.st_dev && known.st_size == identity.st_size
+              && known.st_mtim.tv_sec == identity.st_mtim.tv_sec && known.st_mtim.tv_nsec == identity.st_mtim.tv_nsec)
+          {
+            statements = cached->second.statements;
+            return cached->second.source;
+          }
+          _modules.erase(cached);
+        }
+
+        Module module;
+        module.source = Source::load(path);
+        if (!module.source) return nullptr;
+        module.identity = identity;
+
+        std::optional<std::vector<std::shared_ptr<Stmt<LiteralValue>>>> parsed;
+        if (!_cache_dir.empty())
+          parsed = AstCache::load(_cache_dir, *module.source, _lazy);
+        if (!parsed)
+        {
+          parsed = parse(*module.source, reporter);
+          if (reporter.hadError()) return nullptr;
+          if (!_cache_dir.empty())
+            AstCache::store(_cache_dir, *module.source, _lazy, *parsed);
+        }
+        module.statements = std::move(*parsed);
+
+        statements = module.statements;
+        return _modules.insert_or_assign(path, std::move(module)).first->second.source;
+      }
+
+      /**
+       * @brief Scans and parses a script, reporting its syntax errors.
+       */
+      std::vector<std::shared_ptr<Stmt<LiteralValue>>> parse(const Source& source, Lox::Reporter& reporter)
+      {
+        Scanner scanner(source, reporter);
+        Parser<LiteralValue> parser(scanner, reporter);
+        parser.setLazyFunctions(_lazy);
+        return parser.parse();
+      }
+
+      std::string _cache_dir; ///< The directory parsed scripts are cached in on disk.
+      bool _lazy; ///< Whether function bodies are parsed on their first call.
+      std::unordered_map<std::string, Module> _modules; ///< The scripts parsed so far, by path.
+      std::mutex _loading; ///< Guards `_modules` against requests served at the same time.
+    };
+  }
+
+  /**
+   * @brief Listens on a socket and serves run requests until interrupted.
+   * @param socket_path The path of the socket, replaced if it already exists.
+   * @param cache_dir The directory parsed scripts are cached in on disk, or empty for none.
+   * @param lazy Whether function bodies are parsed on their first call.
+   * @return EXIT_FAILURE if the socket cannot be set up, EXIT_SUCCESS once interrupted.
+   */
+  int serve(const std::string& socket_path, const std::string& cache_dir, const bool& lazy)
+  {
+    sockaddr_un address;
+    if (!socketAddress(socket_path, address))
+    {
+      std::cerr << "Socket path too long: " << socket_path << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socket_path.c_str());
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+        || listen(listener, SOMAXCONN) != 0)
+    {
+      std::cerr << "Cannot listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+      if (listener >= 0) close(listener);
+      return EXIT_FAILURE;
+    }
+
+    // Interrupt accept() rather than restarting it, so that the socket is removed on exit.
+    struct sigaction action = {};
+    action.sa_handler = [](int) { stopping = 1; };
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    // Never freed, since threads serving connections may still be using it at exit.
+    Worker* worker = new Worker(cache_dir, lazy);
+    while (!stopping)
+    {
+      int client = accept(listener, nullptr, nullptr);
+      if (client < 0) continue;
+
+      // A client that stalls while sending its request only holds up its own thread, and not for long.
+      timeval timeout = { receive_timeout, 0 };
+      setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+      std::thread([worker, client] {
+        std::string request;
+        if (receiveMessage(client, request, max_request))
+          sendMessage(client, worker->run(request));
+        close(client);
+      }).detach();
+    }
+
+    close(listener);
+    unlink(socket_path.c_str());
+    return EXIT_SUCCESS;
+  }
+
+  /**
+   * @brief Sends a run request to a server, relaying its output and exit status.
+   * @param socket_path The path of the server's socket.
+   * @param kind What to run.
+   * @param payload The path of the script, or its source code.
+   * @return The exit status of the script, or EXIT_FAILURE if the server cannot be reached.
+   */
+  int request(const std::string& socket_path, const RequestKind& kind, const std::string& payload)
+  {
+    sockaddr_un address;
+    int server = socketAddress(socket_path, address) ? socket(AF_UNIX, SOCK_STREAM, 0) : -1;
+    if (server < 0 || connect(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+    {
+      std::cerr << "Cannot connect to " << socket_path << ": " << std::strerror(errno) << std::endl;
+      if (server >= 0) close(server);
+      return EXIT_FAILURE;
+    }
+
+    BinaryWriter request;
+    request.raw(kind);
+    request.string(payload);
+
+    std::string response;
+    bool answered = sendMessage(server, request.buffer) && receiveMessage(server, response, max_response);
+    close(server);
+    if (!answered)
+    {
+      std::cerr << "Server closed the connection: " << socket_path << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    try
+    {
+      BinaryReader reader(response);
+      int status = reader.raw<int32_t>();
+      std::cout << reader.string() << std::flush;
+      std::cerr << reader.string() << std::flush;
+      return status;
+    }
+    catch (const std::runtime_error& e)
+    {
+      std::cerr << "Malformed response: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+}
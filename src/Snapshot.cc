@@ -0,0 +1,329 @@
+#include "Snapshot.h"
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <variant>
+
+#include "AstCache.h"
+#include "BinaryIO.h"
+#include "LoxCallable.h"
+#include "LoxFunction.h"
+
+namespace Snapshot
+{
+  namespace
+  {
+    /// Written at the start of every snapshot.
+    constexpr char MAGIC[8] = { 'L', 'O', 'X', 'S', 'N', 'A', 'P', '\0' };
+
+    /**
+     * @brief Tags of the values.
+     */
+    enum ValueTag : uint8_t
+    {
+      NIL_VALUE, STRING_VALUE, NUMBER_VALUE, BOOL_VALUE, CALLABLE_VALUE
+    };
+
+    /**
+     * @brief Tags of the shared objects, which are referred to by their index.
+     */
+    enum ObjectTag : uint8_t
+    {
+      NATIVE_OBJECT, /**< A native function, by its global name */
+      FUNCTION_OBJECT, /**< A Lox function, by its declaration, with its closure */
+      ENVIRONMENT_OBJECT /**< An environment that others enclose */
+    };
+
+    /**
+     * @class HeapWriter
+     * @brief Serializes the objects reachable from environments.
+     *
+     * Objects are numbered in the order they are written, and every object is
+     * written after the objects it refers to, so that they can be rebuilt in one pass.
+     */
+    class HeapWriter
+    {
+    public:
+      BinaryWriter objects; ///< The serialized objects.
+
+      HeapWriter(const Interpreter& interpreter, const std::vector<const Stmt<LiteralValue>::Function*>& functions)
+      {
+        for (size_t i = 0; i < functions.size(); ++i)
+          _functions.emplace(functions[i], i);
+
+        // Natives are only known by the name the interpreter registers them under.
+        for (const auto& [name, value] : interpreter.globals.values())
+          if (auto callable = std::get_if<std::shared_ptr<LoxCallable>>(&value))
+            if (std::dynamic_pointer_cast<LoxFunction>(*callable) == nullptr)
+              _natives.emplace(callable->get(), name);
+      }
+
+      /**
+       * @brief Writes every object an environment refers to that has not been written yet.
+       */
+      void prepare(const Environment& environment)
+      {
+        if (environment.enclosing() != nullptr)
+          object(environment.enclosing().get());
+        for (const auto& [name, value] : environment.values())
+          if (auto callable = std::get_if<std::shared_ptr<LoxCallable>>(&value))
+            object(callable->get());
+      }
+
+      /**
+       * @brief Writes an environment in place, once its objects have been prepared.
+       */
+      void environment(BinaryWriter& writer, const Environment& environment)
+      {
+        writer.size(environment.enclosing() == nullptr ? 0 : _ids.at(environment.enclosing().get()) + 1);
+        writer.size(environment.values().size());
+        for (const auto& [name, value] : environment.values())
+        {
+          writer.string(name);
+          this->value(writer, value);
+        }
+      }
+
+      /**
+       * @brief Returns the number of objects written.
+       */
+      size_t count() const { return _ids.size(); }
+
+    private:
+      void value(BinaryWriter& writer, const LiteralValue& value)
+      {
+        if (auto string = std::get_if<std::string>(&value))
+        {
+          writer.raw(STRING_VALUE);
+          writer.string(*string);
+        }
+        else if (auto number = std::get_if<double>(&value))
+        {
+          writer.raw(NUMBER_VALUE);
+          writer.raw(*number);
+        }
+        else if (auto boolean = std::get_if<bool>(&value))
+        {
+          writer.raw(BOOL_VALUE);
+          writer.raw(*boolean);
+        }
+        else if (auto callable = std::get_if<std::shared_ptr<LoxCallable>>(&value))
+        {
+          writer.raw(CALLABLE_VALUE);
+          writer.size(_ids.at(callable->get()));
+        }
+        else
+          writer.raw(NIL_VALUE);
+      }
+
+      /**
+       * @brief Writes an object and, before it, everything it refers to.
+       */
+      template <class T>
+      void object(T* object)
+      {
+        if (_ids.count(object)) return;
+        if (!_visiting.insert(object).second)
+          throw std::runtime_error("Cannot snapshot a closure that refers back to itself.");
+
+        if constexpr (std::is_same_v<T, Environment>)
+        {
+          prepare(*object);
+          objects.raw(ENVIRONMENT_OBJECT);
+          environment(objects, *object);
+        }
+        else if (auto native = _natives.find(object); native != _natives.end())
+        {
+          objects.raw(NATIVE_OBJECT);
+          objects.string(native->second);
+        }
+        else if (auto function = dynamic_cast<const LoxFunction*>(object))
+        {
+          auto declaration = _functions.find(&function->declaration());
+          if (declaration == _functions.end())
+            throw std::runtime_error("Cannot snapshot function '" + std::string(function->declaration().name.lexeme()) + "' declared outside the script.");
+
+          prepare(function->closure());
+          objects.raw(FUNCTION_OBJECT);
+          objects.size(declaration->second);
+          environment(objects, function->closure());
+        }
+        else
+          throw std::runtime_error("Cannot snapshot a native function that is not a global.");
+
+        _visiting.erase(object);
+        _ids.emplace(object, _ids.size());
+      }
+
+      std::unordered_map<const Stmt<LiteralValue>::Function*, size_t> _functions; ///< Index of every declaration.
+      std::unordered_map<const LoxCallable*, std::string> _natives; ///< Global name of every native.
+      std::unordered_map<const void*, size_t> _ids; ///< Index of every object written.
+      std::unordered_set<const void*> _visiting; ///< Objects whose references are being written.
+    };
+
+    /**
+     * @class HeapReader
+     * @brief Rebuilds the objects written by a HeapWriter.
+     */
+    class HeapReader
+    {
+    public:
+      HeapReader(BinaryReader& reader, const Interpreter& interpreter,
+                 const std::vector<const Stmt<LiteralValue>::Function*>& functions)
+        : _reader(reader), _interpreter(interpreter), _functions(functions) {}
+
+      /**
+       * @brief Reads the given number of objects.
+       */
+      void objects(const size_t& count)
+      {
+        for (size_t i = 0; i < count; ++i)
+        {
+          switch (_reader.raw<uint8_t>())
+          {
+            case NATIVE_OBJECT:
+            {
+              std::string_view name = _reader.string();
+              auto native = _interpreter.globals.values().find(name);
+              if (native == _interpreter.globals.values().end() || !std::holds_alternative<std::shared_ptr<LoxCallable>>(native->second))
+                throw std::runtime_error("Unknown native function '" + std::string(name) + "'.");
+              _objects.emplace_back(std::get<std::shared_ptr<LoxCallable>>(native->second));
+              break;
+            }
+            case FUNCTION_OBJECT:
+            {
+              size_t declaration = _reader.size();
+              if (declaration >= _functions.size()) throw std::runtime_error("Malformed snapshot.");
+              Environment closure = environment();
+              _objects.emplace_back(std::make_shared<LoxFunction>(*_functions[declaration], closure));
+              break;
+            }
+            case ENVIRONMENT_OBJECT:
+              _objects.emplace_back(std::make_shared<Environment>(environment()));
+              break;
+            default:
+              throw std::runtime_error("Malformed snapshot.");
+          }
+        }
+      }
+
+      /**
+       * @brief Reads an environment written in place.
+       */
+      Environment environment()
+      {
+        size_t enclosing = _reader.size();
+        Environment environment(enclosing == 0 ? nullptr : object<Environment>(enclosing - 1));
+
+        for (size_t count = _reader.size(); count > 0; --count)
+        {
+          std::string_view name = _reader.string();
+          environment.define(name, value());
+        }
+        return environment;
+      }
+
+    private:
+      using Object = std::variant<std::shared_ptr<LoxCallable>, std::shared_ptr<Environment>>;
+
+      LiteralValue value()
+      {
+        switch (_reader.raw<uint8_t>())
+        {
+          case NIL_VALUE: return std::monostate();
+          case STRING_VALUE: return std::string(_reader.string());
+          case NUMBER_VALUE: return _reader.raw<double>();
+          case BOOL_VALUE: return _reader.raw<bool>();
+          case CALLABLE_VALUE: return object<LoxCallable>(_reader.size());
+          default: throw std::runtime_error("Malformed snapshot.");
+        }
+      }
+
+      template <class T>
+      std::shared_ptr<T> object(const size_t& id)
+      {
+        if (id >= _objects.size() || !std::holds_alternative<std::shared_ptr<T>>(_objects[id]))
+          throw std::runtime_error("Malformed snapshot.");
+        return std::get<std::shared_ptr<T>>(_objects[id]);
+      }
+
+      BinaryReader& _reader; ///< The snapshot being read.
+      const Interpreter& _interpreter; ///< The interpreter whose natives are re-bound.
+      const std::vector<const Stmt<LiteralValue>::Function*>& _functions; ///< Every declaration, by index.
+      std::vector<Object> _objects; ///< Every object read, by index.
+    };
+  }
+
+  /**
+   * @brief Saves the global state of an interpreter after it has run a script.
+   * @param path The file to write the snapshot to.
+   * @param interpreter The interpreter that ran the script.
+   * @param source The script.
+   * @param statements The top-level statements of the script.
+   * @throws std::runtime_error if the state cannot be saved or written.
+   */
+  void save(const std::string& path, const Interpreter& interpreter, const Source& source,
+            const std::vector<std::shared_ptr<Stmt<LiteralValue>>>& statements)
+  {
+    std::vector<const Stmt<LiteralValue>::Function*> functions;
+    std::string ast = AstCache::serialize(statements, &functions);
+
+    HeapWriter heap(interpreter, functions);
+    heap.prepare(interpreter.globals);
+    heap.prepare(interpreter.environment);
+
+    BinaryWriter writer;
+    writer.buffer.append(MAGIC, sizeof(MAGIC));
+    writer.string(AstCache::version());
+    writer.string(source.text());
+    writer.string(ast);
+    writer.size(heap.count());
+    writer.buffer += heap.objects.buffer;
+    heap.environment(writer, interpreter.globals);
+    heap.environment(writer, interpreter.environment);
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.write(writer.buffer.data(), writer.buffer.size()))
+      throw std::runtime_error("Cannot write snapshot to " + path + ".");
+  }
+
+  /**
+   * @brief Restores the global state saved in a snapshot into an interpreter.
+   * @param path The file to read the snapshot from.
+   * @param interpreter The interpreter to restore into, replacing its globals.
+   * @return The script the snapshot was taken after.
+   * @throws std::runtime_error if the snapshot cannot be read or was written by another build.
+   */
+  Restored restore(const std::string& path, Interpreter& interpreter)
+  {
+    std::unique_ptr<const Source> snapshot = Source::load(path, true);
+    if (!snapshot) throw std::runtime_error("Cannot open snapshot " + path + ".");
+
+    BinaryReader reader(snapshot->text());
+    if (reader.raw<std::array<char, sizeof(MAGIC)>>() != std::to_array(MAGIC))
+      throw std::runtime_error(path + " is not a snapshot.");
+    if (reader.string() != AstCache::version())
+      throw std::runtime_error(path + " was written by another build of the interpreter.");
+
+    Restored restored;
+    restored.source = std::make_unique<const Source>(std::string(reader.string()));
+
+    std::vector<const Stmt<LiteralValue>::Function*> functions;
+    restored.statements = AstCache::deserialize(reader.string(), *restored.source, &functions);
+
+    HeapReader heap(reader, interpreter, functions);
+    heap.objects(reader.size());
+    Environment globals = heap.environment();
+    Environment environment = heap.environment();
+    if (!reader.atEnd()) throw std::runtime_error("Malformed snapshot.");
+
+    interpreter.globals = globals;
+    interpreter.environment = environment;
+    return restored;
+  }
+}
@@ -0,0 +1,111 @@
+#include "Source.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ScanKernels.h"
+
+/**
+ * @brief Unmaps the text if it was mapped from a file.
+ */
+Source::~Source()
+{
+  if (_mapping != nullptr)
+    munmap(_mapping, _text.size());
+}
+
+/**
+ * @brief Checks that a text is small enough for tokens to refer into.
+ * @param text The text.
+ * @return The text.
+ * @throws std::runtime_error if the text is larger than `MAX_SIZE`.
+ */
+std::string_view Source::bounded(std::string_view text)
+{
+  if (text.size() > MAX_SIZE)
+    throw std::runtime_error("Source too large: " + std::to_string(text.size()) + " bytes, at most " +
+      std::to_string(MAX_SIZE) + " are supported.");
+  return text;
+}
+
+/**
+ * @brief Loads a script, mapping it into memory if asked to and it is a regular
+ *        file, and reading it otherwise.
+ * @param path The file path of the script.
+ * @param mapped Whether to map a regular file rather than copy it.
+ * @return The loaded source, or nullptr if the file cannot be opened.
+ * @throws std::runtime_error if the file cannot be read or is larger than `MAX_SIZE`.
+ */
+std::unique_ptr<const Source> Source::load(const std::string& path, const bool& mapped)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return nullptr;
+
+  struct stat status;
+  const bool regular = fstat(fd, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0;
+  auto too_large = [&path, fd] {
+    close(fd);
+    return std::runtime_error("File too large: " + path + ", at most " + std::to_string(MAX_SIZE) +
+      " bytes are supported.");
+  };
+  if (regular && static_cast<size_t>(status.st_size) > MAX_SIZE)
+    throw too_large();
+  if (mapped && regular)
+  {
+    void* mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping != MAP_FAILED)
+    {
+      close(fd);
+      madvise(mapping, status.st_size, MADV_SEQUENTIAL);
+      return std::unique_ptr<const Source>(new Source(mapping, status.st_size));
+    }
+  }
+
+  // Otherwise read it to the end, in one read for a regular file that does not grow meanwhile.
+  std::string text(regular ? static_cast<size_t>(status.st_size) + 1 : 1 << 16, '\0');
+  size_t size = 0;
+  for (;;)
+  {
+    if (size == text.size())
+      text.resize(text.size() * 2);
+    ssize_t count = read(fd, text.data() + size, text.size() - size);
+    if (count < 0 && errno == EINTR) continue;
+    if (count < 0)
+    {
+      close(fd);
+      throw std::runtime_error("Error reading file: " + path);
+    }
+    if (count == 0) break;
+    size += count;
+    if (size > MAX_SIZE) throw too_large();
+  }
+  close(fd);
+  text.resize(size);
+
+  return std::make_unique<const Source>(std::move(text));
+}
+
+/**
+ * @brief Returns the line number containing the given offset.
+ *
+ * Builds the line-start table on the first call, then answers with a binary search.
+ *
+ * @param offset The offset into the source code.
+ * @return The 1-based line number of the offset.
+ */
+int Source::line(const size_t& offset) const
+{
+  std::call_once(_line_starts_built, [this] {
+    _line_starts.push_back(0);
+    for (size_t i = ScanKernels::find(_text, 0, '\n'); i < _text.size(); i = ScanKernels::find(_text, i + 1, '\n'))
+      _line_starts.push_back(i + 1);
+  });
+
+  return _first_line - 1 + (std::upper_bound(_line_starts.begin(), _line_starts.end(), offset) - _line_starts.begin());
+}
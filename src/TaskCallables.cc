@@ -0,0 +1,365 @@
+#include "TaskCallables.h"
+
+#include <cmath>
+#include <map>
+#include <thread>
+#include <unordered_map>
+
+#include "LoxFunction.h"
+#include "TaskRuntime.h"
+
+namespace
+{
+  std::mutex outstanding_mutex; ///< Guards `outstanding`.
+  std::unordered_map<const Interpreter*, size_t> outstanding; ///< Unfinished tasks, by spawner.
+  std::atomic<size_t> outstanding_total = 0; ///< Unfinished tasks of every spawner.
+  std::unordered_map<const Interpreter*, std::map<size_t, std::shared_ptr<Task>>> unawaited; ///< Tasks not awaited yet, by spawner, in the order spawned.
+  size_t spawned = 0; ///< The tasks spawned so far, which numbers them.
+
+  /**
+   * @brief An interpreter of its own for a task, which starts with a copy of the
+   *        spawner's top-level variables.
+   */
+  struct Isolate
+  {
+    Lox::Reporter reporter; /**< Where the task's errors are reported */
+    Interpreter interpreter; /**< The interpreter running the task */
+
+    Isolate(const Environment& top_level, const unsigned& parallel_depth, std::ostream& out, std::ostream& err)
+      : reporter(err), interpreter(reporter, out)
+    {
+      interpreter.environment = top_level;
+      interpreter.setParallelDepth(parallel_depth);
+    }
+  };
+
+  /**
+   * @brief Copies the top-level variables of an interpreter, without the scopes it is running in.
+   */
+  Environment topLevel(const Interpreter& interpreter)
+  {
+    Environment top_level;
+    for (const auto& [name, value] : interpreter.environment.values())
+      top_level.define(name, value);
+    return top_level;
+  }
+
+  /**
+   * @brief Copies a Lox function together with the variables it captured, so that
+   *        a task can assign to them without affecting anyone else.
+   */
+  std::shared_ptr<LoxCallable> isolate(const std::shared_ptr<LoxCallable>& callable)
+  {
+    if (auto function = std::dynamic_pointer_cast<LoxFunction>(callable))
+      return std::make_shared<LoxFunction>(function->declaration(), function->closure().snapshot());
+    return callable;
+  }
+
+  /**
+   * @brief Records that a task of the given interpreter has finished.
+   */
+  void finished(const Interpreter* spawner)
+  {
+    std::lock_guard<std::mutex> lock(outstanding_mutex);
+    auto count = outstanding.find(spawner);
+    if (--count->second == 0)
+      outstanding.erase(count);
+    outstanding_total.fetch_sub(1, std::memory_order_release);
+  }
+}
+
+/**
+ * @brief Creates a task and the job that runs it, counting it as unfinished.
+ *
+ * @param spawner The interpreter spawning the task.
+ * @param function The function to run.
+ * @param arguments The arguments to pass to it.
+ * @return The task, and the job to run it with.
+ */
+std::pair<std::shared_ptr<Task>, std::function<void()>> Task::prepare(
+  Interpreter& spawner, const std::shared_ptr<LoxCallable>& function, std::vector<LiteralValue> arguments)
+{
+  std::shared_ptr<Task> task(new Task(spawner));
+  {
+    std::lock_guard<std::mutex> lock(outstanding_mutex);
+    ++outstanding[&spawner];
+    outstanding_total.fetch_add(1, std::memory_order_relaxed);
+    task->_number = spawned++;
+    unawaited[&spawner].emplace(task->_number, task);
+  }
+
+  return { task, [task, function = isolate(function), arguments = std::move(arguments),
+                  top_level = topLevel(spawner), parallel_depth = spawner.parallelDepth()] {
+    try
+    {
+      Isolate isolated(top_level, parallel_depth, task->_out, task->_errors);
+      task->_result = function->call(isolated.interpreter, arguments);
+    }
+    catch (...)
+    {
+      task->_error = std::current_exception();
+    }
+    task->_done.store(true, std::memory_order_release);
+    finished(task->_spawner);
+  } };
+}
+
+/**
+ * @brief Starts running a function on the task runtime.
+ *
+ * @param spawner The interpreter spawning the task, whose top-level variables are copied.
+ * @param function The function to run, whose closure is copied.
+ * @param arguments The arguments to pass to it.
+ * @return The running task.
+ */
+std::shared_ptr<Task> Task::spawn(Interpreter& spawner, const std::shared_ptr<LoxCallable>& function,
+                                  std::vector<LiteralValue> arguments)
+{
+  auto [task, job] = prepare(spawner, function, std::move(arguments));
+  TaskRuntime::instance().submit(std::move(job));
+  return task;
+}
+
+/**
+ * @brief Starts running a function on a thread of its own rather than on the task runtime.
+ *
+ * @param spawner The interpreter starting the task, whose top-level variables are copied.
+ * @param function The function to run, whose closure is copied.
+ * @param arguments The arguments to pass to it.
+ * @return The running task.
+ */
+std::shared_ptr<Task> Task::start(Interpreter& spawner, const std::shared_ptr<LoxCallable>& function,
+                                  std::vector<LiteralValue> arguments)
+{
+  auto [task, job] = prepare(spawner, function, std::move(arguments));
+  std::thread(std::move(job)).detach();
+  return task;
+}
+
+/**
+ * @brief Waits for the tasks an interpreter spawned, running pending tasks meanwhile,
+ *        then writes out what the tasks nobody awaited printed and reports their errors.
+ *
+ * @param spawner The interpreter.
+ */
+void Task::join(const Interpreter& spawner)
+{
+  if (outstanding_total.load(std::memory_order_acquire) != 0)
+    TaskRuntime::instance().helpUntil([&spawner] {
+      std::lock_guard<std::mutex> lock(outstanding_mutex);
+      return outstanding.find(&spawner) == outstanding.end();
+    });
+
+  std::map<size_t, std::shared_ptr<Task>> tasks;
+  {
+    std::lock_guard<std::mutex> lock(outstanding_mutex);
+    auto found = unawaited.find(&spawner);
+    if (found == unawaited.end()) return;
+    tasks = std::move(found->second);
+    unawaited.erase(found);
+  }
+
+  for (const auto& [number, task] : tasks)
+  {
+    bool flushed = false;
+    std::call_once(task->_flushed, [&] { task->flush(spawner); flushed = true; });
+    if (!flushed || !task->_error) continue;
+
+    try
+    {
+      std::rethrow_exception(task->_error);
+    }
+    catch (const RuntimeError& error)
+    {
+      spawner.reporter().runtimeError(error);
+    }
+    catch (const std::exception& error)
+    {
+      spawner.reporter().stream() << error.what() << std::endl;
+    }
+  }
+}
+
+/**
+ * @brief Drops what the task printed and the error it stops with, for a task whose
+ *        value turned out not to be needed.
+ */
+void Task::discard()
+{
+  std::call_once(_flushed, [this] { forget(); });
+}
+
+/**
+ * @brief Removes the task from those of its spawner that were not awaited.
+ */
+void Task::forget()
+{
+  std::lock_guard<std::mutex> lock(outstanding_mutex);
+  auto tasks = unawaited.find(_spawner);
+  if (tasks != unawaited.end() && tasks->second.erase(_number) != 0 && tasks->second.empty())
+    unawaited.erase(tasks);
+}
+
+/**
+ * @brief Writes out what the task printed and reported, and forgets that it was not awaited.
+ *
+ * @param interpreter The interpreter whose streams to write to.
+ */
+void Task::flush(const Interpreter& interpreter)
+{
+  forget();
+  interpreter.out() << _out.str();
+  interpreter.reporter().stream() << _errors.str();
+}
+
+/**
+ * @brief Waits for the task, running pending tasks meanwhile.
+ *
+ * @param interpreter The interpreter awaiting the task.
+ * @return The value the function returned.
+ * @throws RuntimeError, or any other error, the function stopped with.
+ */
+LiteralValue Task::await(Interpreter& interpreter)
+{
+  TaskRuntime::instance().helpUntil([this] { return _done.load(std::memory_order_acquire); });
+
+  std::call_once(_flushed, [this, &interpreter] { flush(interpreter); });
+  if (_error) std::rethrow_exception(_error);
+  return _result;
+}
+
+/**
+ * @brief Spawns a task calling the function with the remaining arguments.
+ *
+ * @param interpreter The interpreter spawning the task.
+ * @param arguments The function, followed by its arguments.
+ * @return The task.
+ * @throws NativeError if the first argument is not callable or the rest do not match its arity.
+ */
+LiteralValue SpawnCallable::call(Interpreter& interpreter, const std::vector<LiteralValue>& arguments)
+{
+  if (!std::holds_alternative<std::shared_ptr<LoxCallable>>(arguments[0]))
+    throw NativeError("Can only spawn functions.");
+
+  const std::shared_ptr<LoxCallable>& function = std::get<std::shared_ptr<LoxCallable>>(arguments[0]);
+  function->checkArity(arguments.size() - 1);
+
+  return std::shared_ptr<LoxCallable>(
+    Task::spawn(interpreter, function, std::vector<LiteralValue>(arguments.begin() + 1, arguments.end())));
+}
+
+/**
+ * @brief Starts a worker calling the function with the remaining arguments.
+ *
+ * @param interpreter The interpreter starting the worker.
+ * @param arguments The function, followed by its arguments.
+ * @return The task running the worker.
+ * @throws NativeError if the first argument is not callable or the rest do not match its arity.
+ */
+LiteralValue WorkerCallable::call(Interpreter& interpreter, const std::vector<LiteralValue>& arguments)
+{
+  if (!std::holds_alternative<std::shared_ptr<LoxCallable>>(arguments[0]))
+    throw NativeError("Can only start functions as workers.");
+
+  const std::shared_ptr<LoxCallable>& function = std::get<std::shared_ptr<LoxCallable>>(arguments[0]);
+  function->checkArity(arguments.size() - 1);
+
+  return std::shared_ptr<LoxCallable>(
+    Task::start(interpreter, function, std::vector<LiteralValue>(arguments.begin() + 1, arguments.end())));
+}
+
+/**
+ * @brief Waits for the task.
+ *
+ * @param interpreter The interpreter awaiting the task.
+ * @param arguments The task.
+ * @return The value the task's function returned.
+ * @throws NativeError if the argument is not a task.
+ */
+LiteralValue AwaitCallable::call(Interpreter& interpreter, const std::vector<LiteralValue>& arguments)
+{
+  std::shared_ptr<Task> task;
+  if (std::holds_alternative<std::shared_ptr<LoxCallable>>(arguments[0]))
+    task = std::dynamic_pointer_cast<Task>(std::get<std::shared_ptr<LoxCallable>>(arguments[0]));
+  if (task == nullptr)
+    throw NativeError("Can only await tasks.");
+
+  return task->await(interpreter);
+}
+
+/**
+ * @brief Calls the function for every index in the range, and waits for all of the calls.
+ *
+ * @param interpreter The interpreter calling `parallel_for`.
+ * @param arguments The lower bound, the upper bound and the function.
+ * @return nil.
+ * @throws NativeError if the bounds are not numbers or the function does not take one argument.
+ */
+LiteralValue ParallelForCallable::call(Interpreter& interpreter, const std::vector<LiteralValue>& arguments)
+{
+  if (!std::holds_alternative<double>(arguments[0]) || !std::holds_alternative<double>(arguments[1]))
+    throw NativeError("Range bounds must be numbers.");
+  if (!std::holds_alternative<std::shared_ptr<LoxCallable>>(arguments[2]))
+    throw NativeError("Can only call functions and classes.");
+
+  const double first = std::get<double>(arguments[0]);
+  const double last = std::get<double>(arguments[1]);
+  const std::shared_ptr<LoxCallable>& function = std::get<std::shared_ptr<LoxCallable>>(arguments[2]);
+  function->checkArity(1);
+
+  const size_t count = last > first ? static_cast<size_t>(std::ceil(last - first)) : 0;
+  if (count == 0) return std::monostate();
+
+  /**
+   * @brief A run of consecutive indices, called by one task.
+   */
+  struct Chunk
+  {
+    size_t begin, end; /**< The offsets of its indices from `first` */
+    std::ostringstream out; /**< What its calls printed */
+    std::ostringstream errors; /**< The errors they reported */
+    std::exception_ptr error; /**< The error its calls stopped with, if any */
+  };
+
+  // A few chunks per worker, so that workers that finish early can steal the rest.
+  TaskRuntime& runtime = TaskRuntime::instance();
+  std::vector<Chunk> chunks(std::min(count, runtime.threads() * 4));
+  std::atomic<size_t> remaining = chunks.size();
+  const Environment top_level = topLevel(interpreter);
+
+  for (size_t i = 0; i < chunks.size(); ++i)
+  {
+    chunks[i].begin = count * i / chunks.size();
+    chunks[i].end = count * (i + 1) / chunks.size();
+    runtime.submit([&, i] {
+      Chunk& chunk = chunks[i];
+      try
+      {
+        Isolate isolated(top_level, interpreter.parallelDepth(), chunk.out, chunk.errors);
+        std::shared_ptr<LoxCallable> body = isolate(function);
+        std::vector<LiteralValue> index(1);
+        for (size_t offset = chunk.begin; offset < chunk.end; ++offset)
+        {
+          index[0] = first + offset;
+          body->call(isolated.interpreter, index);
+        }
+      }
+      catch (...)
+      {
+        chunk.error = std::current_exception();
+      }
+      remaining.fetch_sub(1, std::memory_order_release);
+    });
+  }
+  runtime.helpUntil([&remaining] { return remaining.load(std::memory_order_acquire) == 0; });
+
+  for (Chunk& chunk : chunks)
+  {
+    interpreter.out() << chunk.out.str();
+    interpreter.reporter().stream() << chunk.errors.str();
+  }
+  for (Chunk& chunk : chunks)
+    if (chunk.error) std::rethrow_exception(chunk.error);
+
+  return std::monostate();
+}
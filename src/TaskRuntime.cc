@@ -0,0 +1,155 @@
+#include "TaskRuntime.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace
+{
+  /// Workers requested with setThreads, 0 for one per hardware thread.
+  unsigned requested_threads = 0;
+
+  /// The deque of the worker running on this thread, or none outside the pool.
+  thread_local size_t current_worker = std::numeric_limits<size_t>::max();
+}
+
+/**
+ * @brief Sets the number of worker threads, if the pool has not been started yet.
+ * @param threads The number of workers, or 0 for one per hardware thread.
+ */
+void TaskRuntime::setThreads(const unsigned& threads)
+{
+  requested_threads = threads;
+}
+
+/**
+ * @brief Returns the pool, starting it on first use.
+ * @return The process-wide pool.
+ */
+TaskRuntime& TaskRuntime::instance()
+{
+  // Never destroyed: workers may still be sleeping, or running detached jobs, at exit.
+  static TaskRuntime* runtime = new TaskRuntime(requested_threads != 0
+    ? requested_threads : std::max(1u, std::thread::hardware_concurrency()));
+  return *runtime;
+}
+
+/**
+ * @brief Starts the worker threads, which are never joined.
+ * @param threads The number of workers.
+ */
+TaskRuntime::TaskRuntime(const unsigned& threads)
+{
+  for (unsigned i = 0; i < threads; ++i)
+    _workers.push_back(std::make_unique<Worker>());
+  for (size_t i = 0; i < _workers.size(); ++i)
+    std::thread(&TaskRuntime::work, this, i).detach();
+}
+
+/**
+ * @brief Queues a job, on the deque of the calling worker if it is one.
+ * @param job The job to run.
+ */
+void TaskRuntime::submit(Job job)
+{
+  size_t index = current_worker < _workers.size() ? current_worker : _next++ % _workers.size();
+
+  // Counted before it is visible, so that the count never drops below zero.
+  _pending.fetch_add(1, std::memory_order_release);
+  {
+    std::lock_guard<std::mutex> lock(_workers[index]->mutex);
+    _workers[index]->jobs.push_back(std::move(job));
+  }
+  {
+    std::lock_guard<std::mutex> lock(_idle_mutex);
+  }
+  _idle.notify_one();
+}
+
+/**
+ * @brief Runs pending jobs until a condition holds, waiting only when there are none.
+ * @param done Checked after every job, and whenever a job finishes on another thread.
+ */
+void TaskRuntime::helpUntil(const std::function<bool()>& done)
+{
+  while (!done())
+  {
+    if (runPending()) continue;
+
+    // What is awaited is running elsewhere; the timeout only guards against a missed wake up.
+    std::unique_lock<std::mutex> lock(_finished_mutex);
+    _finished.wait_for(lock, std::chrono::milliseconds(1), [&] {
+      return done() || _pending.load(std::memory_order_acquire) > 0;
+    });
+  }
+}
+
+/**
+ * @brief Runs jobs on a worker thread, sleeping while there are none.
+ * @param index The worker's deque.
+ */
+void TaskRuntime::work(const size_t& index)
+{
+  current_worker = index;
+  for (;;)
+  {
+    if (runPending()) continue;
+
+    std::unique_lock<std::mutex> lock(_idle_mutex);
+    _idle.wait(lock, [this] { return _pending.load(std::memory_order_acquire) > 0; });
+  }
+}
+
+/**
+ * @brief Takes a job from the calling worker's own deque, or steals one from another.
+ * @return The job, or nothing if every deque is empty.
+ */
+std::optional<TaskRuntime::Job> TaskRuntime::take()
+{
+  const bool is_worker = current_worker < _workers.size();
+  if (is_worker)
+  {
+    Worker& own = *_workers[current_worker];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.jobs.empty())
+    {
+      Job job = std::move(own.jobs.back());
+      own.jobs.pop_back();
+      return job;
+    }
+  }
+
+  const size_t start = is_worker ? current_worker + 1 : 0;
+  for (size_t i = 0; i < _workers.size(); ++i)
+  {
+    Worker& victim = *_workers[(start + i) % _workers.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.jobs.empty())
+    {
+      Job job = std::move(victim.jobs.front());
+      victim.jobs.pop_front();
+      return job;
+    }
+  }
+  return std::nullopt;
+}
+
+/**
+ * @brief Takes and runs one pending job.
+ * @return False if there was none.
+ */
+bool TaskRuntime::runPending()
+{
+  if (_pending.load(std::memory_order_acquire) == 0) return false;
+
+  std::optional<Job> job = take();
+  if (!job) return false;
+
+  _pending.fetch_sub(1, std::memory_order_acq_rel);
+  (*job)();
+  {
+    std::lock_guard<std::mutex> lock(_finished_mutex);
+  }
+  _finished.notify_all();
+  return true;
+}
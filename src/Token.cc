@@ -1,5 +1,7 @@
 #include "Token.h"
 
+#include <charconv>
+
 /**
  * @brief Stream insertion operator for the Token class.
  * @param os The output stream.
@@ -15,6 +17,7 @@ std::string tokenTypeToString(TokenType type)
     case RIGHT_BRACE: return "RIGHT_BRACE";
     case COMMA: return "COMMA";
     case DOT: return "DOT";
+    case DOT_DOT: return "DOT_DOT";
     case MINUS: return "MINUS";
     case PLUS: return "PLUS";
     case SEMICOLON: return "SEMICOLON";
@@ -29,6 +32,12 @@ std::string tokenTypeToString(TokenType type)
     case GREATER_EQUAL: return "GREATER_EQUAL";
     case LESS: return "LESS";
     case LESS_EQUAL: return "LESS_EQUAL";
+    case PLUS_EQUAL: return "PLUS_EQUAL";
+    case MINUS_EQUAL: return "MINUS_EQUAL";
+    case STAR_EQUAL: return "STAR_EQUAL";
+    case SLASH_EQUAL: return "SLASH_EQUAL";
+    case PLUS_PLUS: return "PLUS_PLUS";
+    case MINUS_MINUS: return "MINUS_MINUS";
     case IDENTIFIER: return "IDENTIFIER";
     case STRING: return "STRING";
     case NUMBER: return "NUMBER";
@@ -48,14 +57,38 @@ std::string tokenTypeToString(TokenType type)
     case TRUE: return "TRUE";
     case VAR: return "VAR";
     case WHILE: return "WHILE";
+    case IN: return "IN";
+    case YIELD: return "YIELD";
     case END: return "EOF"; // To make match with jlox
     default: return "UNKNOWN";
   }
 }
 
+/**
+ * @brief Returns the literal value of the token, if applicable.
+ * @return The number or string value of a literal token, otherwise `std::monostate`.
+ */
+LiteralValue Token::literal() const
+{
+  std::string_view text = lexeme();
+
+  if (type == NUMBER)
+  {
+    double value = 0;
+    std::from_chars(text.data(), text.data() + text.size(), value);
+    return value;
+  }
+
+  // Strip the enclosing quotes.
+  if (type == STRING)
+    return std::string(text.substr(1, text.size() - 2));
+
+  return std::monostate();
+}
+
 std::ostream& operator<<(std::ostream& os, const Token& token)
 {
-  os << tokenTypeToString(token.type) << " " << token.lexeme << " ";
+  os << tokenTypeToString(token.type) << " " << token.lexeme() << " ";
   std::visit([&os](auto&& arg) 
   { 
     if constexpr (std::is_same_v<std::decay_t<decltype(arg)>, std::monostate>)
@@ -63,7 +96,7 @@ std::ostream& operator<<(std::ostream& os, const Token& token)
     else
       // Print string literals without enclosing quotes
       os << arg;
-  }, token.literal);
+  }, token.literal());
   
   return os;
 }
@@ -6,80 +6,336 @@
  * It handles command line arguments and decides whether to run a script or enter the interactive prompt.
  */
 
-#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <mutex>
 #include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "AstCache.h"
 #include "AstPrinter.h"
+#include "BoundedQueue.h"
 #include "Interpreter.h"
 #include "Parser.h"
 #include "Scanner.h"
+#include "Server.h"
+#include "Snapshot.h"
+#include "Source.h"
 #include "Stmt.h"
+#include "TaskCallables.h"
+#include "TaskRuntime.h"
 #include "Token.h"
 #include "utils.h"
 
-Interpreter interpreter; // Persistent interpreter object
-bool had_error = false; // Extern
+unsigned jobs = 1; // Threads to scan with, or scripts to run at once when given several, set by --jobs
+bool streaming = false; // Execute declarations as they are parsed, set by --stream
+bool pipelined = false; // Parse on a background thread while executing, set by --pipeline
+bool lazy = false; // Parse function bodies on their first call, set by --lazy
+std::string cache_dir = AstCache::defaultDirectory(); // Where parsed scripts are cached, set by --cache-dir and --no-cache
+bool stats = false; // Report where front end time goes, set by --stats
+std::string snapshot_in; // Snapshot to restore the globals from, set by --snapshot-in
+std::string snapshot_out; // Snapshot to save the globals to after the script, set by --snapshot-out
+std::string serve_socket; // Socket to serve run requests on, set by --serve
+std::string connect_socket; // Socket of the server to send the script to, set by --connect
+bool fork_server = false; // Run each line of standard input as a job in a forked child, set by --fork-server
+unsigned task_threads = 0; // Workers running spawned tasks, one per hardware thread if 0, set by --threads
+bool auto_parallel = false; // Evaluate independent pure calls in parallel, set by --auto-parallel
+unsigned parallel_depth = 0; // How many forks of independent pure calls may be nested, derived from the above
+
+// Number of parsed declarations the background parser may run ahead of the interpreter.
+constexpr size_t PIPELINE_DEPTH = 64;
+
+/**
+ * @brief Everything one run of the interpreter needs, so that several scripts can
+ *        run at once on different threads without sharing any state.
+ */
+struct Session
+{
+  std::ostream& out; ///< Where the scripts print to.
+  std::ostream& err; ///< Where errors and statistics are reported.
+  Lox::Reporter reporter; ///< Reports errors to `err`.
+
+  // Everything run so far is retained for the lifetime of the interpreter: tokens refer
+  // into their source, and functions refer to their declarations.
+  std::vector<std::unique_ptr<const Source>> sources;
+  std::vector<std::shared_ptr<Stmt<LiteralValue>>> program;
+
+  Interpreter interpreter; ///< Persistent interpreter object.
+  unsigned scan_jobs; ///< Threads to scan with.
+  bool had_error = false; ///< Set if a script could not be loaded.
+
+  Session(std::ostream& out, std::ostream& err, const unsigned& scan_jobs)
+    : out(out), err(err), reporter(err), interpreter(reporter, out), scan_jobs(scan_jobs)
+  {
+    interpreter.setParallelDepth(parallel_depth);
+  }
+
+  /**
+   * @brief Checks whether anything went wrong in the session.
+   * @return True if a script could not be loaded, or had a syntax or runtime error.
+   */
+  bool failed() const { return had_error || reporter.hadError() || reporter.hadRuntimeError(); }
+};
+
+/**
+ * @brief Creates the parser for a scanned source, scanning it up front on several
+ *        threads if requested, and on demand otherwise.
+ *
+ * Function bodies are parsed on their first call if requested.
+ * @param session The session the source is run in.
+ * @param scanner The scanner of the source.
+ * @param reporter The reporter for syntax errors.
+ * @return The parser.
+ */
+Parser<LiteralValue> makeParser(Session& session, Scanner& scanner, Lox::Reporter& reporter)
+{
+  Parser<LiteralValue> parser = session.scan_jobs > 1
+    ? Parser<LiteralValue>(scanner.scanTokens(session.scan_jobs), reporter)
+    : Parser<LiteralValue>(scanner, reporter);
+  parser.setLazyFunctions(lazy);
+  return parser;
+}
+
+/**
+ * @brief Executes a single top-level declaration, retaining it with the program.
+ * @param session The session to execute it in.
+ * @param statement The declaration to execute.
+ * @return False if it raised a runtime error.
+ */
+bool execute(Session& session, const std::shared_ptr<Stmt<LiteralValue>>& statement)
+{
+  session.program.push_back(statement);
+  session.interpreter.interpret({ statement });
+  return !session.reporter.hadRuntimeError();
+}
+
+/**
+ * @brief Parses on a background thread, executing each declaration on this one as
+ *        soon as it has been parsed.
+ *
+ * The parser may run at most `PIPELINE_DEPTH` declarations ahead, and stops once
+ * the interpreter gives up on a runtime error. Its syntax errors are reported to a
+ * buffer of its own and passed along with the next declaration, so that only this
+ * thread writes to the session's error stream.
+ * @param session The session to run in.
+ * @param source The source to run.
+ */
+void runPipelined(Session& session, const Source& source)
+{
+  BoundedQueue<std::pair<std::shared_ptr<Stmt<LiteralValue>>, std::string>> queue(PIPELINE_DEPTH);
+  std::ostringstream errors;
+  Lox::Reporter reporter(errors);
+
+  std::thread front_end([&session, &source, &queue, &errors, &reporter] {
+    Scanner scanner(source, reporter);
+    Parser<LiteralValue> parser = makeParser(session, scanner, reporter);
+    while (std::shared_ptr<Stmt<LiteralValue>> statement = parser.parseNext())
+    {
+      std::string reported = errors.str();
+      errors.str("");
+      if (!queue.push({ statement, std::move(reported) })) break;
+    }
+    queue.close();
+  });
+
+  while (std::optional<std::pair<std::shared_ptr<Stmt<LiteralValue>>, std::string>> item = queue.pop())
+  {
+    session.reporter.relay(item->second);
+    if (!execute(session, item->first))
+    {
+      queue.close();
+      break;
+    }
+  }
+
+  front_end.join();
+  session.reporter.relay(errors.str());
+}
 
 /**
  * @brief Executes the scanning process on the source code.
  *
- * This function takes a string representing the source code and initializes a Scanner object with it.
- * It then scans the source code for tokens and prints each token to the standard output.
- * @param source The source code to scan.
+ * This function takes the source code and initializes a Scanner object with it.
+ * It then parses the tokens and interprets the resulting statements, either once
+ * everything has been parsed or, when streaming, one declaration at a time.
+ * @param session The session to run in.
+ * @param source The source code to run, retained for the lifetime of the interpreter.
  */
-void run(const std::string& source)
+void run(Session& session, std::unique_ptr<const Source> source)
 {
   // Initialize the scanner with the source code.
-  Scanner scanner(source);
+  session.sources.push_back(std::move(source));
+
+  if (pipelined)
+  {
+    runPipelined(session, *session.sources.back());
+    return;
+  }
 
-  // Scan the source code for tokens.
-  std::vector<Token> tokens;
-  tokens = scanner.scanTokens();
+  Scanner scanner(*session.sources.back(), session.reporter);
+  Parser<LiteralValue> parser = makeParser(session, scanner, session.reporter);
+
+  // Execute each declaration as soon as it is parsed.
+  if (streaming)
+  {
+    while (std::shared_ptr<Stmt<LiteralValue>> statement = parser.parseNext())
+      if (!execute(session, statement)) return;
+    return;
+  }
 
-  // Parse the tokens.
-  Parser<LiteralValue> parser(tokens);
   std::vector<std::shared_ptr<Stmt<LiteralValue>>> statements = parser.parse();
+  session.program.insert(session.program.end(), statements.begin(), statements.end());
 
-  if (had_error) return;
+  if (session.had_error) return;
   
   // Interpret the expression.
-  interpreter.interpret(statements);
+  session.interpreter.interpret(statements);
+}
+
+/**
+ * @brief Runs a script, loading its syntax tree from the cache if it was parsed before,
+ *        and storing it there otherwise.
+ *
+ * Scripts with syntax errors are not cached. With --stats, reports how long loading
+ * or scanning and parsing took.
+ * @param session The session to run in.
+ * @param source The source code to run, retained for the lifetime of the interpreter.
+ */
+void runCached(Session& session, std::unique_ptr<const Source> source)
+{
+  using Clock = std::chrono::steady_clock;
+  auto milliseconds = [](const Clock::time_point& start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  };
+
+  session.sources.push_back(std::move(source));
+  const Source& script = *session.sources.back();
+
+  Clock::time_point start = Clock::now();
+  std::optional<std::vector<std::shared_ptr<Stmt<LiteralValue>>>> statements;
+  if (!cache_dir.empty())
+    statements = AstCache::load(cache_dir, script, lazy);
+
+  if (statements)
+  {
+    if (stats) session.err << "[stats] loaded cached syntax tree in " << milliseconds(start) << " ms" << std::endl;
+  }
+  else
+  {
+    Scanner scanner(script, session.reporter);
+    statements = makeParser(session, scanner, session.reporter).parse();
+    if (stats) session.err << "[stats] scanned and parsed in " << milliseconds(start) << " ms" << std::endl;
+
+    if (!cache_dir.empty() && !session.reporter.hadError())
+    {
+      start = Clock::now();
+      bool stored = AstCache::store(cache_dir, script, lazy, *statements);
+      if (stats)
+        session.err << "[stats] " << (stored ? "stored syntax tree in " : "failed to store syntax tree after ")
+                  << milliseconds(start) << " ms: " << AstCache::entryPath(cache_dir, script, lazy) << std::endl;
+    }
+  }
+  session.program.insert(session.program.end(), statements->begin(), statements->end());
+
+  if (session.had_error) return;
+
+  // Interpret the expression.
+  session.interpreter.interpret(*statements);
 }
 
 /**
  * @brief Runs a script from a given file path.
  * 
+ * @param session The session to run in.
  * @param path The file path to the script that needs to be run.
  */
-void runFile(const std::string& path)
+void runFile(Session& session, const std::string& path)
 {
-  // Attempt to open the script file.
-  std::ifstream script(path);
-  if (!script)
+  try
+  {
+    // Read rather than mapped, since the script may be rewritten while it runs.
+    std::unique_ptr<const Source> source = Source::load(path);
+    if (!source)
+    {
+      session.err << "Error opening file: " << path << std::endl;
+      session.had_error = true;
+      return;
+    }
+
+    // Run the script directly from the loaded source, through the cache unless streaming.
+    if (streaming || pipelined)
+      run(session, std::move(source));
+    else
+      runCached(session, std::move(source));
+
+    // Let the fibers and tasks the script started run to the end, so that their errors count.
+    session.interpreter.joinFibers();
+    Task::join(session.interpreter);
+  }
+  catch (const std::exception& e)
   {
-    std::cerr << "Error opening file: " << path << std::endl;
-    had_error = true;
+    session.err << "Exception: " << e.what() << std::endl;
+    session.had_error = true;
     return;
   }
+}
 
-  // Try to read the file contents into a string.
+/**
+ * @brief Restores the globals saved by an earlier run with --snapshot-out, retaining
+ *        the script they were defined by.
+ * @param session The session to restore into.
+ * @param path The snapshot file.
+ * @return False if the snapshot could not be restored.
+ */
+bool restoreSnapshot(Session& session, const std::string& path)
+{
   try
   {
-    std::stringstream buffer;
-    buffer << script.rdbuf();
-    std::string source = buffer.str();
-    script.close();
+    Snapshot::Restored restored = Snapshot::restore(path, session.interpreter);
+    session.sources.push_back(std::move(restored.source));
+    session.program.insert(session.program.end(), restored.statements.begin(), restored.statements.end());
+    return true;
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << "Cannot restore snapshot: " << e.what() << std::endl;
+    return false;
+  }
+}
 
-    // Run the script using the source string.
-    run(source);
+/**
+ * @brief Saves the globals left by the script that was run, so that later runs can
+ *        start from them with --snapshot-in.
+ * @param session The session the script was run in.
+ * @param path The snapshot file.
+ * @return False if the snapshot could not be saved.
+ */
+bool saveSnapshot(Session& session, const std::string& path)
+{
+  try
+  {
+    Snapshot::save(path, session.interpreter, *session.sources.back(), session.program);
+    return true;
   }
   catch (const std::exception& e)
   {
-    std::cerr << "Exception: " << e.what() << std::endl;
-    had_error = true;
-    return;
+    std::cerr << "Cannot save snapshot: " << e.what() << std::endl;
+    return false;
   }
 }
 
@@ -89,8 +345,9 @@ void runFile(const std::string& path)
  * This function initiates a loop that continuously prompts the user for input.
  * It reads a line from the standard input and executes it. If an empty line is encountered,
  * it is ignored. The loop ends when EOF is reached.
+ * @param session The session to run in.
  */
-void runPrompt()
+void runPrompt(Session& session)
 {
   std::cout << "> ";
   
@@ -101,9 +358,10 @@ void runPrompt()
     if (line.empty()) continue;
 
     // Execute command and continue even on encountering errors.
-    run(line);
+    run(session, std::make_unique<const Source>(line));
+    session.interpreter.joinFibers();
 
-    had_error = false;
+    session.had_error = false;
 
     // End loop on end-of-file.
     if (std::cin.eof()) break; 
@@ -112,6 +370,258 @@ void runPrompt()
   }
 }
 
+/**
+ * @brief Checks whether buffered input ends after a complete declaration: outside
+ *        of any string, comment or bracket, and after a ';' or '}'.
+ * @param text The buffered input.
+ * @param braced Set if the input ends after a '}', which an 'else' may still follow.
+ * @return True if the input can be run without waiting for more lines.
+ */
+bool isComplete(std::string_view text, bool& braced)
+{
+  int depth = 0;
+  char last = '\0';
+  for (size_t i = 0; i < text.size(); ++i)
+  {
+    char c = text[i];
+    if (c == '"')
+    {
+      i = text.find('"', i + 1);
+      if (i == std::string_view::npos) return false;
+    }
+    else if (c == '/' && i + 1 < text.size() && text[i + 1] == '/')
+    {
+      i = text.find('\n', i);
+      if (i == std::string_view::npos) break;
+      continue;
+    }
+    else if (c == '/' && i + 1 < text.size() && text[i + 1] == '*')
+    {
+      i = text.find("*/", i + 2);
+      if (i == std::string_view::npos) return false;
+      ++i;
+      continue;
+    }
+    else if (c == '(' || c == '{')
+      ++depth;
+    else if (c == ')' || c == '}')
+      --depth;
+    else if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+      continue;
+
+    last = c;
+  }
+
+  braced = last == '}';
+  return depth <= 0 && (last == ';' || last == '}');
+}
+
+/**
+ * @brief Checks whether a line could continue the declaration before it: it starts
+ *        with an 'else', or holds nothing but blanks or a comment.
+ * @param line The line.
+ * @return True if the declaration before the line must not be run yet.
+ */
+bool continuesDeclaration(std::string_view line)
+{
+  const size_t start = line.find_first_not_of(" \t\r");
+  if (start == std::string_view::npos) return true;
+
+  line.remove_prefix(start);
+  if (line.starts_with("//") || line.starts_with("/*")) return true;
+  return line.starts_with("else") && (line.size() == 4 || !(std::isalnum(static_cast<unsigned char>(line[4])) || line[4] == '_'));
+}
+
+/**
+ * @brief Runs an endless stream of declarations from standard input, e.g. from a pipe.
+ *
+ * Lines are buffered until they form complete declarations, which are then run
+ * straight away instead of waiting for the end of the input. A declaration ending
+ * with a '}' is held until a line shows that no 'else' follows it. Like the interactive
+ * prompt, errors do not stop later declarations from running, and line numbers
+ * count from the start of each run.
+ * @param session The session to run in.
+ */
+void runStream(Session& session)
+{
+  streaming = true;
+
+  std::string buffer;
+  auto flush = [&] {
+    run(session, std::make_unique<const Source>(std::move(buffer)));
+    buffer.clear();
+    session.out.flush();
+
+    session.reporter.resetRuntimeError();
+  };
+
+  std::string line;
+  bool held = false;
+  while (std::getline(std::cin, line))
+  {
+    if (held && !continuesDeclaration(line))
+      flush();
+
+    buffer += line;
+    buffer += '\n';
+    bool braced;
+    const bool complete = isComplete(buffer, braced);
+    held = complete && braced;
+    if (complete && !braced)
+      flush();
+  }
+
+  // Run what is left so that its errors are reported.
+  if (buffer.find_first_not_of(" \t\r\n") != std::string::npos)
+    run(session, std::make_unique<const Source>(std::move(buffer)));
+}
+
+/**
+ * @brief Waits for a job forked by `runForkServer` and reports its exit status.
+ * @param jobs The jobs still running, by process id, with their numbers.
+ * @param failed Set if the job failed.
+ * @param block Whether to wait for a job to finish if none has yet.
+ * @return False if no job was reaped.
+ */
+bool reapJob(std::unordered_map<pid_t, size_t>& jobs, bool& failed, const bool& block)
+{
+  int status;
+  pid_t pid = waitpid(-1, &status, block ? 0 : WNOHANG);
+  if (pid <= 0) return false;
+
+  auto job = jobs.find(pid);
+  if (job == jobs.end()) return true;
+
+  int code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+  std::cerr << "[job " << job->second << "] exited with status " << code << std::endl;
+  failed = failed || code != EXIT_SUCCESS;
+  jobs.erase(job);
+  return true;
+}
+
+/**
+ * @brief Runs each line of standard input as a job in a child process forked from
+ *        this one, after the prelude has been run.
+ *
+ * Every child starts with the prelude's syntax tree and globals already in memory,
+ * shared with this process copy-on-write, so a job pays for neither. Jobs run
+ * concurrently, writing to the shared standard output, and their exit statuses are
+ * reported on standard error as they finish.
+ * @param session The session the prelude was run in.
+ * @return EXIT_FAILURE if any job failed.
+ */
+int runForkServer(Session& session)
+{
+  std::unordered_map<pid_t, size_t> jobs;
+  bool failed = false;
+  size_t count = 0;
+
+  std::string line;
+  while (std::getline(std::cin, line))
+  {
+    while (reapJob(jobs, failed, false)) {}
+    if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+
+    // Nothing buffered may be written twice, once by each process.
+    std::cout.flush();
+    std::cerr.flush();
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+      std::cerr << "Cannot fork job: " << std::strerror(errno) << std::endl;
+      failed = true;
+      continue;
+    }
+    if (pid == 0)
+    {
+      run(session, std::make_unique<const Source>(std::move(line)));
+      session.interpreter.joinFibers();
+      Task::join(session.interpreter);
+      session.out.flush();
+      _exit(session.reporter.hadError() || session.reporter.hadRuntimeError() ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+    jobs.emplace(pid, ++count);
+  }
+
+  while (!jobs.empty() && reapJob(jobs, failed, true)) {}
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+ * @brief A script run by `runBatch`, and what it wrote.
+ */
+struct Job
+{
+  std::string path; ///< The script.
+  std::ostringstream out; ///< What the script printed.
+  std::ostringstream err; ///< What the script reported.
+  bool failed = false; ///< Whether the script failed.
+  bool done = false; ///< Whether the script has finished, guarded by the batch's mutex.
+};
+
+/**
+ * @brief Runs independent scripts on a pool of threads, each in a session of its own.
+ *
+ * Every job captures its output, which is written out in the order the scripts
+ * were given as soon as they and every script before them have finished, so the
+ * output is the same as running them one after another. Each script is scanned
+ * on a single thread.
+ * @param paths The scripts to run.
+ * @param threads The number of scripts to run at once.
+ * @return EXIT_FAILURE if any script failed.
+ */
+int runBatch(const std::vector<std::string>& paths, const unsigned& threads)
+{
+  std::vector<Job> batch(paths.size());
+  for (size_t i = 0; i < paths.size(); ++i)
+    batch[i].path = paths[i];
+
+  std::mutex mutex;
+  std::condition_variable finished;
+  std::atomic<size_t> next = 0;
+
+  auto work = [&] {
+    for (size_t i = next++; i < batch.size(); i = next++)
+    {
+      Job& job = batch[i];
+      {
+        Session session(job.out, job.err, 1);
+        runFile(session, job.path);
+        job.failed = session.failed();
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      job.done = true;
+      finished.notify_one();
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (unsigned i = 0; i < std::min<size_t>(threads, batch.size()); ++i)
+    pool.emplace_back(work);
+
+  bool failed = false;
+  for (size_t i = 0; i < batch.size(); ++i)
+  {
+    Job& job = batch[i];
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      finished.wait(lock, [&job] { return job.done; });
+    }
+
+    std::cout << job.out.str() << std::flush;
+    std::cerr << job.err.str();
+    if (job.failed)
+      std::cerr << "[job " << i + 1 << "] " << job.path << " failed" << std::endl;
+    failed = failed || job.failed;
+  }
+
+  for (std::thread& thread : pool)
+    thread.join();
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
 /**
  * @brief Main function.
  * @param argc Number of command line arguments.
@@ -120,30 +630,132 @@ void runPrompt()
  */
 int main(int argc, char* argv[])
 {
-  // Flag to indicate if an error has occurred.
-  had_error = false;
+  // Consume the options preceding the script.
+  int arg = 1;
+  for (; arg < argc && std::strncmp(argv[arg], "--", 2) == 0; ++arg)
+  {
+    if (std::strcmp(argv[arg], "--jobs") == 0 && arg + 1 < argc)
+      jobs = std::max(1, std::atoi(argv[++arg]));
+    else if (std::strcmp(argv[arg], "--stream") == 0)
+      streaming = true;
+    else if (std::strcmp(argv[arg], "--pipeline") == 0)
+      pipelined = true;
+    else if (std::strcmp(argv[arg], "--lazy") == 0)
+      lazy = true;
+    else if (std::strcmp(argv[arg], "--no-cache") == 0)
+      cache_dir.clear();
+    else if (std::strcmp(argv[arg], "--cache-dir") == 0 && arg + 1 < argc)
+      cache_dir = argv[++arg];
+    else if (std::strcmp(argv[arg], "--stats") == 0)
+      stats = true;
+    else if (std::strcmp(argv[arg], "--snapshot-in") == 0 && arg + 1 < argc)
+      snapshot_in = argv[++arg];
+    else if (std::strcmp(argv[arg], "--snapshot-out") == 0 && arg + 1 < argc)
+      snapshot_out = argv[++arg];
+    else if (std::strcmp(argv[arg], "--serve") == 0 && arg + 1 < argc)
+      serve_socket = argv[++arg];
+    else if (std::strcmp(argv[arg], "--connect") == 0 && arg + 1 < argc)
+      connect_socket = argv[++arg];
+    else if (std::strcmp(argv[arg], "--fork-server") == 0)
+      fork_server = true;
+    else if (std::strcmp(argv[arg], "--threads") == 0 && arg + 1 < argc)
+      task_threads = std::max(1, std::atoi(argv[++arg]));
+    else if (std::strcmp(argv[arg], "--auto-parallel") == 0)
+      auto_parallel = true;
+    else
+    {
+      std::cout << "Unknown option: " << argv[arg] << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  TaskRuntime::setThreads(task_threads);
 
+  // Enough nested forks for a few tasks per worker, so that uneven branches can be stolen.
+  if (auto_parallel)
+    parallel_depth = std::bit_width(4 * (task_threads != 0 ? task_threads : std::max(1u, std::thread::hardware_concurrency())) - 1);
+
+  /**
+   * Several scripts are run as a batch, independently of each other.
+   */
+  if (argc - arg > 1)
+  {
+    std::vector<std::string> paths(argv + arg, argv + argc);
+    bool standalone = snapshot_in.empty() && snapshot_out.empty() && serve_socket.empty() && connect_socket.empty()
+                      && !fork_server && std::find(paths.begin(), paths.end(), "-") == paths.end();
+    if (standalone)
+      return runBatch(paths, jobs);
+  }
+
+  /**
+   * Incorrect usage: too many command line arguments, or a snapshot to save without
+   * a script to save it after. Snapshots hold a single script, so one cannot be
+   * saved on top of another either.
+   */
+  if (argc - arg > 1 || (!snapshot_out.empty() && (argc - arg != 1 || std::strcmp(argv[arg], "-") == 0 || !snapshot_in.empty()))
+      || (!serve_socket.empty() && argc - arg != 0) || (!connect_socket.empty() && argc - arg != 1)
+      || (fork_server && argc - arg == 1 && std::strcmp(argv[arg], "-") == 0))
+  {
+    std::cout << "Usage: cpplox [--jobs n] [--threads n] [--auto-parallel] [--stream] [--pipeline] [--lazy] [--no-cache] [--cache-dir dir] [--stats]"
+                 " [--snapshot-in file] [--snapshot-out file] [script | -]\n"
+                 "       cpplox [--jobs n] [--threads n] [--auto-parallel] [--stream] [--pipeline] [--lazy] [--no-cache] [--cache-dir dir] [--stats]"
+                 " script script...\n"
+                 "       cpplox [--lazy] [--no-cache] [--cache-dir dir] --serve socket\n"
+                 "       cpplox --connect socket (script | -)\n"
+                 "       cpplox [--snapshot-in file] --fork-server [prelude]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /**
+   * Warm server: run scripts sent over the socket until interrupted.
+   */
+  if (!serve_socket.empty())
+    return Server::serve(serve_socket, cache_dir, lazy);
   /**
-   * Incorrect usage: too many command line arguments.
+   * Thin client: have the server run the script, or the source code on standard input.
    */
-  if (argc > 2)
+  if (!connect_socket.empty())
   {
-    std::cout << "Usage: cpplox [script]" << std::endl;
+    if (std::strcmp(argv[arg], "-") == 0)
+      return Server::request(connect_socket, Server::RUN_SOURCE, std::string(std::istreambuf_iterator<char>(std::cin), {}));
+    return Server::request(connect_socket, Server::RUN_FILE, std::filesystem::absolute(argv[arg]).string());
+  }
+
+  Session session(std::cout, std::cerr, jobs);
+  if (!snapshot_in.empty() && !restoreSnapshot(session, snapshot_in))
     return EXIT_FAILURE;
+
+  /**
+   * Fork server: run the prelude script, if any, then run each job on top of it.
+   */
+  if (fork_server)
+  {
+    if (argc - arg == 1)
+    {
+      runFile(session, argv[arg]);
+      if (session.failed()) return EXIT_FAILURE;
+    }
+    return runForkServer(session);
   }
+  /**
+   * Correct usage: '-', run declarations from standard input as they arrive.
+   */
+  else if (argc - arg == 1 && std::strcmp(argv[arg], "-") == 0)
+    runStream(session);
   /**
    * Correct usage: one argument, run the script file.
    */
-  else if (argc == 2)
+  else if (argc - arg == 1)
   {
-    runFile(argv[1]);
-    if (had_error) return EXIT_FAILURE;
+    runFile(session, argv[arg]);
+    if (session.had_error) return EXIT_FAILURE;
+    if (!snapshot_out.empty() && (session.failed() || !saveSnapshot(session, snapshot_out)))
+      return EXIT_FAILURE;
   }
   /**
    * Correct usage: no arguments, run in interactive mode.
    */
   else
-    runPrompt();
+    runPrompt(session);
 
   return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -54,7 +54,8 @@ def parseTypes(
 def defineVisitor(
         file: TextIO,
         base_name: str,
-        types: List[str]) -> None:
+        types: List[str],
+        includes: List[str] = []) -> None:
     file.write("  struct Visitor\n")
     file.write("  {\n")
 
@@ -100,7 +101,8 @@ def defineType(
 def defineAst(
         output_dir: str,
         base_name: str,
-        types: List[str]) -> None:
+        types: List[str],
+        includes: List[str] = []) -> None:
 
     types: List[Dict[str, str]] = parseTypes(types)
     file_path: str = os.path.join(output_dir, f"{base_name}.h")
@@ -109,6 +111,8 @@ def defineAst(
         file.write("#pragma once\n")
         file.write("\n")
         file.write('#include "Token.h"\n')
+        for include in includes:
+            file.write(f'#include "{include}"\n')
         file.write("\n")
         file.write("template <class R>\n")
         file.write(f"class {base_name}\n")
@@ -160,7 +164,8 @@ def main() -> None:
             "Unary       : const Token& oper, const std::shared_ptr<const Expr<R>>& right",
             "Ternary     : const std::shared_ptr<const Expr<R>>& condition, const std::shared_ptr<const Expr<R>>& then_branch," + 
                          " const std::shared_ptr<const Expr<R>>& else_branch",
-            "Variable    : const Token& name"
+            "Variable    : const Token& name",
+            "Update      : const Token& name, const Token& oper, const std::shared_ptr<const Expr<R>>& value, const bool& postfix"
     ])
 
     defineAst(output_dir, "Stmt",[
@@ -168,13 +173,16 @@ def main() -> None:
             "Expression : const std::shared_ptr<const Expr<R>>& expression",
             "If         : const std::shared_ptr<const Expr<R>>& condition, const std::shared_ptr<const Stmt<R>>& then_branch," +
                         " const std::shared_ptr<const Stmt<R>>& else_branch",
-            "Function   : const Token& name, const std::vector<Token>& params, const std::vector<std::shared_ptr<const Stmt<R>>>& body",
+            "Function   : const Token& name, const std::vector<Token>& params, const std::shared_ptr<const FunctionBody<R>>& body",
             "Print      : const std::shared_ptr<const Expr<R>>& expression",
             "Return     : const Token& keyword, const std::shared_ptr<const Expr<R>>& value",
             "Var        : const Token& name, const std::shared_ptr<const Expr<R>>& initializer",
             "While      : const std::shared_ptr<const Expr<R>>& condition, const std::shared_ptr<const Stmt<R>>& body",
             "Jump       : const Token& keyword",
-    ])
+            "For        : const Token& name, const std::shared_ptr<const Expr<R>>& start, const std::shared_ptr<const Expr<R>>& stop," +
+                        " const std::shared_ptr<const Expr<R>>& step, const std::shared_ptr<const Stmt<R>>& body",
+            "Yield      : const Token& keyword, const std::shared_ptr<const Expr<R>>& value",
+    ], ["FunctionBody.h"])
     
 if __name__ == "__main__":
     main()
\ No newline at end of file